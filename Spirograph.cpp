@@ -127,20 +127,28 @@ public:
 	alo::QuickGUI::Slider* guiSlider1 = nullptr;
 	alo::QuickGUI::Slider* guiSlider2 = nullptr;
 	alo::QuickGUI::Slider* guiSlider3 = nullptr;
+	alo::QuickGUI::Slider* guiSlider4 = nullptr;
 	alo::QuickGUI::Button* guiButton1 = nullptr;
 	alo::QuickGUI::Button* guiButton2 = nullptr;
 	alo::QuickGUI::CheckBox* guiCheck1 = nullptr;
+	alo::QuickGUI::CheckBox* guiCheck2 = nullptr;
 
 	alo::vf2d vOldPenPoint;
 	bool bFirst = true;
 
+	// Every point the pen has drawn through, for filling the finished curve
+	std::vector<alo::vf2d> vPenPath;
+	// Points of the wide stroke being drawn, and its width
+	alo::Raster::Stroke stroke;
+	float fStrokeWidth = 0.0f;
+
 	float fAccumulatedTime = 0.0f;
 
 	alo::Palette p;
 
 
 	// GE doesnt have a DrawCircleDEcal routine by default for a number
-	// of reasons, so I've made one here that exploits a unit circle
+	// of reasons, so the gear circles here exploit a unit circle
 	// being pre-made...
 	std::vector<alo::vf2d> MakeUnitCircle(const size_t verts = 64)
 	{
@@ -154,16 +162,33 @@ public:
 	std::vector<alo::vf2d> vertsUnitCircle = MakeUnitCircle();
 	// ...which means we only have to scale and offset the vertices when we want
 	// to actually draw the circle, avoiding those trig functions
-	void DrawCircleDecal(const alo::vf2d& vPos, const float fRadius, const alo::Pixel colour = alo::WHITE)
+	void AddCircle(const alo::vf2d& vPos, const float fRadius)
 	{
-		std::vector<alo::vf2d> vDraw(vertsUnitCircle.size(), { 0,0 });
-		std::transform(vertsUnitCircle.begin(), vertsUnitCircle.end(), vDraw.begin(),
-			[&](const alo::vf2d& vIn) { return vIn * fRadius + vPos; });
-		SetDecalMode(alo::DecalMode::WIREFRAME);
-		DrawPolygonDecal(nullptr, vDraw, vDraw, colour);
-		SetDecalMode(alo::DecalMode::NORMAL);
+		const uint32_t nFirst = uint32_t(vGearVerts.size());
+		for (const auto& v : vertsUnitCircle)
+		{
+			vGearIndices.push_back(uint32_t(vGearVerts.size()));
+			vGearVerts.push_back(v * fRadius + vPos);
+		}
+		// The unit circle ends where it starts, so this closes the loop
+		vGearIndices.back() = nFirst;
+		vGearIndices.push_back(alo::nDecalRestart);
 	}
 
+	void AddLine(const alo::vf2d& a, const alo::vf2d& b)
+	{
+		vGearIndices.push_back(uint32_t(vGearVerts.size()));
+		vGearVerts.push_back(a);
+		vGearIndices.push_back(uint32_t(vGearVerts.size()));
+		vGearVerts.push_back(b);
+		vGearIndices.push_back(alo::nDecalRestart);
+	}
+
+	// The gear overlay is built as one mesh of line strips, split by restarts,
+	// and drawn with a single indexed decal
+	std::vector<alo::vf2d> vGearVerts;
+	std::vector<uint32_t> vGearIndices;
+
 public:
 	bool OnUserCreate() override
 	{
@@ -188,6 +213,13 @@ public:
 		guiButton2 = new alo::QuickGUI::Button(guiManager,
 			"Draw!", { 1700.0f, 110.0f }, { 200.0f, 20.0f });
 
+		// Pen Width
+		guiSlider4 = new alo::QuickGUI::Slider(guiManager,
+			{ 1700.0f, 145.0f }, { 1900.0f, 145.0f }, 1.0f, 64.0f, 1.0f);
+
+		guiCheck2 = new alo::QuickGUI::CheckBox(guiManager,
+			"Glow", false, { 1700.0f, 165.0f }, { 90.0f, 16.0f });
+
 		p = alo::Palette(alo::Palette::Stock::Spectrum);
 
 		Reset();
@@ -199,6 +231,8 @@ public:
 	{
 		bFirst = true;
 		fAccumulatedTime = 0.0f;
+		vPenPath.clear();
+		stroke.Clear();
 		Clear(alo::BLACK);
 	}
 
@@ -211,6 +245,10 @@ public:
 		if (GetKey(alo::Key::R).bPressed || guiButton1->bPressed)
 			Reset();
 
+		// Neon glow around the curve, added as the image is presented
+		if (guiCheck2->bPressed)
+			SetLayerGlow(0, guiCheck2->bChecked ? 12 : 0, 1.5f);
+
 		// Advance "time" only when the user wishes to draw
 		if (GetKey(alo::Key::SPACE).bHeld || guiButton2->bHeld)
 			fAccumulatedTime += fElapsedTime * 5.0f;
@@ -252,12 +290,17 @@ public:
 		if (guiCheck1->bChecked)
 		{
 			// Draw as "Decals" so they appear on top of sprites
-			DrawCircleDecal(vFixedGearPos, fFixedGearRadius, alo::WHITE);
-			DrawCircleDecal(vFixedGearPos + vMovingGearPos, std::abs(fMovingGearRadius), alo::WHITE);
-			DrawCircleDecal(vPenPoint, 4, alo::WHITE);
-			DrawLineDecal(
+			vGearVerts.clear();
+			vGearIndices.clear();
+			AddCircle(vFixedGearPos, fFixedGearRadius);
+			AddCircle(vFixedGearPos + vMovingGearPos, std::abs(fMovingGearRadius));
+			AddCircle(vPenPoint, 4);
+			AddLine(
 				vFixedGearPos + vMovingGearPos + vPenOffset.norm() * fMovingGearRadius,
-				vFixedGearPos + vMovingGearPos - vPenOffset.norm() * fMovingGearRadius, alo::WHITE);
+				vFixedGearPos + vMovingGearPos - vPenOffset.norm() * fMovingGearRadius);
+			SetDecalStructure(alo::DecalStructure::LINE);
+			DrawIndexedDecal(nullptr, vGearVerts, {}, vGearIndices, alo::WHITE);
+			SetDecalStructure(alo::DecalStructure::FAN);
 		}
 
 		// Draws the GUI
@@ -265,7 +308,34 @@ public:
 
 		// Sprite Draw a line from the previous pen point to the new one
 		if (GetKey(alo::Key::SPACE).bHeld || guiButton2->bHeld)
-			DrawLine(vOldPenPoint, vPenPoint, p.Sample(fAccumulatedTime / 300.0f));
+		{
+			if (guiSlider4->fValue > 1.0f)
+			{
+				// Each frame extends one stroke, so its joints are blended once
+				if (stroke.Points().empty() || guiSlider4->fValue != fStrokeWidth)
+				{
+					stroke.Clear();
+					fStrokeWidth = guiSlider4->fValue;
+					ExtendStroke(stroke, vOldPenPoint, fStrokeWidth);
+				}
+				ExtendStroke(stroke, vPenPoint, fStrokeWidth, p.Sample(fAccumulatedTime / 300.0f));
+			}
+			else
+			{
+				DrawLine(vOldPenPoint, vPenPoint, p.Sample(fAccumulatedTime / 300.0f));
+				stroke.Clear();
+			}
+			vPenPath.push_back(vPenPoint);
+		}
+		else
+			stroke.Clear();
+
+		// "F" fills the petals of the curve drawn so far, right click fills
+		// the enclosed region under the mouse
+		if (GetKey(alo::Key::F).bPressed)
+			FillPolygon(vPenPath, p.Sample(fAccumulatedTime / 300.0f), alo::Raster::FillRule::EVEN_ODD);
+		if (GetMouse(1).bPressed)
+			FloodFill(GetMousePos(), p.Sample(fAccumulatedTime / 300.0f));
 
 		// Store old pen point
 		vOldPenPoint = vPenPoint;
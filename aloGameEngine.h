@@ -70,6 +70,10 @@ int main()
 #include <algorithm>
 #include <array>
 #include <cstring>
+#include <cfloat>
+#include <mutex>
+#include <condition_variable>
+#include <new>
 #pragma endregion
 
 #define GE_VER 220
@@ -114,6 +118,17 @@ int main()
 
 #define UNUSED(x) (void)(x)
 
+// SIMD Selection - the CPU drawing kernels fall back to plain C++ without it
+#if !defined(ALO_SIMD_NONE) && !defined(ALO_SIMD_SSE2)
+	#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+		#define ALO_SIMD_SSE2
+	#endif
+#endif
+
+#if defined(ALO_SIMD_SSE2)
+	#include <emmintrin.h>
+#endif
+
 // O------------------------------------------------------------------------------O
 // | PLATFORM SELECTION CODE:                                                     |
 // O------------------------------------------------------------------------------O
@@ -222,6 +237,7 @@ namespace alo
 {
 	class GameEngine;
 	class Sprite;
+	struct SpriteView;
 
 	// Game Engine Advanced Configuration
 	constexpr uint8_t  nMouseButtons = 5;
@@ -423,6 +439,109 @@ namespace alo
 		virtual alo::rcode SaveImageResource(alo::Sprite* spr, const std::string& sImageFile) = 0;
 	};
 
+	// O------------------------------------------------------------------------------O
+	// | alo::PixelPool - Recycles pixel storage in size classes                      |
+	// O------------------------------------------------------------------------------O
+	// Blocks are 64-byte aligned and sized in quarter steps between powers of two.
+	// Freed blocks are cached for reuse rather than returned to the heap, so a
+	// steady churn of same sized sprites causes no heap traffic at all
+	class PixelPool
+	{
+	public:
+		struct Stats
+		{
+			uint64_t nAllocations = 0;
+			uint64_t nReleases = 0;
+			uint64_t nHeapAllocations = 0;
+			uint64_t nHeapReleases = 0;
+			size_t nBytesInUse = 0;
+			size_t nBytesCached = 0;
+		};
+
+	public:
+		static alo::PixelPool& Get();
+		void* Allocate(size_t nBytes);
+		void Release(void* p, size_t nBytes);
+		// Hands all cached blocks back to the heap
+		void Trim();
+		Stats GetStats() const;
+
+	private:
+		PixelPool() = default;
+		static size_t SizeClass(size_t nBytes, size_t& nClassBytes);
+		static constexpr size_t nAlign = 64;
+		static constexpr size_t nClasses = 4 * 48;
+		std::array<std::vector<void*>, nClasses> vFree;
+		mutable std::mutex mux;
+		Stats stats;
+	};
+
+	// Routes a container's storage through alo::PixelPool. Value-less construction
+	// is skipped, so growing a buffer does not rewrite memory that is about to
+	// be overwritten anyway. Only for trivially copyable element types
+	template<typename T>
+	struct PoolAllocator
+	{
+		using value_type = T;
+		PoolAllocator() = default;
+		template<typename U> PoolAllocator(const PoolAllocator<U>&) noexcept {}
+		T* allocate(size_t n) { return static_cast<T*>(alo::PixelPool::Get().Allocate(n * sizeof(T))); }
+		void deallocate(T* p, size_t n) noexcept { alo::PixelPool::Get().Release(p, n * sizeof(T)); }
+		template<typename U> void construct(U*) noexcept {}
+		template<typename U, typename... Args> void construct(U* p, Args&&... args) { ::new((void*)p) U(std::forward<Args>(args)...); }
+		template<typename U> bool operator == (const PoolAllocator<U>&) const noexcept { return true; }
+		template<typename U> bool operator != (const PoolAllocator<U>&) const noexcept { return false; }
+	};
+
+	using PixelBuffer = std::vector<alo::Pixel, alo::PoolAllocator<alo::Pixel>>;
+
+	// O------------------------------------------------------------------------------O
+	// | alo::FrameArena - Bump allocator for scratch memory that lives one frame     |
+	// O------------------------------------------------------------------------------O
+	// Nothing is constructed or freed individually. Reset() drops everything, and
+	// if the frame overflowed into extra chunks they are merged into one, so the
+	// arena settles at the size a frame actually needs. Not thread safe.
+	class FrameArena
+	{
+	public:
+		struct Stats
+		{
+			size_t nCapacity = 0;
+			size_t nUsed = 0;
+			size_t nPeak = 0;
+			uint64_t nHeapAllocations = 0;
+		};
+
+	public:
+		FrameArena(size_t nInitialBytes = 1 << 20);
+		FrameArena(const FrameArena&) = delete;
+		~FrameArena();
+		void* Allocate(size_t nBytes, size_t nAlignment = 64);
+		template<typename T> T* Allocate(size_t nCount) { return static_cast<T*>(Allocate(nCount * sizeof(T), std::max(alignof(T), size_t(16)))); }
+		// Mark and Rewind give stack-like scopes inside a frame
+		struct Marker { size_t nChunk = 0; size_t nUsed = 0; };
+		Marker Mark() const;
+		void Rewind(const Marker& m);
+		void Reset();
+		Stats GetStats() const;
+
+	private:
+		struct Chunk { uint8_t* pData = nullptr; size_t nSize = 0; size_t nUsed = 0; };
+		void* AllocateFrom(Chunk& c, size_t nBytes, size_t nAlignment);
+		std::vector<Chunk> vChunks;
+		size_t nCurrent = 0;
+		size_t nUsedTotal = 0;
+		size_t nPeak = 0;
+		uint64_t nHeapAllocations = 0;
+	};
+
+	// O------------------------------------------------------------------------------O
+	// | alo::ParallelRows - Splits a range of rows across worker threads             |
+	// O------------------------------------------------------------------------------O
+	// Calls f(y0, y1) on disjoint slices covering [y0, y1), each at least nMinRows
+	// tall, and returns once all are done. The calling thread takes slices too, and
+	// the workers persist between calls. Calls made from inside f run in place
+	void ParallelRows(int32_t y0, int32_t y1, int32_t nMinRows, const std::function<void(int32_t, int32_t)>& f);
 
 	// O------------------------------------------------------------------------------O
 	// | alo::Sprite - An image represented by a 2D array of alo::Pixel               |
@@ -433,6 +552,9 @@ namespace alo
 		Sprite();
 		Sprite(const std::string& sImageFile, alo::ResourcePack* pack = nullptr);
 		Sprite(int32_t w, int32_t h);
+		// bClear = false leaves recycled pixel storage as it is, for sprites
+		// that are about to be completely overwritten
+		Sprite(int32_t w, int32_t h, bool bClear);
 		Sprite(const alo::Sprite&) = delete;
 		~Sprite();
 
@@ -444,6 +566,10 @@ namespace alo
 		int32_t height = 0;
 		enum Mode { NORMAL, PERIODIC, CLAMP };
 		enum Flip { NONE = 0, HORIZ = 1, VERT = 2 };
+		enum Filter { NEAREST, BILINEAR };
+		// TILED stores 8x8 blocks contiguously, so vertical neighbours stay close
+		// for rotated and scaled reads. Tiled sprites cannot be drawn into
+		enum class Layout { LINEAR, TILED };
 
 	public:
 		void SetSampleMode(alo::Sprite::Mode mode = alo::Sprite::Mode::NORMAL);
@@ -453,16 +579,254 @@ namespace alo
 		bool  SetPixel(const alo::vi2d& a, Pixel p);
 		Pixel Sample(float x, float y) const;
 		Pixel SampleBL(float u, float v) const;
+		// Batched sampling of normalised coordinates, bilinear batches clamp
+		// to edge and interpolate all four channels in 8-bit fixed point
+		void Sample(const alo::vf2d* uv, alo::Pixel* out, size_t count) const;
+		void Sample(const std::vector<alo::vf2d>& uv, std::vector<alo::Pixel>& out) const;
+		void SampleBL(const alo::vf2d* uv, alo::Pixel* out, size_t count) const;
+		void SampleBL(const std::vector<alo::vf2d>& uv, std::vector<alo::Pixel>& out) const;
+		// Resamples this sprite to fill dst, which must be linear. Rows [y0, y1)
+		// only, so the work can be split across threads, y1 = -1 means to the bottom
+		void ResampleTo(alo::Sprite* dst, alo::Sprite::Filter filter = alo::Sprite::Filter::BILINEAR, int32_t y0 = 0, int32_t y1 = -1) const;
+		// Raw storage, in the sprite's layout
 		Pixel* GetData();
+		// Moves the pixels to new storage, so earlier views of the sprite are left
+		// dangling. Change the engine's draw target through GameEngine::SetSpriteLayout()
+		void SetLayout(alo::Sprite::Layout layout);
+		alo::Sprite::Layout GetLayout() const { return layout; }
+		// Storage offset of a pixel, which must be inside the sprite. The row and
+		// column parts are separable so samplers can reuse them across a footprint
+		size_t RowOffset(int32_t y) const
+		{
+			if (layout == Layout::LINEAR) return size_t(y) * size_t(width);
+			return ((size_t(y >> 3) * size_t(nTilesX)) << 6) | size_t((y & 7) << 3);
+		}
+		size_t ColOffset(int32_t x) const
+		{
+			if (layout == Layout::LINEAR) return size_t(x);
+			return (size_t(x >> 3) << 6) | size_t(x & 7);
+		}
+		size_t Index(int32_t x, int32_t y) const { return RowOffset(y) + ColOffset(x); }
+		// Copies n pixels of row y starting at x into dst, whatever the layout
+		void ReadRow(int32_t x, int32_t y, int32_t n, alo::Pixel* dst) const;
 		alo::Sprite* Duplicate();
 		alo::Sprite* Duplicate(const alo::vi2d& vPos, const alo::vi2d& vSize);
 		alo::vi2d Size() const;
-		std::vector<alo::Pixel> pColData;
+		// Non-owning views of the pixel data, sub-rectangles are clipped to the
+		// sprite. Tiled sprites return an empty view
+		alo::SpriteView View();
+		alo::SpriteView View(const alo::vi2d& vPos, const alo::vi2d& vSize);
+		alo::PixelBuffer pColData;
 		Mode modeSample = Mode::NORMAL;
 
 		static std::unique_ptr<alo::ImageLoader> loader;
+
+	private:
+		Layout layout = Layout::LINEAR;
+		int32_t nTilesX = 0;
+	};
+
+	// O------------------------------------------------------------------------------O
+	// | alo::SpriteView - Non-owning window onto rows of alo::Pixel                  |
+	// O------------------------------------------------------------------------------O
+	// Rows are stride pixels apart, so a view can be a sub-rectangle of a sprite,
+	// padded rows for SIMD, or memory owned by someone else entirely. The view
+	// must not outlive the memory it points at.
+	struct SpriteView
+	{
+		alo::Pixel* data = nullptr;
+		int32_t width = 0;
+		int32_t height = 0;
+		int32_t stride = 0;
+
+		SpriteView() = default;
+		SpriteView(alo::Pixel* data, int32_t w, int32_t h, int32_t stride = 0);
+
+		alo::Pixel* Row(int32_t y) const { return data + size_t(y) * size_t(stride); }
+		bool IsValid() const { return data != nullptr && width > 0 && height > 0; }
+		bool IsContiguous() const { return stride == width; }
+		bool IsAligned(size_t nBytes = 64) const;
+		alo::vi2d Size() const { return { width, height }; }
+		// Sub-rectangle of this view, clipped to it
+		alo::SpriteView SubView(const alo::vi2d& vPos, const alo::vi2d& vSize) const;
+		// Smallest stride >= w whose rows start on nBytes boundaries
+		static int32_t AlignedStride(int32_t w, size_t nBytes = 64);
+	};
+
+	// O------------------------------------------------------------------------------O
+	// | alo::Transform2D - Affine transform of 2D points                             |
+	// O------------------------------------------------------------------------------O
+	// Each operation is applied after the ones before it, so rotating a sprite
+	// about its centre is Translate(-c), Rotate(a), Translate(pos)
+	class Transform2D
+	{
+	public:
+		Transform2D();
+
+	public:
+		void Reset();
+		void Translate(float x, float y);
+		void Rotate(float fTheta);
+		void Scale(float x, float y);
+		void Shear(float x, float y);
+		void Append(const alo::Transform2D& t);
+		// Returns false, leaving the result unchanged, if the transform has no inverse
+		bool Inverse(alo::Transform2D& out) const;
+		alo::vf2d Forward(const alo::vf2d& p) const;
+
+	public:
+		float m[2][3];
+	};
+
+	// O------------------------------------------------------------------------------O
+	// | alo::SpriteT - A CPU image stored in a compact pixel format                  |
+	// O------------------------------------------------------------------------------O
+	// Single channel formats take the red channel and are shown as grey, RG8
+	// keeps red and green. Conversions to and from alo::Pixel run a row at a time.
+	enum class PixelFormat : uint8_t { R8, RG8, RGB565, RGBA8, R32F };
+
+	template<alo::PixelFormat F> struct PixelFormatTraits;
+
+	template<> struct PixelFormatTraits<alo::PixelFormat::R8>
+	{
+		using type = uint8_t;
+		static type Pack(const alo::Pixel& p) { return p.r; }
+		static alo::Pixel Unpack(type v) { return alo::Pixel(v, v, v); }
+		static void PackRow(const alo::Pixel* src, type* dst, int32_t n)
+		{
+			int32_t i = 0;
+#if defined(ALO_SIMD_SSE2)
+			const __m128i vMask = _mm_set1_epi32(0xFF);
+			for (; i + 16 <= n; i += 16)
+			{
+				__m128i a = _mm_and_si128(_mm_loadu_si128((const __m128i*)(src + i + 0)), vMask);
+				__m128i b = _mm_and_si128(_mm_loadu_si128((const __m128i*)(src + i + 4)), vMask);
+				__m128i c = _mm_and_si128(_mm_loadu_si128((const __m128i*)(src + i + 8)), vMask);
+				__m128i d = _mm_and_si128(_mm_loadu_si128((const __m128i*)(src + i + 12)), vMask);
+				_mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+			}
+#endif
+			for (; i < n; i++) dst[i] = src[i].r;
+		}
+		static void UnpackRow(const type* src, alo::Pixel* dst, int32_t n)
+		{
+			int32_t i = 0;
+#if defined(ALO_SIMD_SSE2)
+			const __m128i vAlpha = _mm_set1_epi32(int32_t(0xFF000000));
+			for (; i + 16 <= n; i += 16)
+			{
+				__m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+				__m128i lo = _mm_unpacklo_epi8(v, v), hi = _mm_unpackhi_epi8(v, v);
+				_mm_storeu_si128((__m128i*)(dst + i + 0), _mm_or_si128(_mm_unpacklo_epi16(lo, lo), vAlpha));
+				_mm_storeu_si128((__m128i*)(dst + i + 4), _mm_or_si128(_mm_unpackhi_epi16(lo, lo), vAlpha));
+				_mm_storeu_si128((__m128i*)(dst + i + 8), _mm_or_si128(_mm_unpacklo_epi16(hi, hi), vAlpha));
+				_mm_storeu_si128((__m128i*)(dst + i + 12), _mm_or_si128(_mm_unpackhi_epi16(hi, hi), vAlpha));
+			}
+#endif
+			for (; i < n; i++) dst[i] = Unpack(src[i]);
+		}
+	};
+
+	template<> struct PixelFormatTraits<alo::PixelFormat::RG8>
+	{
+		struct type { uint8_t r = 0, g = 0; };
+		static type Pack(const alo::Pixel& p) { return { p.r, p.g }; }
+		static alo::Pixel Unpack(type v) { return alo::Pixel(v.r, v.g, 0); }
+		static void PackRow(const alo::Pixel* src, type* dst, int32_t n) { for (int32_t i = 0; i < n; i++) dst[i] = Pack(src[i]); }
+		static void UnpackRow(const type* src, alo::Pixel* dst, int32_t n) { for (int32_t i = 0; i < n; i++) dst[i] = Unpack(src[i]); }
+	};
+
+	template<> struct PixelFormatTraits<alo::PixelFormat::RGB565>
+	{
+		using type = uint16_t;
+		static type Pack(const alo::Pixel& p) { return type(((p.r >> 3) << 11) | ((p.g >> 2) << 5) | (p.b >> 3)); }
+		static alo::Pixel Unpack(type v)
+		{
+			uint8_t r = uint8_t(v >> 11), g = uint8_t((v >> 5) & 0x3F), b = uint8_t(v & 0x1F);
+			return alo::Pixel(uint8_t((r << 3) | (r >> 2)), uint8_t((g << 2) | (g >> 4)), uint8_t((b << 3) | (b >> 2)));
+		}
+		static void PackRow(const alo::Pixel* src, type* dst, int32_t n) { for (int32_t i = 0; i < n; i++) dst[i] = Pack(src[i]); }
+		static void UnpackRow(const type* src, alo::Pixel* dst, int32_t n) { for (int32_t i = 0; i < n; i++) dst[i] = Unpack(src[i]); }
+	};
+
+	template<> struct PixelFormatTraits<alo::PixelFormat::RGBA8>
+	{
+		using type = alo::Pixel;
+		static type Pack(const alo::Pixel& p) { return p; }
+		static alo::Pixel Unpack(type v) { return v; }
+		static void PackRow(const alo::Pixel* src, type* dst, int32_t n) { std::memcpy(dst, src, size_t(n) * sizeof(type)); }
+		static void UnpackRow(const type* src, alo::Pixel* dst, int32_t n) { std::memcpy(dst, src, size_t(n) * sizeof(type)); }
+	};
+
+	template<> struct PixelFormatTraits<alo::PixelFormat::R32F>
+	{
+		using type = float;
+		static type Pack(const alo::Pixel& p) { return float(p.r) / 255.0f; }
+		static alo::Pixel Unpack(type v) { uint8_t c = uint8_t(std::clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f); return alo::Pixel(c, c, c); }
+		static void PackRow(const alo::Pixel* src, type* dst, int32_t n) { for (int32_t i = 0; i < n; i++) dst[i] = Pack(src[i]); }
+		static void UnpackRow(const type* src, alo::Pixel* dst, int32_t n) { for (int32_t i = 0; i < n; i++) dst[i] = Unpack(src[i]); }
+	};
+
+	template<alo::PixelFormat F>
+	class SpriteT
+	{
+	public:
+		using Traits = alo::PixelFormatTraits<F>;
+		using value_type = typename Traits::type;
+		static constexpr alo::PixelFormat format = F;
+
+		SpriteT() = default;
+		SpriteT(int32_t w, int32_t h) : width(w), height(h), vData(size_t(w) * size_t(h)) {}
+		explicit SpriteT(const alo::SpriteView& src) { Convert(src); }
+
+	public:
+		int32_t width = 0;
+		int32_t height = 0;
+		std::vector<value_type> vData;
+
+	public:
+		value_type* GetData() { return vData.data(); }
+		const value_type* GetData() const { return vData.data(); }
+		alo::vi2d Size() const { return { width, height }; }
+		size_t SizeInBytes() const { return vData.size() * sizeof(value_type); }
+
+		alo::Pixel GetPixel(int32_t x, int32_t y) const
+		{
+			if (x >= 0 && x < width && y >= 0 && y < height)
+				return Traits::Unpack(vData[size_t(y) * width + x]);
+			return alo::Pixel(0, 0, 0, 0);
+		}
+
+		bool SetPixel(int32_t x, int32_t y, alo::Pixel p)
+		{
+			if (x < 0 || x >= width || y < 0 || y >= height) return false;
+			vData[size_t(y) * width + x] = Traits::Pack(p);
+			return true;
+		}
+
+		// Resizes to match and packs the RGBA pixels of src
+		void Convert(const alo::SpriteView& src)
+		{
+			width = src.width; height = src.height;
+			vData.resize(size_t(width) * size_t(height));
+			for (int32_t y = 0; y < height; y++)
+				Traits::PackRow(src.Row(y), &vData[size_t(y) * width], width);
+		}
+
+		// Unpacks into dst, which is clipped to this sprite
+		void Expand(const alo::SpriteView& dst) const
+		{
+			int32_t w = std::min(width, dst.width), h = std::min(height, dst.height);
+			for (int32_t y = 0; y < h; y++)
+				Traits::UnpackRow(&vData[size_t(y) * width], dst.Row(y), w);
+		}
 	};
 
+	using SpriteR8 = alo::SpriteT<alo::PixelFormat::R8>;
+	using SpriteRG8 = alo::SpriteT<alo::PixelFormat::RG8>;
+	using SpriteRGB565 = alo::SpriteT<alo::PixelFormat::RGB565>;
+	using SpriteR32F = alo::SpriteT<alo::PixelFormat::R32F>;
+
 	// O------------------------------------------------------------------------------O
 	// | alo::Decal - A GPU resident storage of an alo::Sprite                        |
 	// O------------------------------------------------------------------------------O
@@ -471,14 +835,35 @@ namespace alo
 	public:
 		Decal(alo::Sprite* spr, bool filter = false, bool clamp = true);
 		Decal(const uint32_t nExistingTextureResource, alo::Sprite* spr);
+		// Part of another decal's texture, which stays owned by that decal
+		Decal(const alo::Decal& parent, const alo::vi2d& pos, const alo::vi2d& size);
+		// Texture only decal fed from a compact format sprite, it has no alo::Sprite
+		template<alo::PixelFormat F> Decal(const alo::SpriteT<F>& spr, bool filter = false, bool clamp = true);
+		// Blank decal the GPU draws into, see GameEngine::SetDecalTarget. What is
+		// drawn stays from frame to frame. It has no alo::Sprite
+		Decal(const alo::vi2d& size, bool filter = false);
 		virtual ~Decal();
 		void Update();
+		// Uploads just part of the owned sprite
+		void Update(const alo::vi2d& pos, const alo::vi2d& size);
+		// Uploads the view in place of the owned sprite, size may differ
+		void Update(const alo::SpriteView& view);
+		template<alo::PixelFormat F> void Update(const alo::SpriteT<F>& spr);
 		void UpdateSprite();
 
 	public: // But dont touch
 		int32_t id = -1;
 		alo::Sprite* sprite = nullptr;
 		alo::vf2d vUVScale = { 1.0f, 1.0f };
+		alo::vi2d vSize = { 0, 0 };
+		// Where the image sits in its texture, in normalised coordinates
+		alo::vf2d vUVOffset = { 0.0f, 0.0f };
+		alo::vf2d vUVExtent = { 1.0f, 1.0f };
+		bool bOwnsTexture = true;
+		// Framebuffer drawing into the texture, 0 if it is not a target
+		uint32_t nTarget = 0;
+		// Engine queuing decals for this target, which clears it on letting go
+		alo::GameEngine* pTargetOwner = nullptr;
 	};
 
 	enum class DecalMode
@@ -500,6 +885,9 @@ namespace alo
 		LIST
 	};
 
+	// In a decal's indices, ends the current line, fan or strip and starts another
+	constexpr uint32_t nDecalRestart = 0xFFFFFFFF;
+
 	// O------------------------------------------------------------------------------O
 	// | alo::Renderable - Convenience class to keep a sprite and decal together      |
 	// O------------------------------------------------------------------------------O
@@ -519,34 +907,331 @@ namespace alo
 		std::unique_ptr<alo::Decal> pDecal = nullptr;
 	};
 
+	// O------------------------------------------------------------------------------O
+	// | alo::DecalAtlas - Many small images packed onto shared decal pages           |
+	// O------------------------------------------------------------------------------O
+	// Images are placed by a skyline packer and each is returned as a decal over
+	// its rectangle of a page, so decals from one page share a texture and batch
+	// into a single draw. Entries belong to the atlas and live as long as it does
+	class DecalAtlas
+	{
+	public:
+		// Pages are added as they fill, up to nMaxPages if it is above zero
+		DecalAtlas(int32_t nPageSize = 1024, bool filter = false, int32_t nPadding = 1, int32_t nMaxPages = 0);
+		// Packs a copy of the image, nullptr if it is empty, larger than a page,
+		// or fits on no page when no more may be added
+		alo::Decal* Add(const alo::SpriteView& view);
+		alo::Decal* Add(alo::Sprite* spr);
+		// Replaces an entry's pixels with a same sized image, uploading only its rectangle
+		void Update(const alo::Decal* entry, const alo::SpriteView& view);
+		void Clear();
+		size_t PageCount() const { return vPages.size(); }
+		alo::Decal* Page(size_t i) const { return vPages[i]->image.Decal(); }
+
+	private:
+		// The skyline is the height of the packed area across the page, as
+		// spans ordered left to right
+		struct Span { int32_t x, y, w; };
+		struct AtlasPage
+		{
+			alo::Renderable image;
+			std::vector<Span> vSkyline;
+		};
+		struct Entry
+		{
+			std::unique_ptr<alo::Decal> decal;
+			AtlasPage* page = nullptr;
+			alo::vi2d pos;
+		};
+
+		bool Place(AtlasPage& page, const alo::vi2d& size, alo::vi2d& pos) const;
+		void Write(AtlasPage& page, const alo::vi2d& pos, const alo::SpriteView& view);
+
+		int32_t nPageSize;
+		int32_t nPadding;
+		int32_t nMaxPages;
+		bool bFilter;
+		std::vector<std::unique_ptr<AtlasPage>> vPages;
+		std::map<const alo::Decal*, Entry> mapEntries;
+	};
+
 
 	// O------------------------------------------------------------------------------O
 	// | Auxilliary components internal to engine                                     |
 	// O------------------------------------------------------------------------------O
 
+	// One vertex of decal geometry. Laid out as the renderers' vertex buffers
+	// expect, so a layer's stream can be uploaded as it is
+	struct DecalVertex
+	{
+		alo::vf2d pos;			// Normalised device coordinates
+		float w = 1.0f;			// Perspective divisor, uv is premultiplied by it
+		alo::vf2d uv;
+		alo::Pixel tint = alo::WHITE;
+	};
+
+	// One quad of an instanced decal draw, the parallelogram pos + u * axisX +
+	// v * axisY for u and v in [0, 1], showing the part of the decal from uv to
+	// uv + uvSize. Given in screen pixels and normalised decal coordinates; in a
+	// DecalStream they are already device and texture coordinates
+	struct QuadInstance
+	{
+		alo::vf2d pos;
+		alo::vf2d axisX = { 1.0f, 0.0f };
+		alo::vf2d axisY = { 0.0f, 1.0f };
+		alo::vf2d uv = { 0.0f, 0.0f };
+		alo::vf2d uvSize = { 1.0f, 1.0f };
+		alo::Pixel tint = alo::WHITE;
+	};
+
+	// A draw command over points vertices of its layer's DecalStream, from offset.
+	// If indices is non zero the structure is assembled from that many of the
+	// stream's indices, from firstIndex, rather than the vertices in order.
+	// Instanced commands have no vertices and draw instances quads from the
+	// stream's instance data instead, offset indexing that
 	struct DecalInstance
 	{
 		alo::Decal* decal = nullptr;
-		std::vector<alo::vf2d> pos;
-		std::vector<alo::vf2d> uv;
-		std::vector<float> w;
-		std::vector<alo::Pixel> tint;
 		alo::DecalMode mode = alo::DecalMode::NORMAL;
 		alo::DecalStructure structure = alo::DecalStructure::FAN;
+		uint32_t offset = 0;
 		uint32_t points = 0;
+		uint32_t instances = 0;
+		uint32_t firstIndex = 0;
+		uint32_t indices = 0;
+	};
+
+	// Whether a decal draws as lines: wireframe outlines, or the LINE structure
+	bool DecalIsLines(const alo::DecalInstance& decal);
+	// Appends the decal's primitives to vOut as a plain triangle list, or line list
+	// if DecalIsLines, each index relative to its first vertex plus nBase. Renderers
+	// use it to draw every structure, indexed or not, with one primitive type
+	void UnrollDecal(const alo::DecalInstance& decal, const uint32_t* pIndices, uint32_t nBase, std::vector<uint32_t>& vOut);
+	// Splits nUnrolled indices from UnrollDecal into runs of whole primitives, each
+	// at most nMax indices, calling f(first, count) on each in order. Returns the runs
+	uint32_t ChunkDecal(const alo::DecalInstance& decal, size_t nUnrolled, size_t nMax, const std::function<void(size_t, size_t)>& f);
+
+	// A layer's decals for one frame: commands over a single interleaved vertex
+	// stream. Clearing keeps the storage, so once a steady frame has been seen
+	// submitting decals allocates nothing
+	class DecalStream
+	{
+	public:
+		// Appends a command of nPoints vertices, returned for the caller to fill.
+		// Valid until the next Push
+		alo::DecalVertex* Push(alo::Decal* decal, alo::DecalMode mode, alo::DecalStructure structure, uint32_t nPoints);
+		// Appends an instanced command of nInstances quads, likewise returned to fill
+		alo::QuadInstance* PushInstances(alo::Decal* decal, alo::DecalMode mode, uint32_t nInstances);
+		// Gives the last command nIndices indices into its vertices, returned to fill
+		uint32_t* PushIndices(uint32_t nIndices);
+		void Clear() { vVertices.clear(); vInstances.clear(); vIndices.clear(); vCommands.clear(); }
+		bool IsEmpty() const { return vCommands.empty(); }
+		size_t Count() const { return vCommands.size(); }
+		const alo::DecalInstance& operator[](size_t i) const { return vCommands[i]; }
+		std::vector<alo::DecalInstance>::const_iterator begin() const { return vCommands.begin(); }
+		std::vector<alo::DecalInstance>::const_iterator end() const { return vCommands.end(); }
+		const alo::DecalVertex* Vertices(const alo::DecalInstance& d) const { return vVertices.data() + d.offset; }
+		const std::vector<alo::DecalVertex>& GetVertices() const { return vVertices; }
+		const alo::QuadInstance* Instances(const alo::DecalInstance& d) const { return vInstances.data() + d.offset; }
+		const std::vector<alo::QuadInstance>& GetInstances() const { return vInstances; }
+		// The command's indices, nullptr if it has none
+		const uint32_t* Indices(const alo::DecalInstance& d) const { return d.indices > 0 ? vIndices.data() + d.firstIndex : nullptr; }
+
+	private:
+		std::vector<alo::DecalVertex> vVertices;
+		std::vector<alo::QuadInstance> vInstances;
+		std::vector<uint32_t> vIndices;
+		std::vector<alo::DecalInstance> vCommands;
+	};
+
+	// A run of a window's unrolled indices drawn with one call
+	struct DecalBatch
+	{
+		uint32_t nTexture;
+		alo::DecalMode mode;
+		bool bLines;
+		size_t nFirstIndex;
+		size_t nIndices;
+	};
+
+	// How PlanDecals cuts a layer up for a renderer that streams through buffers
+	// of fixed size: the most one write may hold, and what to do with each piece
+	struct DecalPlan
+	{
+		size_t nMaxVertices = 0;
+		size_t nMaxIndices = 0;
+		size_t nMaxInstances = 0;
+		std::function<uint32_t(const alo::DecalInstance&)> texture;
+		// Stream vertices [nFirst, nFirst + nVertices) and draw vBatches, whose
+		// indices are relative to nFirst, so nFirst's place is the base vertex
+		std::function<void(size_t nFirst, size_t nVertices, const std::vector<uint32_t>& vIndices, const std::vector<alo::DecalBatch>& vBatches)> window;
+		// A decal too big for any window, its primitives relative to its first vertex
+		std::function<void(const alo::DecalInstance& decal, uint32_t nTexture, const std::vector<uint32_t>& vUnrolled)> chunked;
+		// At most nMaxInstances quads, contiguous in the instance stream
+		std::function<void(uint32_t nTexture, alo::DecalMode mode, const alo::QuadInstance* pInstances, size_t nInstances)> instanced;
+	};
+
+	// Draws a layer through plan in order. Runs of commands whose vertices fit the
+	// limits become windows, neighbours in one sharing texture, mode and primitive
+	// type become one batch, and runs of instanced commands sharing texture and
+	// mode are drawn together
+	void PlanDecals(const alo::DecalStream& decals, const alo::DecalPlan& plan);
+
+	struct FontGlyph
+	{
+		uint8_t rows[8] = { 0 };	// Bit i of rows[j] is set if texel (i,j) is lit
+		uint8_t offset = 0;			// First column used when drawn proportionally
+		uint8_t width = 8;			// Number of columns used when drawn proportionally
+	};
+
+	// O------------------------------------------------------------------------------O
+	// | alo::DirtyRegion - A few rectangles covering the pixels changed on a layer   |
+	// O------------------------------------------------------------------------------O
+	// Rectangles are half open. Touching rectangles are merged, and once the set is
+	// full a new one is merged into whichever existing rectangle grows least
+	class DirtyRegion
+	{
+	public:
+		struct Rect { int32_t x0 = 0, y0 = 0, x1 = 0, y1 = 0; };
+
+	public:
+		void Add(int32_t x0, int32_t y0, int32_t x1, int32_t y1);
+		void Clear() { nCount = 0; nLast = 0; }
+		bool IsEmpty() const { return nCount == 0; }
+		size_t Count() const { return nCount; }
+		const Rect& operator[](size_t i) const { return vRects[i]; }
+
+	private:
+		static constexpr size_t nMaxRects = 8;
+		std::array<Rect, nMaxRects> vRects;
+		size_t nCount = 0;
+		size_t nLast = 0;
 	};
 
+	// O------------------------------------------------------------------------------O
+	// | alo::Raster - CPU primitives that draw straight into a view                  |
+	// O------------------------------------------------------------------------------O
+	// These touch nothing but the view and pen given, so worker threads can draw
+	// into their own views in parallel. Each returns the clipped area it wrote to.
+	namespace Raster
+	{
+		// How drawn pixels combine with the target, as GameEngine::SetPixelMode()
+		struct Pen
+		{
+			alo::Pixel::Mode mode = alo::Pixel::NORMAL;
+			float fBlendFactor = 1.0f;
+			std::function<alo::Pixel(const int x, const int y, const alo::Pixel&, const alo::Pixel&)> funcPixelMode;
+		};
+
+		// Joins points with lines, each joint drawn once. Segment i, from point i
+		// to point i + 1, takes colour i modulo nColours
+		alo::DirtyRegion::Rect DrawPolyline(const alo::SpriteView& target, const alo::vf2d* pPoints, size_t nPoints,
+			const alo::Pixel* pColours, size_t nColours, const alo::Raster::Pen& pen = alo::Raster::Pen());
+		alo::DirtyRegion::Rect DrawPoints(const alo::SpriteView& target, const alo::vi2d* pPoints, size_t nPoints,
+			alo::Pixel p, const alo::Raster::Pen& pen = alo::Raster::Pen());
+
+		enum class Join : uint8_t { ROUND, MITER };
+
+		// Draws an anti-aliased line fWidth pixels wide through the points, with round
+		// ends. Miters longer than fMiterLimit stroke widths are drawn round instead.
+		// Overlapping parts of the stroke are only blended once. Pixel::NORMAL and
+		// Pixel::MASK blend edge coverage as if the colour were opaque.
+		alo::DirtyRegion::Rect DrawStroke(const alo::SpriteView& target, const alo::vf2d* pPoints, size_t nPoints, float fWidth,
+			alo::Pixel p, alo::Raster::Join join = alo::Raster::Join::ROUND, const alo::Raster::Pen& pen = alo::Raster::Pen(), float fMiterLimit = 4.0f);
+
+		class Stroke;
+
+		// Adds vPoint to a round joined stroke and draws the segment to it from the
+		// previous point. Pixels the earlier segments covered are only blended up to
+		// the coverage of the stroke as a whole, so a stroke drawn a segment at a time
+		// at one width matches DrawStroke() through its points, without darker joints.
+		alo::DirtyRegion::Rect ExtendStroke(const alo::SpriteView& target, alo::Raster::Stroke& stroke, const alo::vf2d& vPoint,
+			float fWidth, alo::Pixel p, const alo::Raster::Pen& pen = alo::Raster::Pen());
+
+		// The points of a stroke drawn by ExtendStroke(). Segments are filed in a grid
+		// of cells, so each extension only visits the earlier segments near it. A
+		// stroke that does not keep going back over itself costs the same per segment
+		// however long it grows, rather than O(N^2) to draw over N segments
+		class Stroke
+		{
+		public:
+			// Forgets the points, to start a new stroke
+			void Clear();
+			const std::vector<alo::vf2d>& Points() const { return vPoints; }
+
+		private:
+			friend alo::DirtyRegion::Rect ExtendStroke(const alo::SpriteView&, alo::Raster::Stroke&, const alo::vf2d&,
+				float, alo::Pixel, const alo::Raster::Pen&);
+			static constexpr int32_t nCellSize = 64;
+			std::vector<alo::vf2d> vPoints;
+			// Segments reaching into each cell, keyed by the cell's packed coordinates
+			std::map<uint64_t, std::vector<uint32_t>> mapCells;
+			// Marks segments already gathered for the current extension
+			std::vector<uint32_t> vVisited;
+			uint32_t nVisit = 0;
+		};
+
+		// Fills the 4-connected area of pixels matching the one at vSeed. Channels
+		// within nTolerance of the seed's count as matching
+		alo::DirtyRegion::Rect FloodFill(const alo::SpriteView& target, const alo::vi2d& vSeed, alo::Pixel p,
+			uint8_t nTolerance = 0, const alo::Raster::Pen& pen = alo::Raster::Pen());
+
+		enum class FillRule : uint8_t { NONZERO, EVEN_ODD };
+
+		// Fills the closed polygon through the points, which may be concave and
+		// cross itself. Pixels are inside if their centre is, by the fill rule
+		alo::DirtyRegion::Rect FillPolygon(const alo::SpriteView& target, const alo::vf2d* pPoints, size_t nPoints, alo::Pixel p,
+			alo::Raster::FillRule rule = alo::Raster::FillRule::NONZERO, const alo::Raster::Pen& pen = alo::Raster::Pen());
+
+		enum class Downsampler : uint8_t { BOX, LANCZOS };
+
+		// Filters src, n times the size of dst in each axis, down into the part r of
+		// dst. BOX averages each n x n block. LANCZOS is two lobed, reading up to 2n
+		// pixels around each block, clamped to the edges of src
+		void Downsample(const alo::SpriteView& src, const alo::SpriteView& dst, int32_t n,
+			alo::Raster::Downsampler filter, const alo::DirtyRegion::Rect& r);
+
+		// BOX is a single box pass per axis, up to 64 pixels reach. GAUSSIAN is three
+		// box passes per axis whose reaches add up to the radius, up to 192 pixels,
+		// giving a sigma of about a third of the radius
+		enum class BlurKernel : uint8_t { BOX, GAUSSIAN };
+
+		// How far either side of a pixel Blur reads, after clamping nRadius
+		int32_t BlurReach(int32_t nRadius, alo::Raster::BlurKernel kernel);
+
+		// Blurs src into the part r of dst, the same size as src and free to be the
+		// same sprite. Reads reach nRadius pixels around r, clamped to the edges of
+		// src. Rows, then columns, are split across ParallelRows
+		void Blur(const alo::SpriteView& src, const alo::SpriteView& dst, int32_t nRadius,
+			alo::Raster::BlurKernel kernel, const alo::DirtyRegion::Rect& r);
+		// As Blur, but adds the blur scaled by fStrength onto src, saturating
+		void Glow(const alo::SpriteView& src, const alo::SpriteView& dst, int32_t nRadius,
+			alo::Raster::BlurKernel kernel, float fStrength, const alo::DirtyRegion::Rect& r);
+	}
+
 	struct LayerDesc
 	{
 		alo::vf2d vOffset = { 0, 0 };
 		alo::vf2d vScale = { 1, 1 };
 		bool bShow = false;
+		// Forces the whole layer to upload. Otherwise only regions the drawing
+		// routines have touched, recorded in dirty, are uploaded
 		bool bUpdate = false;
+		alo::DirtyRegion dirty;
 		alo::Renderable pDrawTarget;
 		uint32_t nResID = 0;
-		std::vector<DecalInstance> vecDecalInstance;
+		alo::DecalStream decals;
 		alo::Pixel tint = alo::WHITE;
 		std::function<void()> funcHook = nullptr;
+		// Glow post-process, see GameEngine::SetLayerGlow. When enabled the layer
+		// is presented from pGlow, its sprite with the blur added on top
+		int32_t nGlowRadius = 0;
+		float fGlowStrength = 1.0f;
+		alo::Raster::BlurKernel glowKernel = alo::Raster::BlurKernel::GAUSSIAN;
+		std::unique_ptr<alo::Sprite> pGlow;
+		// See GameEngine::SetLayerCanvas. When set the layer's decals are drawn
+		// into it, where they stay, and it is presented over the layer's sprite
+		std::unique_ptr<alo::Decal> pCanvas;
 	};
 
 	class Renderer
@@ -560,15 +1245,60 @@ namespace alo
 		virtual void       PrepareDrawing() = 0;
 		virtual void	   SetDecalMode(const alo::DecalMode& mode) = 0;
 		virtual void       DrawLayerQuad(const alo::vf2d& offset, const alo::vf2d& scale, const alo::Pixel tint) = 0;
-		virtual void       DrawDecal(const alo::DecalInstance& decal) = 0;
+		// pVertices is the decal's first vertex, pIndices its indices or nullptr
+		virtual void       DrawDecal(const alo::DecalInstance& decal, const alo::DecalVertex* pVertices, const uint32_t* pIndices) = 0;
+		// Draws a layer's decals in order. Renderers able to merge neighbouring
+		// decals into fewer draw calls override this, by default each decal goes
+		// through DrawDecal
+		virtual void       DrawDecals(const alo::DecalStream& decals);
+		// Draws an instanced command's quads, by default one DrawDecal each
+		virtual void       DrawInstances(const alo::DecalInstance& decal, const alo::QuadInstance* pInstances);
 		virtual uint32_t   CreateTexture(const uint32_t width, const uint32_t height, const bool filtered = false, const bool clamp = true) = 0;
 		virtual void       UpdateTexture(uint32_t id, alo::Sprite* spr) = 0;
+		virtual void       UpdateTexture(uint32_t id, const alo::SpriteView& view);
+		// Updates part of a texture already sized to match the sprite
+		virtual void       UpdateTexture(uint32_t id, alo::Sprite* spr, const alo::vi2d& pos, const alo::vi2d& size);
+		// Uploads compact format pixels, stride in elements. Renderers without a
+		// matching texture format expand to RGBA first
+		virtual void       UpdateTexture(uint32_t id, alo::PixelFormat format, const void* data, int32_t w, int32_t h, int32_t stride);
 		virtual void       ReadTexture(uint32_t id, alo::Sprite* spr) = 0;
+		// Reads a region of the frame being drawn into spr, sized to match, rows top
+		// down. Returns false on renderers that cannot read the frame back
+		virtual bool       ReadFrame(const alo::vi2d& pos, const alo::vi2d& size, alo::Sprite* spr) { UNUSED(pos); UNUSED(size); UNUSED(spr); return false; }
+		// Reads back a region of the frame being drawn, rows top down, handing the
+		// pixels to callback once they arrive, frames later on renderers that can
+		// read without stalling. By default the read is an immediate ReadFrame, and
+		// callback is never called if that fails
+		virtual void       ReadFrameAsync(const alo::vi2d& pos, const alo::vi2d& size, std::function<void(alo::Sprite&)> callback);
+		// Delivers the reads that have arrived, bWait waiting for all of them
+		virtual void       PollReadbacks(bool bWait) { UNUSED(bWait); }
 		virtual uint32_t   DeleteTexture(const uint32_t id) = 0;
 		virtual void       ApplyTexture(uint32_t id) = 0;
+		// Gives texture id storage of size and a framebuffer drawing into it, which
+		// is returned, 0 on renderers without render targets
+		virtual uint32_t   CreateTarget(uint32_t id, const alo::vi2d& size) { UNUSED(id); UNUSED(size); return 0; }
+		virtual void       DeleteTarget(uint32_t target) { UNUSED(target); }
+		// Draws into a framebuffer from CreateTarget, of size, or the screen for 0
+		virtual void       ApplyTarget(uint32_t target, const alo::vi2d& size) { UNUSED(target); UNUSED(size); }
 		virtual void       UpdateViewport(const alo::vi2d& pos, const alo::vi2d& size) = 0;
 		virtual void       ClearBuffer(alo::Pixel p, bool bDepth) = 0;
 		static alo::GameEngine* ptrGE;
+
+	public:
+		// Decal work done by DrawDecals in a frame
+		struct FrameStats
+		{
+			uint32_t nDecals = 0;		// Decal instances submitted
+			uint32_t nDrawCalls = 0;	// Draw calls issued for them
+			uint32_t nVertices = 0;		// Vertices uploaded for them
+		};
+		// The last complete frame
+		const FrameStats& GetFrameStats() const { return statsLast; }
+		// Called once each frame has been drawn
+		void EndFrameStats() { statsLast = stats; stats = FrameStats(); }
+
+	protected:
+		FrameStats stats, statsLast;
 	};
 
 	class Platform
@@ -594,6 +1324,22 @@ namespace alo
 	static std::unique_ptr<Platform> platform;
 	static std::map<size_t, uint8_t> mapKeys;
 
+	template<alo::PixelFormat F>
+	Decal::Decal(const alo::SpriteT<F>& spr, bool filter, bool clamp)
+	{
+		id = renderer->CreateTexture(spr.width, spr.height, filter, clamp);
+		Update(spr);
+	}
+
+	template<alo::PixelFormat F>
+	void Decal::Update(const alo::SpriteT<F>& spr)
+	{
+		vSize = spr.Size();
+		vUVScale = { 1.0f / float(spr.width), 1.0f / float(spr.height) };
+		renderer->ApplyTexture(id);
+		renderer->UpdateTexture(id, F, spr.GetData(), spr.width, spr.height, spr.width);
+	}
+
 	// O------------------------------------------------------------------------------O
 	// | alo::GameEngine - The main BASE class for your application                   |
 	// O------------------------------------------------------------------------------O
@@ -649,15 +1395,35 @@ namespace alo
 		int32_t GetDrawTargetWidth() const;
 		// Returns the height of the currently selected drawing target in "pixels"
 		int32_t GetDrawTargetHeight() const;
-		// Returns the currently active draw target
+		// Returns the currently active draw target, nullptr when drawing to a view.
+		// For a supersampled layer 0 this is its canvas
 		alo::Sprite* GetDrawTarget() const;
+		// Returns the pixels the drawing functions currently write to
+		const alo::SpriteView& GetDrawTargetView() const;
+		// Changes a sprite's storage layout. The draw target is held as a view of
+		// linear storage, so tiling it fails and returns false
+		bool SetSpriteLayout(alo::Sprite* sprite, alo::Sprite::Layout layout);
+		// Scratch memory that is reset at the start of every frame
+		alo::FrameArena& GetFrameArena();
+		// Records that an area of the current layer target changed. The drawing
+		// routines do this themselves, so it is only needed after writing to
+		// a layer's pixels directly
+		void MarkDirty(int32_t x, int32_t y, int32_t w, int32_t h);
 		// Resize the primary screen sprite
 		void SetScreenSize(int w, int h);
 		// Specify which Sprite should be the target of drawing functions, use nullptr
-		// to specify the primary screen
+		// to specify the primary screen. Tiled sprites are made linear to be drawn into
 		void SetDrawTarget(Sprite* target);
+		// Draw into memory described by a view, which must stay valid until
+		// the draw target is changed again
+		void SetDrawTarget(const alo::SpriteView& target);
 		// Gets the current Frames Per Second
 		uint32_t GetFPS() const;
+		// Gets decals submitted and the draw calls that drew them, last frame
+		const alo::Renderer::FrameStats& GetRenderStats() const;
+		// Reads the finished screen back without stalling for the GPU, calling
+		// callback with it a frame or two later, on the engine thread
+		void ReadScreenAsync(std::function<void(alo::Sprite&)> callback);
 		// Gets last update of elapsed time
 		float GetElapsedTime() const;
 		// Gets Actual Window size
@@ -679,10 +1445,32 @@ namespace alo
 		void SetLayerScale(uint8_t layer, float x, float y);
 		void SetLayerTint(uint8_t layer, const alo::Pixel& tint);
 		void SetLayerCustomRenderFunction(uint8_t layer, std::function<void()> f);
+		// Presents the layer with a blur of itself added on top, for a glow around
+		// what is drawn. The layer's own pixels are left as they are, and only what
+		// the blur of changed pixels reaches is recomputed. nRadius 0 turns it off
+		void SetLayerGlow(uint8_t layer, int32_t nRadius, float fStrength = 1.0f,
+			alo::Raster::BlurKernel kernel = alo::Raster::BlurKernel::GAUSSIAN);
+
+		// Gives the layer a screen sized decal target its decals are drawn into
+		// instead of being cleared each frame, so they build up. Clear it with
+		// ClearDecalTarget(GetLayers()[layer].pCanvas.get()). Renderers without
+		// targets draw the decals for the one frame as before
+		void SetLayerCanvas(uint8_t layer, bool bCanvas);
 
 		std::vector<LayerDesc>& GetLayers();
 		uint32_t CreateLayer();
 
+		// Keeps layer 0 at n times the screen resolution in each axis, n from 1 to 8.
+		// Drawing to layer 0 stays in screen coordinates: lines, strokes and polygon
+		// fills are rasterised at the finer resolution, other primitives cover n x n
+		// pixels per screen pixel. The canvas is filtered down to the screen as it
+		// is presented
+		void SetSupersample(int32_t n, alo::Raster::Downsampler filter = alo::Raster::Downsampler::BOX);
+		int32_t GetSupersample() const;
+		// Filters any pending changes to the canvas down into layer 0's screen
+		// sized sprite now, and returns that sprite, ready for saving
+		alo::Sprite* ResolveSupersample();
+
 		// Change the pixel mode for different optimisations
 		// alo::Pixel::NORMAL = No transparency
 		// alo::Pixel::MASK   = Transparent if alpha is < 255
@@ -709,6 +1497,17 @@ namespace alo
 		// Fills a circle located at (x,y) with radius
 		void FillCircle(int32_t x, int32_t y, int32_t radius, Pixel p = alo::WHITE);
 		void FillCircle(const alo::vi2d& pos, int32_t radius, Pixel p = alo::WHITE);
+		// Draws an ellipse located at (x,y) with radii (rx,ry)
+		void DrawEllipse(int32_t x, int32_t y, int32_t rx, int32_t ry, Pixel p = alo::WHITE);
+		void DrawEllipse(const alo::vi2d& pos, const alo::vi2d& radius, Pixel p = alo::WHITE);
+		// Fills an ellipse located at (x,y) with radii (rx,ry)
+		void FillEllipse(int32_t x, int32_t y, int32_t rx, int32_t ry, Pixel p = alo::WHITE);
+		void FillEllipse(const alo::vi2d& pos, const alo::vi2d& radius, Pixel p = alo::WHITE);
+		// Fills a thick ring located at (x,y) between inner and outer radius
+		void FillRing(int32_t x, int32_t y, int32_t inner, int32_t outer, Pixel p = alo::WHITE);
+		void FillRing(const alo::vi2d& pos, int32_t inner, int32_t outer, Pixel p = alo::WHITE);
+		// Draws a horizontal run of pixels from (x1,y) to (x2,y) inclusive
+		void DrawSpan(int32_t x1, int32_t x2, int32_t y, Pixel p = alo::WHITE);
 		// Draws a rectangle at (x,y) to (x+w,y+h)
 		void DrawRect(int32_t x, int32_t y, int32_t w, int32_t h, Pixel p = alo::WHITE);
 		void DrawRect(const alo::vi2d& pos, const alo::vi2d& size, Pixel p = alo::WHITE);
@@ -728,6 +1527,27 @@ namespace alo
 		// selected area is (ox,oy) to (ox+w,oy+h)
 		void DrawPartialSprite(int32_t x, int32_t y, Sprite* sprite, int32_t ox, int32_t oy, int32_t w, int32_t h, uint32_t scale = 1, uint8_t flip = alo::Sprite::NONE);
 		void DrawPartialSprite(const alo::vi2d& pos, Sprite* sprite, const alo::vi2d& sourcepos, const alo::vi2d& size, uint32_t scale = 1, uint8_t flip = alo::Sprite::NONE);
+		// Draws the pixels of a view, unscaled
+		void DrawSprite(int32_t x, int32_t y, const alo::SpriteView& view, uint8_t flip = alo::Sprite::NONE);
+		void DrawSprite(const alo::vi2d& pos, const alo::SpriteView& view, uint8_t flip = alo::Sprite::NONE);
+		// Draws a sprite through an affine transform from sprite pixels to the draw target
+		void DrawSpriteTransformed(Sprite* sprite, const alo::Transform2D& transform, alo::Sprite::Filter filter = alo::Sprite::Filter::NEAREST);
+		// Draws lines joining the points, segment i coloured by colours[i % colours.size()].
+		// Matches a DrawLine() per segment but plots shared endpoints only once
+		void DrawPolyline(const std::vector<alo::vf2d>& points, const std::vector<Pixel>& colours);
+		void DrawPolyline(const std::vector<alo::vf2d>& points, Pixel p = alo::WHITE);
+		// Draws a batch of single pixels
+		void DrawPoints(const std::vector<alo::vi2d>& points, Pixel p = alo::WHITE);
+		// Draws anti-aliased lines of any width through the points, see alo::Raster::DrawStroke()
+		void DrawStroke(const std::vector<alo::vf2d>& points, float fWidth, Pixel p = alo::WHITE, alo::Raster::Join join = alo::Raster::Join::ROUND);
+		void DrawStroke(const alo::vf2d& pos1, const alo::vf2d& pos2, float fWidth, Pixel p = alo::WHITE);
+		// Adds a point to a stroke and draws its new segment, see alo::Raster::ExtendStroke()
+		void ExtendStroke(alo::Raster::Stroke& stroke, const alo::vf2d& pos, float fWidth, Pixel p = alo::WHITE);
+		// Fills the area of matching colour around a pixel, see alo::Raster::FloodFill()
+		void FloodFill(int32_t x, int32_t y, Pixel p = alo::WHITE, uint8_t nTolerance = 0);
+		void FloodFill(const alo::vi2d& pos, Pixel p = alo::WHITE, uint8_t nTolerance = 0);
+		// Fills a closed polygon of any shape, see alo::Raster::FillPolygon()
+		void FillPolygon(const std::vector<alo::vf2d>& points, Pixel p = alo::WHITE, alo::Raster::FillRule rule = alo::Raster::FillRule::NONZERO);
 		// Draws a single line of text - traditional monospaced
 		void DrawString(int32_t x, int32_t y, const std::string& sText, Pixel col = alo::WHITE, uint32_t scale = 1);
 		void DrawString(const alo::vi2d& pos, const std::string& sText, Pixel col = alo::WHITE, uint32_t scale = 1);
@@ -740,6 +1560,14 @@ namespace alo
 		// Decal Quad functions
 		void SetDecalMode(const alo::DecalMode& mode);
 		void SetDecalStructure(const alo::DecalStructure& structure);
+		// Sends decal drawing into target, a decal made with a size, in place of
+		// the draw target layer, until called with nullptr. Positions are in the
+		// target's pixels. Targets are drawn into ahead of the frame's layers and
+		// keep what is drawn, so a drawing can build up on the GPU. Other decals,
+		// and targets on renderers without them, leave drawing on the layer
+		void SetDecalTarget(alo::Decal* target);
+		// Clears target to p ahead of this frame's drawing into it
+		void ClearDecalTarget(alo::Decal* target, const alo::Pixel& p = alo::BLANK);
 		// Draws a whole decal, with optional scale and tinting
 		void DrawDecal(const alo::vf2d& pos, alo::Decal* decal, const alo::vf2d& scale = { 1.0f,1.0f }, const alo::Pixel& tint = alo::WHITE);
 		// Draws a region of a decal, with optional scale and tinting
@@ -770,6 +1598,14 @@ namespace alo
 		void DrawPolygonDecal(alo::Decal* decal, const std::vector<alo::vf2d>& pos, const std::vector<alo::vf2d>& uv, const alo::Pixel tint = alo::WHITE);
 		void DrawPolygonDecal(alo::Decal* decal, const std::vector<alo::vf2d>& pos, const std::vector<float>& depth, const std::vector<alo::vf2d>& uv, const alo::Pixel tint = alo::WHITE);
 		void DrawPolygonDecal(alo::Decal* decal, const std::vector<alo::vf2d>& pos, const std::vector<alo::vf2d>& uv, const std::vector<alo::Pixel>& tint);
+		// Draws vertices assembled by indices into the current decal structure, where
+		// alo::nDecalRestart starts a new line, fan or strip. uv may be empty for
+		// untextured meshes. Indices past the end of pos are taken as restarts
+		void DrawIndexedDecal(alo::Decal* decal, const std::vector<alo::vf2d>& pos, const std::vector<alo::vf2d>& uv, const std::vector<uint32_t>& indices, const alo::Pixel tint = alo::WHITE);
+		void DrawIndexedDecal(alo::Decal* decal, const std::vector<alo::vf2d>& pos, const std::vector<alo::vf2d>& uv, const std::vector<uint32_t>& indices, const std::vector<alo::Pixel>& tint);
+		// Draws many quads of one decal, a single instanced draw where the renderer supports it
+		void DrawInstancedDecal(alo::Decal* decal, const alo::QuadInstance* pInstances, size_t nCount);
+		void DrawInstancedDecal(alo::Decal* decal, const std::vector<alo::QuadInstance>& vInstances);
 
 		// Draws a line in Decal Space
 		void DrawLineDecal(const alo::vf2d& pos1, const alo::vf2d& pos2, Pixel p = alo::WHITE);
@@ -806,6 +1642,20 @@ namespace alo
 	private:
 		void UpdateTextEntry();
 		void UpdateConsole();
+		void MarkDirtyRect(int32_t x0, int32_t y0, int32_t x1, int32_t y1);
+		alo::Raster::Pen CurrentPen() const;
+		void WriteSpan(int32_t x1, int32_t x2, int32_t y, Pixel p);
+		const alo::vf2d* ScaledPoints(const alo::vf2d* pPoints, size_t nPoints);
+		void CreateSupersampleCanvas();
+		alo::DecalVertex* PushDecal(alo::Decal* decal, uint32_t nPoints);
+		alo::DecalStream& DecalTargetStream();
+		void PushDecalIndices(const std::vector<uint32_t>& indices, uint32_t nVertices);
+		size_t FindDecalTarget(alo::Decal* target);
+		void PushQuad(alo::Decal* decal, const alo::vf2d& tl, const alo::vf2d& br, const alo::vf2d& uvtl, const alo::vf2d& uvbr, const alo::Pixel& tint);
+		alo::Sprite* ApplyGlow(LayerDesc& layer);
+		bool BlitPartialSprite(int32_t x, int32_t y, const alo::SpriteView& src, int32_t ox, int32_t oy, int32_t w, int32_t h, uint8_t flip);
+		bool BlitPartialSprite(int32_t x, int32_t y, Sprite* sprite, int32_t ox, int32_t oy, int32_t w, int32_t h, uint8_t flip);
+		void DrawGlyph(int32_t x, int32_t y, const FontGlyph& glyph, bool bProp, Pixel col, uint32_t scale);
 
 	
 	public: // Branding
@@ -813,10 +1663,20 @@ namespace alo
 
 	private: // Inner mysterious workings
 		alo::Sprite*     pDrawTarget = nullptr;
+		alo::SpriteView  vDrawTarget;
+		alo::FrameArena  frameArena;
+		int32_t          nDirtyLayer = -1;
+		// Target pixels per screen pixel, in each axis, of the current draw target
+		int32_t          nDrawScale = 1;
+		std::unique_ptr<alo::Sprite> pSupersample;
+		int32_t          nSupersample = 1;
+		alo::Raster::Downsampler supersampleFilter = alo::Raster::Downsampler::BOX;
 		Pixel::Mode	nPixelMode = Pixel::NORMAL;
 		float		fBlendFactor = 1.0f;
 		alo::vi2d	vScreenSize = { 256, 240 };
 		alo::vf2d	vInvScreenSize = { 1.0f / 256.0f, 1.0f / 240.0f };
+		// Maps decal positions to device coordinates, the screen's or the decal target's
+		alo::vf2d	vInvDecalSize = { 1.0f / 256.0f, 1.0f / 240.0f };
 		alo::vi2d	vPixelSize = { 4, 4 };
 		alo::vi2d   vScreenPixelSize = { 4, 4 };
 		alo::vi2d	vMousePos = { 0, 0 };
@@ -838,6 +1698,17 @@ namespace alo
 		bool bSuspendTextureTransfer = false;
 		Renderable  fontRenderable;
 		std::vector<LayerDesc> vLayers;
+		std::vector<std::function<void(alo::Sprite&)>> vScreenReads;
+		// Decals queued for each decal target drawn to so far
+		struct DecalTargetDesc
+		{
+			alo::Decal* target = nullptr;
+			alo::DecalStream decals;
+			bool bClear = false;
+			alo::Pixel clear = alo::BLANK;
+		};
+		std::vector<DecalTargetDesc> vDecalTargets;
+		int32_t nDecalTarget = -1;
 		uint8_t		nTargetLayer = 0;
 		uint32_t	nLastFPS = 0;
 		bool        bPixelCohesion = false;
@@ -846,6 +1717,7 @@ namespace alo
 		std::function<alo::Pixel(const int x, const int y, const alo::Pixel&, const alo::Pixel&)> funcPixelMode;
 		std::chrono::time_point<std::chrono::system_clock> m_tp1, m_tp2;
 		std::vector<alo::vi2d> vFontSpacing;
+		std::array<FontGlyph, 96> vFontGlyphs;
 
 		// Command Console Specific
 		bool bConsoleShow = false;
@@ -911,6 +1783,11 @@ namespace alo
 		// in case you are using them, but they will be removed.
 		// alo::vf2d	vSubPixelOffset = { 0.0f, 0.0f };
 
+	private:
+		// A target decal going away takes its queue with it
+		friend class Decal;
+		void DropDecalTarget(alo::Decal* target);
+
 	public: // GEX Stuff
 		friend class GEX;
 		void gex_Register(alo::GEX* gex);
@@ -1056,367 +1933,2601 @@ namespace alo
 	{ return (p2 * t) + p1 * (1.0f - t); }
 
 	// O------------------------------------------------------------------------------O
-	// | alo::Sprite IMPLEMENTATION                                                   |
+	// | alo::Transform2D IMPLEMENTATION                                              |
 	// O------------------------------------------------------------------------------O
-	Sprite::Sprite()
-	{ width = 0; height = 0; }
+	Transform2D::Transform2D()
+	{ Reset(); }
 
-	Sprite::Sprite(const std::string& sImageFile, alo::ResourcePack* pack)
-	{ LoadFromFile(sImageFile, pack); }
+	void Transform2D::Reset()
+	{
+		m[0][0] = 1.0f; m[0][1] = 0.0f; m[0][2] = 0.0f;
+		m[1][0] = 0.0f; m[1][1] = 1.0f; m[1][2] = 0.0f;
+	}
 
-	Sprite::Sprite(int32_t w, int32_t h)
-	{		
-		width = w;		height = h;
-		pColData.resize(width * height);
-		pColData.resize(width * height, nDefaultPixel);
+	void Transform2D::Append(const alo::Transform2D& t)
+	{
+		float r[2][3];
+		for (int i = 0; i < 2; i++)
+		{
+			r[i][0] = t.m[i][0] * m[0][0] + t.m[i][1] * m[1][0];
+			r[i][1] = t.m[i][0] * m[0][1] + t.m[i][1] * m[1][1];
+			r[i][2] = t.m[i][0] * m[0][2] + t.m[i][1] * m[1][2] + t.m[i][2];
+		}
+		std::memcpy(m, r, sizeof(m));
 	}
 
-	Sprite::~Sprite()
-	{ pColData.clear();	}
+	void Transform2D::Translate(float x, float y)
+	{ m[0][2] += x; m[1][2] += y; }
 
-	void Sprite::SetSampleMode(alo::Sprite::Mode mode)
-	{ modeSample = mode; }
+	void Transform2D::Rotate(float fTheta)
+	{
+		alo::Transform2D t;
+		t.m[0][0] = std::cos(fTheta); t.m[0][1] = -std::sin(fTheta);
+		t.m[1][0] = std::sin(fTheta); t.m[1][1] = std::cos(fTheta);
+		Append(t);
+	}
 
-	Pixel Sprite::GetPixel(const alo::vi2d& a) const
-	{ return GetPixel(a.x, a.y); }
+	void Transform2D::Scale(float x, float y)
+	{
+		alo::Transform2D t;
+		t.m[0][0] = x; t.m[1][1] = y;
+		Append(t);
+	}
 
-	bool Sprite::SetPixel(const alo::vi2d& a, Pixel p)
-	{ return SetPixel(a.x, a.y, p); }
+	void Transform2D::Shear(float x, float y)
+	{
+		alo::Transform2D t;
+		t.m[0][1] = x; t.m[1][0] = y;
+		Append(t);
+	}
 
-	Pixel Sprite::GetPixel(int32_t x, int32_t y) const
+	bool Transform2D::Inverse(alo::Transform2D& out) const
 	{
-		if (modeSample == alo::Sprite::Mode::NORMAL)
+		float det = m[0][0] * m[1][1] - m[0][1] * m[1][0];
+		if (std::abs(det) < 1e-12f) return false;
+		float idet = 1.0f / det;
+		out.m[0][0] =  m[1][1] * idet; out.m[0][1] = -m[0][1] * idet;
+		out.m[1][0] = -m[1][0] * idet; out.m[1][1] =  m[0][0] * idet;
+		out.m[0][2] = -(out.m[0][0] * m[0][2] + out.m[0][1] * m[1][2]);
+		out.m[1][2] = -(out.m[1][0] * m[0][2] + out.m[1][1] * m[1][2]);
+		return true;
+	}
+
+	alo::vf2d Transform2D::Forward(const alo::vf2d& p) const
+	{ return { m[0][0] * p.x + m[0][1] * p.y + m[0][2], m[1][0] * p.x + m[1][1] * p.y + m[1][2] }; }
+
+	// O------------------------------------------------------------------------------O
+	// | alo::PixelPool IMPLEMENTATION                                                |
+	// O------------------------------------------------------------------------------O
+	alo::PixelPool& PixelPool::Get()
+	{
+		// Never destroyed, so sprites with static lifetime can still release into it
+		static alo::PixelPool* pool = new alo::PixelPool();
+		return *pool;
+	}
+
+	size_t PixelPool::SizeClass(size_t nBytes, size_t& nClassBytes)
+	{
+		if (nBytes <= 256)
 		{
-			if (x >= 0 && x < width && y >= 0 && y < height)
-				return pColData[y * width + x];
-			else
-				return Pixel(0, 0, 0, 0);
+			size_t k = (std::max(nBytes, size_t(1)) + 63) / 64;
+			nClassBytes = k * 64;
+			return k - 1;
 		}
-		else
+
+		// Four classes between each power of two above 256 bytes
+		size_t p = 8;
+		while ((size_t(2) << p) < nBytes) p++;
+		size_t nStep = (size_t(1) << p) / 4;
+		size_t k = (nBytes - (size_t(1) << p) + nStep - 1) / nStep;
+		nClassBytes = (size_t(1) << p) + k * nStep;
+		return 4 + (p - 8) * 4 + (k - 1);
+	}
+
+	void* PixelPool::Allocate(size_t nBytes)
+	{
+		size_t nClassBytes = 0;
+		size_t c = SizeClass(nBytes, nClassBytes);
 		{
-			if (modeSample == alo::Sprite::Mode::PERIODIC)
-				return pColData[abs(y % height) * width + abs(x % width)];
-			else
-				return pColData[std::max(0, std::min(y, height-1)) * width + std::max(0, std::min(x, width-1))];
+			std::lock_guard<std::mutex> lock(mux);
+			stats.nAllocations++;
+			stats.nBytesInUse += nClassBytes;
+			if (c < nClasses && !vFree[c].empty())
+			{
+				void* p = vFree[c].back();
+				vFree[c].pop_back();
+				stats.nBytesCached -= nClassBytes;
+				return p;
+			}
+			stats.nHeapAllocations++;
 		}
+		return ::operator new(nClassBytes, std::align_val_t(nAlign));
 	}
 
-	bool Sprite::SetPixel(int32_t x, int32_t y, Pixel p)
+	void PixelPool::Release(void* p, size_t nBytes)
 	{
-		if (x >= 0 && x < width && y >= 0 && y < height)
+		if (p == nullptr) return;
+		size_t nClassBytes = 0;
+		size_t c = SizeClass(nBytes, nClassBytes);
+		std::lock_guard<std::mutex> lock(mux);
+		stats.nReleases++;
+		stats.nBytesInUse -= nClassBytes;
+		if (c < nClasses)
 		{
-			pColData[y * width + x] = p;
-			return true;
+			vFree[c].push_back(p);
+			stats.nBytesCached += nClassBytes;
 		}
 		else
-			return false;
+		{
+			stats.nHeapReleases++;
+			::operator delete(p, std::align_val_t(nAlign));
+		}
 	}
 
-	Pixel Sprite::Sample(float x, float y) const
+	void PixelPool::Trim()
 	{
-		int32_t sx = std::min((int32_t)((x * (float)width)), width - 1);
-		int32_t sy = std::min((int32_t)((y * (float)height)), height - 1);
-		return GetPixel(sx, sy);
+		std::lock_guard<std::mutex> lock(mux);
+		for (auto& v : vFree)
+		{
+			for (void* p : v)
+			{
+				::operator delete(p, std::align_val_t(nAlign));
+				stats.nHeapReleases++;
+			}
+			v.clear();
+		}
+		stats.nBytesCached = 0;
 	}
 
-	Pixel Sprite::SampleBL(float u, float v) const
+	PixelPool::Stats PixelPool::GetStats() const
 	{
-		u = u * width - 0.5f;
-		v = v * height - 0.5f;
-		int x = (int)floor(u); // cast to int rounds toward zero, not downward
-		int y = (int)floor(v); 
-		float u_ratio = u - x;
-		float v_ratio = v - y;
-		float u_opposite = 1 - u_ratio;
-		float v_opposite = 1 - v_ratio;
+		std::lock_guard<std::mutex> lock(mux);
+		return stats;
+	}
 
-		alo::Pixel p1 = GetPixel(std::max(x, 0), std::max(y, 0));
-		alo::Pixel p2 = GetPixel(std::min(x + 1, (int)width - 1), std::max(y, 0));
-		alo::Pixel p3 = GetPixel(std::max(x, 0), std::min(y + 1, (int)height - 1));
-		alo::Pixel p4 = GetPixel(std::min(x + 1, (int)width - 1), std::min(y + 1, (int)height - 1));
+	// O------------------------------------------------------------------------------O
+	// | alo::FrameArena IMPLEMENTATION                                               |
+	// O------------------------------------------------------------------------------O
+	FrameArena::FrameArena(size_t nInitialBytes)
+	{
+		if (nInitialBytes == 0) return;
+		vChunks.push_back({ static_cast<uint8_t*>(::operator new(nInitialBytes, std::align_val_t(64))), nInitialBytes, 0 });
+		nHeapAllocations++;
+	}
 
-		return alo::Pixel(
-			(uint8_t)((p1.r * u_opposite + p2.r * u_ratio) * v_opposite + (p3.r * u_opposite + p4.r * u_ratio) * v_ratio),
-			(uint8_t)((p1.g * u_opposite + p2.g * u_ratio) * v_opposite + (p3.g * u_opposite + p4.g * u_ratio) * v_ratio),
-			(uint8_t)((p1.b * u_opposite + p2.b * u_ratio) * v_opposite + (p3.b * u_opposite + p4.b * u_ratio) * v_ratio));
+	FrameArena::~FrameArena()
+	{
+		for (auto& c : vChunks)
+			::operator delete(c.pData, std::align_val_t(64));
 	}
 
-	Pixel* Sprite::GetData()
-	{ return pColData.data(); }
+	void* FrameArena::AllocateFrom(Chunk& c, size_t nBytes, size_t nAlignment)
+	{
+		uintptr_t base = reinterpret_cast<uintptr_t>(c.pData);
+		uintptr_t aligned = (base + c.nUsed + nAlignment - 1) & ~uintptr_t(nAlignment - 1);
+		size_t nEnd = size_t(aligned - base) + nBytes;
+		if (nEnd > c.nSize) return nullptr;
+		nUsedTotal += nEnd - c.nUsed;
+		nPeak = std::max(nPeak, nUsedTotal);
+		c.nUsed = nEnd;
+		return reinterpret_cast<void*>(aligned);
+	}
 
+	void* FrameArena::Allocate(size_t nBytes, size_t nAlignment)
+	{
+		// Current chunk, then any spare chunk after it, then a new one
+		for (; nCurrent < vChunks.size(); nCurrent++)
+			if (void* p = AllocateFrom(vChunks[nCurrent], nBytes, nAlignment))
+				return p;
+
+		size_t nSize = std::max(nBytes + nAlignment, vChunks.empty() ? size_t(1 << 16) : vChunks.back().nSize * 2);
+		vChunks.push_back({ static_cast<uint8_t*>(::operator new(nSize, std::align_val_t(64))), nSize, 0 });
+		nHeapAllocations++;
+		nCurrent = vChunks.size() - 1;
+		return AllocateFrom(vChunks.back(), nBytes, nAlignment);
+	}
 
-	alo::rcode Sprite::LoadFromFile(const std::string& sImageFile, alo::ResourcePack* pack)
+	FrameArena::Marker FrameArena::Mark() const
 	{
-		UNUSED(pack);
-		return loader->LoadImageResource(this, sImageFile, pack);
+		if (vChunks.empty()) return Marker();
+		return { nCurrent, vChunks[std::min(nCurrent, vChunks.size() - 1)].nUsed };
 	}
 
-	alo::Sprite* Sprite::Duplicate()
+	void FrameArena::Rewind(const Marker& m)
 	{
-		alo::Sprite* spr = new alo::Sprite(width, height);
-		std::memcpy(spr->GetData(), GetData(), width * height * sizeof(alo::Pixel));
-		spr->modeSample = modeSample;
-		return spr;
+		if (m.nChunk >= vChunks.size()) return;
+		for (size_t i = m.nChunk + 1; i < vChunks.size(); i++)
+			vChunks[i].nUsed = 0;
+		vChunks[m.nChunk].nUsed = m.nUsed;
+		nCurrent = m.nChunk;
+		nUsedTotal = 0;
+		for (size_t i = 0; i <= m.nChunk; i++)
+			nUsedTotal += vChunks[i].nUsed;
 	}
 
-	alo::Sprite* Sprite::Duplicate(const alo::vi2d& vPos, const alo::vi2d& vSize)
+	void FrameArena::Reset()
 	{
-		alo::Sprite* spr = new alo::Sprite(vSize.x, vSize.y);
-		for (int y = 0; y < vSize.y; y++)
-			for (int x = 0; x < vSize.x; x++)
-				spr->SetPixel(x, y, GetPixel(vPos.x + x, vPos.y + y));
-		return spr;
+		// A frame that spilled into several chunks gets one chunk big enough
+		if (vChunks.size() > 1)
+		{
+			size_t nTotal = 0;
+			for (auto& c : vChunks)
+			{
+				nTotal += c.nSize;
+				::operator delete(c.pData, std::align_val_t(64));
+			}
+			vChunks.clear();
+			vChunks.push_back({ static_cast<uint8_t*>(::operator new(nTotal, std::align_val_t(64))), nTotal, 0 });
+			nHeapAllocations++;
+		}
+		for (auto& c : vChunks) c.nUsed = 0;
+		nCurrent = 0;
+		nUsedTotal = 0;
 	}
 
-	alo::vi2d alo::Sprite::Size() const
+	FrameArena::Stats FrameArena::GetStats() const
 	{
-		return { width, height };
+		Stats s;
+		for (auto& c : vChunks) s.nCapacity += c.nSize;
+		s.nUsed = nUsedTotal;
+		s.nPeak = nPeak;
+		s.nHeapAllocations = nHeapAllocations;
+		return s;
 	}
 
 	// O------------------------------------------------------------------------------O
-	// | alo::Decal IMPLEMENTATION                                                    |
+	// | alo::ParallelRows IMPLEMENTATION                                             |
 	// O------------------------------------------------------------------------------O
-	Decal::Decal(alo::Sprite* spr, bool filter, bool clamp)
+	namespace Workers
 	{
-		id = -1;
-		if (spr == nullptr) return;
-		sprite = spr;
-		id = renderer->CreateTexture(sprite->width, sprite->height, filter, clamp);
-		Update();
+		// Started on first use and kept for the life of the program. One job runs
+		// at a time, its slices handed out through an atomic counter
+		struct Pool
+		{
+			std::mutex mJob, mWake;
+			std::condition_variable cvWake, cvDone;
+			std::vector<std::thread> vThreads;
+			const std::function<void(int32_t, int32_t)>* pJob = nullptr;
+			std::atomic<int32_t> nNext{ 0 };
+			int32_t nEnd = 0, nSlice = 1, nBusy = 0;
+			uint64_t nGeneration = 0;
+			bool bQuit = false;
+
+			static Pool& Get() { static Pool pool; return pool; }
+
+			~Pool()
+			{
+				{ std::lock_guard<std::mutex> lock(mWake); bQuit = true; }
+				cvWake.notify_all();
+				for (auto& t : vThreads) t.join();
+			}
+
+			void RunSlices()
+			{
+				for (int32_t y = nNext.fetch_add(nSlice); y < nEnd; y = nNext.fetch_add(nSlice))
+					(*pJob)(y, std::min(y + nSlice, nEnd));
+			}
+
+			void Worker()
+			{
+				InJob() = true;
+				uint64_t nSeen = 0;
+				std::unique_lock<std::mutex> lock(mWake);
+				for (;;)
+				{
+					cvWake.wait(lock, [&] { return bQuit || nGeneration != nSeen; });
+					if (bQuit) return;
+					nSeen = nGeneration;
+					lock.unlock();
+					RunSlices();
+					lock.lock();
+					if (--nBusy == 0) cvDone.notify_one();
+				}
+			}
+
+			static bool& InJob() { thread_local bool b = false; return b; }
+		};
 	}
 
-	Decal::Decal(const uint32_t nExistingTextureResource, alo::Sprite* spr)
+	void ParallelRows(int32_t y0, int32_t y1, int32_t nMinRows, const std::function<void(int32_t, int32_t)>& f)
 	{
-		if (spr == nullptr) return;
-		id = nExistingTextureResource;
+		if (y0 >= y1) return;
+		const int32_t nThreads = int32_t(std::max(std::thread::hardware_concurrency(), 1u));
+		nMinRows = std::max(nMinRows, 1);
+		Workers::Pool& pool = Workers::Pool::Get();
+		if (nThreads == 1 || y1 - y0 < 2 * nMinRows || Workers::Pool::InJob())
+		{
+			f(y0, y1);
+			return;
+		}
+
+		std::lock_guard<std::mutex> job(pool.mJob);
+		Workers::Pool::InJob() = true;
+		{
+			std::lock_guard<std::mutex> lock(pool.mWake);
+			while (int32_t(pool.vThreads.size()) < nThreads - 1)
+				pool.vThreads.emplace_back(&Workers::Pool::Worker, &pool);
+
+			// A few slices per thread evens out rows of uneven cost
+			pool.pJob = &f;
+			pool.nEnd = y1;
+			pool.nSlice = std::max(nMinRows, (y1 - y0 + nThreads * 4 - 1) / (nThreads * 4));
+			pool.nNext = y0;
+			pool.nBusy = int32_t(pool.vThreads.size());
+			pool.nGeneration++;
+		}
+		pool.cvWake.notify_all();
+		pool.RunSlices();
+
+		std::unique_lock<std::mutex> lock(pool.mWake);
+		pool.cvDone.wait(lock, [&] { return pool.nBusy == 0; });
+		Workers::Pool::InJob() = false;
 	}
 
-	void Decal::Update()
+	// O------------------------------------------------------------------------------O
+	// | alo::DecalStream IMPLEMENTATION                                              |
+	// O------------------------------------------------------------------------------O
+	alo::DecalVertex* DecalStream::Push(alo::Decal* decal, alo::DecalMode mode, alo::DecalStructure structure, uint32_t nPoints)
 	{
-		if (sprite == nullptr) return;
-		vUVScale = { 1.0f / float(sprite->width), 1.0f / float(sprite->height) };
-		renderer->ApplyTexture(id);
-		renderer->UpdateTexture(id, sprite);
+		const size_t nOffset = vVertices.size();
+		vVertices.resize(nOffset + nPoints);
+		vCommands.push_back({ decal, mode, structure, uint32_t(nOffset), nPoints });
+		return vVertices.data() + nOffset;
 	}
 
-	void Decal::UpdateSprite()
+	alo::QuadInstance* DecalStream::PushInstances(alo::Decal* decal, alo::DecalMode mode, uint32_t nInstances)
 	{
-		if (sprite == nullptr) return;
-		renderer->ApplyTexture(id);
-		renderer->ReadTexture(id, sprite);
+		const size_t nOffset = vInstances.size();
+		vInstances.resize(nOffset + nInstances);
+		vCommands.push_back({ decal, mode, alo::DecalStructure::STRIP, uint32_t(nOffset), 0, nInstances });
+		return vInstances.data() + nOffset;
 	}
 
-	Decal::~Decal()
+	uint32_t* DecalStream::PushIndices(uint32_t nIndices)
+	{
+		const size_t nFirst = vIndices.size();
+		vIndices.resize(nFirst + nIndices);
+		vCommands.back().firstIndex = uint32_t(nFirst);
+		vCommands.back().indices = nIndices;
+		return vIndices.data() + nFirst;
+	}
+
+	bool DecalIsLines(const alo::DecalInstance& decal)
+	{ return decal.mode == alo::DecalMode::WIREFRAME || decal.structure == alo::DecalStructure::LINE; }
+
+	void UnrollDecal(const alo::DecalInstance& decal, const uint32_t* pIndices, uint32_t nBase, std::vector<uint32_t>& vOut)
 	{
-		if (id != -1)
+		const bool bLines = DecalIsLines(decal);
+		const uint32_t nCount = pIndices != nullptr ? decal.indices : decal.points;
+		auto index = [&](uint32_t i) { return pIndices != nullptr ? pIndices[i] : i; };
+
+		// Wireframe triangles are their three edges
+		auto triangle = [&](uint32_t a, uint32_t b, uint32_t c)
 		{
-			renderer->DeleteTexture(id);
-			id = -1;
+			if (bLines) vOut.insert(vOut.end(), { a, b, b, c, c, a });
+			else vOut.insert(vOut.end(), { a, b, c });
+		};
+
+		// Each primitive runs up to the next restart
+		for (uint32_t s = 0; s < nCount;)
+		{
+			uint32_t e = s;
+			while (e < nCount && index(e) != alo::nDecalRestart) e++;
+			const uint32_t n = e - s;
+			auto at = [&](uint32_t i) { return nBase + index(s + i); };
+
+			switch (decal.structure)
+			{
+			case alo::DecalStructure::LINE:
+				for (uint32_t v = 0; v + 1 < n; v++)
+					vOut.insert(vOut.end(), { at(v), at(v + 1) });
+				break;
+			case alo::DecalStructure::FAN:
+				// A wireframe fan is the outline of the polygon
+				if (bLines)
+				{
+					for (uint32_t v = 0; n > 1 && v < (n == 2 ? 1 : n); v++)
+						vOut.insert(vOut.end(), { at(v), at((v + 1) % n) });
+				}
+				else
+					for (uint32_t v = 1; v + 1 < n; v++)
+						triangle(at(0), at(v), at(v + 1));
+				break;
+			case alo::DecalStructure::STRIP:
+				for (uint32_t v = 0; v + 2 < n; v++)
+					if (v & 1) triangle(at(v + 1), at(v), at(v + 2));
+					else triangle(at(v), at(v + 1), at(v + 2));
+				break;
+			case alo::DecalStructure::LIST:
+				for (uint32_t v = 0; v + 2 < n; v += 3)
+					triangle(at(v), at(v + 1), at(v + 2));
+				break;
+			}
+			s = e + 1;
 		}
 	}
 
-	void Renderable::Create(uint32_t width, uint32_t height, bool filter, bool clamp)
+	uint32_t ChunkDecal(const alo::DecalInstance& decal, size_t nUnrolled, size_t nMax, const std::function<void(size_t, size_t)>& f)
 	{
-		pSprite = std::make_unique<alo::Sprite>(width, height);
-		pDecal = std::make_unique<alo::Decal>(pSprite.get(), filter, clamp);
+		const size_t nPrimitive = DecalIsLines(decal) ? 2 : 3;
+		const size_t nChunk = nMax / nPrimitive * nPrimitive;
+		if (nChunk == 0) return 0;
+		uint32_t nChunks = 0;
+		for (size_t i = 0; i < nUnrolled; i += nChunk, nChunks++)
+			f(i, std::min(nChunk, nUnrolled - i));
+		return nChunks;
 	}
 
-	alo::rcode Renderable::Load(const std::string& sFile, ResourcePack* pack, bool filter, bool clamp)
+	void PlanDecals(const alo::DecalStream& decals, const alo::DecalPlan& plan)
 	{
-		pSprite = std::make_unique<alo::Sprite>();
-		if (pSprite->LoadFromFile(sFile, pack) == alo::rcode::OK)
+		thread_local std::vector<uint32_t> vUnrolled, vIndices;
+		thread_local std::vector<alo::DecalBatch> vBatches;
+		size_t nWindow = 0, nWindowEnd = 0;
+
+		auto flush = [&]()
 		{
-			pDecal = std::make_unique<alo::Decal>(pSprite.get(), filter, clamp);
-			return alo::rcode::OK;
-		}
-		else
+			if (vBatches.empty()) return;
+			plan.window(nWindow, nWindowEnd - nWindow, vIndices, vBatches);
+			vBatches.clear();
+			vIndices.clear();
+		};
+
+		vBatches.clear();
+		vIndices.clear();
+		for (size_t i = 0; i < decals.Count();)
 		{
-			pSprite.release();
-			pSprite = nullptr;
-			return alo::rcode::NO_FILE;
+			const alo::DecalInstance& decal = decals[i];
+			const uint32_t nTexture = plan.texture(decal);
+
+			// A run of instanced commands is contiguous in the instance data
+			if (decal.instances > 0)
+			{
+				size_t j = i + 1;
+				while (j < decals.Count() && decals[j].instances > 0 && decals[j].mode == decal.mode && plan.texture(decals[j]) == nTexture)
+					j++;
+				const size_t nInstances = decals[j - 1].offset + decals[j - 1].instances - decal.offset;
+				const size_t nChunk = std::max<size_t>(plan.nMaxInstances, 1);
+				flush();
+				for (size_t k = 0; k < nInstances; k += nChunk)
+					plan.instanced(nTexture, decal.mode, decals.Instances(decal) + k, std::min(nChunk, nInstances - k));
+				i = j;
+				continue;
+			}
+
+			vUnrolled.clear();
+			alo::UnrollDecal(decal, decals.Indices(decal), 0, vUnrolled);
+			i++;
+
+			if (decal.points > plan.nMaxVertices || vUnrolled.size() > plan.nMaxIndices)
+			{
+				flush();
+				plan.chunked(decal, nTexture, vUnrolled);
+				continue;
+			}
+
+			if (vUnrolled.empty())
+				continue;
+			if (!vBatches.empty() && (decal.offset + decal.points - nWindow > plan.nMaxVertices || vIndices.size() + vUnrolled.size() > plan.nMaxIndices))
+				flush();
+			if (vBatches.empty())
+				nWindow = decal.offset;
+			nWindowEnd = decal.offset + decal.points;
+
+			const uint32_t nStart = decal.offset - uint32_t(nWindow);
+			const size_t nFirstIndex = vIndices.size();
+			for (uint32_t n : vUnrolled)
+				vIndices.push_back(nStart + n);
+
+			const bool bLines = alo::DecalIsLines(decal);
+			if (!vBatches.empty() && vBatches.back().nTexture == nTexture && vBatches.back().mode == decal.mode && vBatches.back().bLines == bLines)
+				vBatches.back().nIndices += vUnrolled.size();
+			else
+				vBatches.push_back({ nTexture, decal.mode, bLines, nFirstIndex, vUnrolled.size() });
 		}
+		flush();
 	}
 
-	alo::Decal* Renderable::Decal() const
-	{ return pDecal.get(); }
+	// O------------------------------------------------------------------------------O
+	// | alo::DirtyRegion IMPLEMENTATION                                              |
+	// O------------------------------------------------------------------------------O
+	void DirtyRegion::Add(int32_t x0, int32_t y0, int32_t x1, int32_t y1)
+	{
+		if (x0 >= x1 || y0 >= y1) return;
 
-	alo::Sprite* Renderable::Sprite() const
-	{ return pSprite.get(); }
+		// Most writes land inside whatever was touched last
+		if (nCount > 0)
+		{
+			const Rect& l = vRects[nLast];
+			if (x0 >= l.x0 && y0 >= l.y0 && x1 <= l.x1 && y1 <= l.y1) return;
+		}
+
+		auto area = [](const Rect& r) { return int64_t(r.x1 - r.x0) * int64_t(r.y1 - r.y0); };
+		auto merge = [](const Rect& a, const Rect& b) { return Rect{ std::min(a.x0, b.x0), std::min(a.y0, b.y0), std::max(a.x1, b.x1), std::max(a.y1, b.y1) }; };
+		auto remove = [&](size_t i) { vRects[i] = vRects[--nCount]; };
+
+		// Absorb anything the new rectangle touches, which can cascade
+		Rect r{ x0, y0, x1, y1 };
+		for (size_t i = 0; i < nCount;)
+		{
+			const Rect& o = vRects[i];
+			if (r.x0 <= o.x1 && o.x0 <= r.x1 && r.y0 <= o.y1 && o.y0 <= r.y1)
+			{
+				r = merge(r, o);
+				remove(i);
+				i = 0;
+			}
+			else
+				i++;
+		}
+
+		if (nCount == nMaxRects)
+		{
+			size_t nBest = 0;
+			int64_t nBestGrowth = INT64_MAX;
+			for (size_t i = 0; i < nCount; i++)
+			{
+				int64_t nGrowth = area(merge(r, vRects[i])) - area(vRects[i]);
+				if (nGrowth < nBestGrowth) { nBestGrowth = nGrowth; nBest = i; }
+			}
+			r = merge(r, vRects[nBest]);
+			remove(nBest);
+		}
+
+		vRects[nCount] = r;
+		nLast = nCount++;
+	}
 
 	// O------------------------------------------------------------------------------O
-	// | alo::ResourcePack IMPLEMENTATION                                             |
+	// | alo::Sprite IMPLEMENTATION                                                   |
 	// O------------------------------------------------------------------------------O
+	Sprite::Sprite()
+	{ width = 0; height = 0; }
 
+	Sprite::Sprite(const std::string& sImageFile, alo::ResourcePack* pack)
+	{ LoadFromFile(sImageFile, pack); }
 
-	//=============================================================
-	// Resource Packs - Allows you to store files in one large 
-	// scrambled file 
-	ResourceBuffer::ResourceBuffer(std::ifstream& ifs, uint32_t offset, uint32_t size)
+	Sprite::Sprite(int32_t w, int32_t h) : Sprite(w, h, true)
+	{ }
+
+	Sprite::Sprite(int32_t w, int32_t h, bool bClear)
 	{
-		vMemory.resize(size);
-		ifs.seekg(offset); ifs.read(vMemory.data(), vMemory.size());
-		setg(vMemory.data(), vMemory.data(), vMemory.data() + size);
+		width = w;		height = h;
+		if (bClear)
+			pColData.assign(size_t(width) * size_t(height), Pixel());
+		else
+			pColData.resize(size_t(width) * size_t(height));
 	}
 
-	ResourcePack::ResourcePack() { }
-	ResourcePack::~ResourcePack() { baseFile.close(); }
+	Sprite::~Sprite()
+	{ pColData.clear();	}
 
-	bool ResourcePack::AddFile(const std::string& sFile)
+	void Sprite::SetSampleMode(alo::Sprite::Mode mode)
+	{ modeSample = mode; }
+
+	Pixel Sprite::GetPixel(const alo::vi2d& a) const
+	{ return GetPixel(a.x, a.y); }
+
+	bool Sprite::SetPixel(const alo::vi2d& a, Pixel p)
+	{ return SetPixel(a.x, a.y, p); }
+
+	Pixel Sprite::GetPixel(int32_t x, int32_t y) const
 	{
-		const std::string file = makeposix(sFile);
+		if (modeSample == alo::Sprite::Mode::NORMAL)
+		{
+			if (x >= 0 && x < width && y >= 0 && y < height)
+				return pColData[Index(x, y)];
+			else
+				return Pixel(0, 0, 0, 0);
+		}
+		else
+		{
+			if (modeSample == alo::Sprite::Mode::PERIODIC)
+				return pColData[Index(abs(x % width), abs(y % height))];
+			else
+				return pColData[Index(std::max(0, std::min(x, width-1)), std::max(0, std::min(y, height-1)))];
+		}
+	}
+
+	bool Sprite::SetPixel(int32_t x, int32_t y, Pixel p)
+	{
+		if (x >= 0 && x < width && y >= 0 && y < height)
+		{
+			pColData[Index(x, y)] = p;
+			return true;
+		}
+		else
+			return false;
+	}
+
+	Pixel Sprite::Sample(float x, float y) const
+	{
+		int32_t sx = std::min((int32_t)((x * (float)width)), width - 1);
+		int32_t sy = std::min((int32_t)((y * (float)height)), height - 1);
+		return GetPixel(sx, sy);
+	}
+
+	Pixel Sprite::SampleBL(float u, float v) const
+	{
+		u = u * width - 0.5f;
+		v = v * height - 0.5f;
+		int x = (int)floor(u); // cast to int rounds toward zero, not downward
+		int y = (int)floor(v); 
+		float u_ratio = u - x;
+		float v_ratio = v - y;
+		float u_opposite = 1 - u_ratio;
+		float v_opposite = 1 - v_ratio;
+
+		alo::Pixel p1 = GetPixel(std::max(x, 0), std::max(y, 0));
+		alo::Pixel p2 = GetPixel(std::min(x + 1, (int)width - 1), std::max(y, 0));
+		alo::Pixel p3 = GetPixel(std::max(x, 0), std::min(y + 1, (int)height - 1));
+		alo::Pixel p4 = GetPixel(std::min(x + 1, (int)width - 1), std::min(y + 1, (int)height - 1));
+
+		return alo::Pixel(
+			(uint8_t)((p1.r * u_opposite + p2.r * u_ratio) * v_opposite + (p3.r * u_opposite + p4.r * u_ratio) * v_ratio),
+			(uint8_t)((p1.g * u_opposite + p2.g * u_ratio) * v_opposite + (p3.g * u_opposite + p4.g * u_ratio) * v_ratio),
+			(uint8_t)((p1.b * u_opposite + p2.b * u_ratio) * v_opposite + (p3.b * u_opposite + p4.b * u_ratio) * v_ratio));
+	}
+
+	// 8-bit fixed point bilinear blend of top pair p1 p2 and bottom pair p3 p4,
+	// the scalar and SSE2 versions round identically
+	inline Pixel BilerpFixed(const Pixel p1, const Pixel p2, const Pixel p3, const Pixel p4, uint32_t wx, uint32_t wy)
+	{
+#if defined(ALO_SIMD_SSE2)
+		const __m128i vZero = _mm_setzero_si128();
+		const __m128i vHalf = _mm_set1_epi16(128);
+		const __m128i vWx = _mm_set_epi16(short(wx), short(wx), short(wx), short(wx), short(256 - wx), short(256 - wx), short(256 - wx), short(256 - wx));
+		const __m128i vWy = _mm_set_epi16(short(wy), short(wy), short(wy), short(wy), short(256 - wy), short(256 - wy), short(256 - wy), short(256 - wy));
+		__m128i t = _mm_unpacklo_epi8(_mm_unpacklo_epi32(_mm_cvtsi32_si128(int32_t(p1.n)), _mm_cvtsi32_si128(int32_t(p2.n))), vZero);
+		__m128i b = _mm_unpacklo_epi8(_mm_unpacklo_epi32(_mm_cvtsi32_si128(int32_t(p3.n)), _mm_cvtsi32_si128(int32_t(p4.n))), vZero);
+		t = _mm_mullo_epi16(t, vWx); t = _mm_add_epi16(t, _mm_srli_si128(t, 8));
+		b = _mm_mullo_epi16(b, vWx); b = _mm_add_epi16(b, _mm_srli_si128(b, 8));
+		t = _mm_srli_epi16(_mm_add_epi16(t, vHalf), 8);
+		b = _mm_srli_epi16(_mm_add_epi16(b, vHalf), 8);
+		__m128i v = _mm_mullo_epi16(_mm_unpacklo_epi64(t, b), vWy);
+		v = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(v, _mm_srli_si128(v, 8)), vHalf), 8);
+		return Pixel(uint32_t(_mm_cvtsi128_si32(_mm_packus_epi16(v, vZero))));
+#else
+		auto lerp = [&](uint32_t c1, uint32_t c2, uint32_t c3, uint32_t c4)
+		{
+			uint32_t t = (c1 * (256 - wx) + c2 * wx + 128) >> 8;
+			uint32_t b = (c3 * (256 - wx) + c4 * wx + 128) >> 8;
+			return uint8_t((t * (256 - wy) + b * wy + 128) >> 8);
+		};
+		return Pixel(lerp(p1.r, p2.r, p3.r, p4.r), lerp(p1.g, p2.g, p3.g, p4.g), lerp(p1.b, p2.b, p3.b, p4.b), lerp(p1.a, p2.a, p3.a, p4.a));
+#endif
+	}
+
+	// Splits a normalised coordinate into clamped texel pair and 8-bit weight
+	inline void BilerpCoord(float u, int32_t size, int32_t& i0, int32_t& i1, uint32_t& w)
+	{
+		float f = std::max(-256.0f, std::min(u * float(size) * 256.0f - 128.0f, float(size) * 256.0f));
+		int32_t fi = int32_t(std::floor(f));
+		int32_t i = fi >> 8;
+		w = uint32_t(fi & 0xFF);
+		i0 = std::max(0, std::min(i, size - 1));
+		i1 = std::max(0, std::min(i + 1, size - 1));
+	}
+
+	void Sprite::Sample(const alo::vf2d* uv, alo::Pixel* out, size_t count) const
+	{
+		const float fw = float(width), fh = float(height);
+		size_t n = 0;
+#if defined(ALO_SIMD_SSE2)
+		// Convert four coordinates at a time, then fetch
+		const __m128 vSize = _mm_set_ps(fh, fw, fh, fw);
+		for (; n + 2 <= count; n += 2)
+		{
+			__m128 vuv = _mm_loadu_ps(&uv[n].x);
+			alignas(16) int32_t s[4];
+			_mm_store_si128((__m128i*)s, _mm_cvttps_epi32(_mm_mul_ps(vuv, vSize)));
+			for (int k = 0; k < 2; k++)
+			{
+				int32_t sx = std::min(s[k * 2 + 0], width - 1);
+				int32_t sy = std::min(s[k * 2 + 1], height - 1);
+				out[n + k] = (sx >= 0 && sy >= 0) ? pColData[Index(sx, sy)] : GetPixel(sx, sy);
+			}
+		}
+#endif
+		for (; n < count; n++)
+		{
+			int32_t sx = std::min((int32_t)(uv[n].x * fw), width - 1);
+			int32_t sy = std::min((int32_t)(uv[n].y * fh), height - 1);
+			out[n] = (sx >= 0 && sy >= 0) ? pColData[Index(sx, sy)] : GetPixel(sx, sy);
+		}
+	}
+
+	void Sprite::Sample(const std::vector<alo::vf2d>& uv, std::vector<alo::Pixel>& out) const
+	{
+		out.resize(uv.size());
+		Sample(uv.data(), out.data(), uv.size());
+	}
+
+	void Sprite::SampleBL(const alo::vf2d* uv, alo::Pixel* out, size_t count) const
+	{
+		if (width <= 0 || height <= 0) return;
+		size_t n = 0;
+#if defined(ALO_SIMD_SSE2)
+		// Fixed point coordinates for two samples at a time, floor done as
+		// truncate-and-correct since SSE2 has no rounding mode select
+		const __m128 vScale = _mm_set_ps(float(height) * 256.0f, float(width) * 256.0f, float(height) * 256.0f, float(width) * 256.0f);
+		const __m128 vLo = _mm_set1_ps(-256.0f);
+		const __m128 vHi = _mm_set_ps(float(height) * 256.0f, float(width) * 256.0f, float(height) * 256.0f, float(width) * 256.0f);
+		const __m128 vHalf = _mm_set1_ps(128.0f);
+		const __m128i vMaxXY = _mm_set_epi32(height - 1, width - 1, height - 1, width - 1);
+		const __m128i vZero = _mm_setzero_si128();
+		const __m128i vOne = _mm_set1_epi32(1);
+		for (; n + 2 <= count; n += 2)
+		{
+			__m128 f = _mm_max_ps(vLo, _mm_min_ps(_mm_sub_ps(_mm_mul_ps(_mm_loadu_ps(&uv[n].x), vScale), vHalf), vHi));
+			__m128i fi = _mm_cvttps_epi32(f);
+			fi = _mm_sub_epi32(fi, _mm_and_si128(_mm_castps_si128(_mm_cmplt_ps(f, _mm_cvtepi32_ps(fi))), vOne));
+			__m128i i0 = _mm_srai_epi32(fi, 8);
+			__m128i i1 = _mm_add_epi32(i0, vOne);
+			// Clamp to [0, size - 1] using compare and select
+			auto clamp = [&](__m128i v)
+			{
+				v = _mm_andnot_si128(_mm_cmplt_epi32(v, vZero), v);
+				__m128i gt = _mm_cmpgt_epi32(v, vMaxXY);
+				return _mm_or_si128(_mm_and_si128(gt, vMaxXY), _mm_andnot_si128(gt, v));
+			};
+			alignas(16) int32_t a0[4], a1[4], w[4];
+			_mm_store_si128((__m128i*)a0, clamp(i0));
+			_mm_store_si128((__m128i*)a1, clamp(i1));
+			_mm_store_si128((__m128i*)w, _mm_and_si128(fi, _mm_set1_epi32(0xFF)));
+			for (int k = 0; k < 4; k += 2)
+			{
+				const Pixel* r0 = &pColData[RowOffset(a0[k + 1])];
+				const Pixel* r1 = &pColData[RowOffset(a1[k + 1])];
+				size_t c0 = ColOffset(a0[k]), c1 = ColOffset(a1[k]);
+				out[n + k / 2] = BilerpFixed(r0[c0], r0[c1], r1[c0], r1[c1], uint32_t(w[k]), uint32_t(w[k + 1]));
+			}
+		}
+#endif
+		for (; n < count; n++)
+		{
+			int32_t x0, x1, y0, y1; uint32_t wx, wy;
+			BilerpCoord(uv[n].x, width, x0, x1, wx);
+			BilerpCoord(uv[n].y, height, y0, y1, wy);
+			const Pixel* r0 = &pColData[RowOffset(y0)];
+			const Pixel* r1 = &pColData[RowOffset(y1)];
+			size_t c0 = ColOffset(x0), c1 = ColOffset(x1);
+			out[n] = BilerpFixed(r0[c0], r0[c1], r1[c0], r1[c1], wx, wy);
+		}
+	}
+
+	void Sprite::SampleBL(const std::vector<alo::vf2d>& uv, std::vector<alo::Pixel>& out) const
+	{
+		out.resize(uv.size());
+		SampleBL(uv.data(), out.data(), uv.size());
+	}
+
+	void Sprite::ResampleTo(alo::Sprite* dst, alo::Sprite::Filter filter, int32_t y0, int32_t y1) const
+	{
+		if (dst == nullptr || dst->GetLayout() != alo::Sprite::Layout::LINEAR || width <= 0 || height <= 0) return;
+		if (y1 < 0 || y1 > dst->height) y1 = dst->height;
+		y0 = std::max(y0, 0);
+		if (y0 >= y1 || dst->width <= 0) return;
+
+		// Column mapping is the same for every row, so work it out once, as
+		// storage offsets within a row
+		const float fInvW = 1.0f / float(dst->width), fInvH = 1.0f / float(dst->height);
+		std::vector<size_t> vCol0(dst->width), vCol1(dst->width);
+		std::vector<uint32_t> vColW(dst->width);
+		for (int32_t x = 0; x < dst->width; x++)
+		{
+			float u = (float(x) + 0.5f) * fInvW;
+			int32_t c0 = 0, c1 = 0;
+			if (filter == alo::Sprite::Filter::NEAREST)
+				c0 = std::min(int32_t(u * float(width)), width - 1);
+			else
+				BilerpCoord(u, width, c0, c1, vColW[x]);
+			vCol0[x] = ColOffset(c0);
+			vCol1[x] = ColOffset(c1);
+		}
+
+		for (int32_t y = y0; y < y1; y++)
+		{
+			float v = (float(y) + 0.5f) * fInvH;
+			Pixel* out = dst->GetData() + size_t(y) * dst->width;
+			if (filter == alo::Sprite::Filter::NEAREST)
+			{
+				const Pixel* row = &pColData[RowOffset(std::min(int32_t(v * float(height)), height - 1))];
+				for (int32_t x = 0; x < dst->width; x++)
+					out[x] = row[vCol0[x]];
+			}
+			else
+			{
+				int32_t r0, r1; uint32_t wy;
+				BilerpCoord(v, height, r0, r1, wy);
+				const Pixel* row0 = &pColData[RowOffset(r0)];
+				const Pixel* row1 = &pColData[RowOffset(r1)];
+				for (int32_t x = 0; x < dst->width; x++)
+					out[x] = BilerpFixed(row0[vCol0[x]], row0[vCol1[x]], row1[vCol0[x]], row1[vCol1[x]], vColW[x], wy);
+			}
+		}
+	}
+
+	Pixel* Sprite::GetData()
+	{ return pColData.data(); }
+
+
+	alo::rcode Sprite::LoadFromFile(const std::string& sImageFile, alo::ResourcePack* pack)
+	{
+		UNUSED(pack);
+		layout = Layout::LINEAR;
+		return loader->LoadImageResource(this, sImageFile, pack);
+	}
+
+	alo::Sprite* Sprite::Duplicate()
+	{
+		alo::Sprite* spr = new alo::Sprite(0, 0);
+		spr->width = width; spr->height = height;
+		spr->pColData = pColData;
+		spr->layout = layout;
+		spr->nTilesX = nTilesX;
+		spr->modeSample = modeSample;
+		return spr;
+	}
+
+	alo::Sprite* Sprite::Duplicate(const alo::vi2d& vPos, const alo::vi2d& vSize)
+	{
+		alo::Sprite* spr = new alo::Sprite(vSize.x, vSize.y, false);
+		if (vPos.x >= 0 && vPos.y >= 0 && vPos.x + vSize.x <= width && vPos.y + vSize.y <= height)
+		{
+			// Wholly inside, so copy rows straight across
+			for (int y = 0; y < vSize.y; y++)
+				ReadRow(vPos.x, vPos.y + y, vSize.x, spr->GetData() + size_t(y) * spr->width);
+		}
+		else
+		{
+			// Outside pixels depend on the sample mode
+			for (int y = 0; y < vSize.y; y++)
+				for (int x = 0; x < vSize.x; x++)
+					spr->SetPixel(x, y, GetPixel(vPos.x + x, vPos.y + y));
+		}
+		return spr;
+	}
+
+	alo::vi2d alo::Sprite::Size() const
+	{
+		return { width, height };
+	}
+
+	alo::SpriteView Sprite::View()
+	{
+		if (layout != Layout::LINEAR) return alo::SpriteView();
+		return alo::SpriteView(pColData.data(), width, height, width);
+	}
+
+	void Sprite::ReadRow(int32_t x, int32_t y, int32_t n, alo::Pixel* dst) const
+	{
+		if (layout == Layout::LINEAR)
+		{
+			std::memcpy(dst, &pColData[Index(x, y)], size_t(n) * sizeof(alo::Pixel));
+			return;
+		}
+
+		// A tile row at a time
+		while (n > 0)
+		{
+			int32_t k = std::min(8 - (x & 7), n);
+			std::memcpy(dst, &pColData[Index(x, y)], size_t(k) * sizeof(alo::Pixel));
+			dst += k; x += k; n -= k;
+		}
+	}
+
+	void Sprite::SetLayout(alo::Sprite::Layout l)
+	{
+		if (l == layout) return;
+		alo::PixelBuffer vData;
+		if (l == Layout::TILED)
+		{
+			// Edge tiles are padded out to a full 8x8
+			int32_t nTilesY = (height + 7) >> 3;
+			nTilesX = (width + 7) >> 3;
+			vData.resize(size_t(nTilesX) * size_t(nTilesY) * 64, nDefaultPixel);
+			layout = l;
+			for (int32_t y = 0; y < height; y++)
+				for (int32_t x = 0; x < width; x += 8)
+					std::memcpy(&vData[Index(x, y)], &pColData[size_t(y) * width + x], size_t(std::min(8, width - x)) * sizeof(alo::Pixel));
+		}
+		else
+		{
+			vData.resize(size_t(width) * size_t(height));
+			for (int32_t y = 0; y < height; y++)
+				ReadRow(0, y, width, &vData[size_t(y) * width]);
+			layout = l;
+			nTilesX = 0;
+		}
+		pColData.swap(vData);
+	}
+
+	alo::SpriteView Sprite::View(const alo::vi2d& vPos, const alo::vi2d& vSize)
+	{ return View().SubView(vPos, vSize); }
+
+	// O------------------------------------------------------------------------------O
+	// | alo::SpriteView IMPLEMENTATION                                               |
+	// O------------------------------------------------------------------------------O
+	SpriteView::SpriteView(alo::Pixel* data, int32_t w, int32_t h, int32_t stride)
+		: data(data), width(w), height(h), stride(stride > 0 ? stride : w)
+	{ }
+
+	bool SpriteView::IsAligned(size_t nBytes) const
+	{
+		return (reinterpret_cast<uintptr_t>(data) % nBytes) == 0
+			&& ((size_t(stride) * sizeof(alo::Pixel)) % nBytes) == 0;
+	}
+
+	alo::SpriteView SpriteView::SubView(const alo::vi2d& vPos, const alo::vi2d& vSize) const
+	{
+		int32_t x0 = std::clamp(vPos.x, 0, width), x1 = std::clamp(vPos.x + vSize.x, x0, width);
+		int32_t y0 = std::clamp(vPos.y, 0, height), y1 = std::clamp(vPos.y + vSize.y, y0, height);
+		if (data == nullptr || x0 == x1 || y0 == y1) return alo::SpriteView();
+		return alo::SpriteView(Row(y0) + x0, x1 - x0, y1 - y0, stride);
+	}
+
+	int32_t SpriteView::AlignedStride(int32_t w, size_t nBytes)
+	{
+		size_t nPixels = std::max(nBytes / sizeof(alo::Pixel), size_t(1));
+		return int32_t((size_t(w) + nPixels - 1) / nPixels * nPixels);
+	}
+
+	// O------------------------------------------------------------------------------O
+	// | alo::Decal IMPLEMENTATION                                                    |
+	// O------------------------------------------------------------------------------O
+	Decal::Decal(alo::Sprite* spr, bool filter, bool clamp)
+	{
+		id = -1;
+		if (spr == nullptr) return;
+		sprite = spr;
+		id = renderer->CreateTexture(sprite->width, sprite->height, filter, clamp);
+		Update();
+	}
+
+	Decal::Decal(const uint32_t nExistingTextureResource, alo::Sprite* spr)
+	{
+		if (spr == nullptr) return;
+		id = nExistingTextureResource;
+		vSize = spr->Size();
+	}
+
+	Decal::Decal(const alo::Decal& parent, const alo::vi2d& pos, const alo::vi2d& size)
+	{
+		id = parent.id;
+		bOwnsTexture = false;
+		vSize = size;
+		vUVScale = parent.vUVScale;
+		vUVOffset = parent.vUVOffset + alo::vf2d(pos) * parent.vUVScale;
+		vUVExtent = alo::vf2d(size) * parent.vUVScale;
+	}
+
+	Decal::Decal(const alo::vi2d& size, bool filter)
+	{
+		id = renderer->CreateTexture(size.x, size.y, filter, true);
+		vSize = size;
+		// Rows are drawn in bottom up, so the image is read from the bottom
+		// and source rows count down from there
+		vUVScale = { 1.0f / float(size.x), -1.0f / float(size.y) };
+		vUVOffset = { 0.0f, 1.0f };
+		vUVExtent = { 1.0f, -1.0f };
+		nTarget = renderer->CreateTarget(id, size);
+	}
+
+	void Decal::Update()
+	{
+		if (sprite == nullptr) return;
+		vSize = sprite->Size();
+		vUVScale = { 1.0f / float(sprite->width), 1.0f / float(sprite->height) };
+		renderer->ApplyTexture(id);
+		if (sprite->GetLayout() == alo::Sprite::Layout::LINEAR)
+			renderer->UpdateTexture(id, sprite);
+		else
+		{
+			// Textures are always uploaded linear
+			alo::PixelBuffer vLinear(size_t(sprite->width) * size_t(sprite->height));
+			for (int32_t y = 0; y < sprite->height; y++)
+				sprite->ReadRow(0, y, sprite->width, &vLinear[size_t(y) * sprite->width]);
+			renderer->UpdateTexture(id, alo::SpriteView(vLinear.data(), sprite->width, sprite->height));
+		}
+	}
+
+	void Decal::Update(const alo::vi2d& pos, const alo::vi2d& size)
+	{
+		if (sprite == nullptr) return;
+		if (sprite->GetLayout() != alo::Sprite::Layout::LINEAR || vSize != sprite->Size())
+		{
+			Update();
+			return;
+		}
+		renderer->ApplyTexture(id);
+		renderer->UpdateTexture(id, sprite, pos, size);
+	}
+
+	void Decal::Update(const alo::SpriteView& view)
+	{
+		if (!view.IsValid()) return;
+		vSize = view.Size();
+		vUVScale = { 1.0f / float(view.width), 1.0f / float(view.height) };
+		renderer->ApplyTexture(id);
+		renderer->UpdateTexture(id, view);
+	}
+
+	void Decal::UpdateSprite()
+	{
+		if (sprite == nullptr) return;
+		alo::Sprite::Layout layout = sprite->GetLayout();
+		sprite->SetLayout(alo::Sprite::Layout::LINEAR);
+		renderer->ApplyTexture(id);
+		renderer->ReadTexture(id, sprite);
+		sprite->SetLayout(layout);
+	}
+
+	Decal::~Decal()
+	{
+		if (pTargetOwner != nullptr)
+			pTargetOwner->DropDecalTarget(this);
+		if (nTarget != 0)
+			renderer->DeleteTarget(nTarget);
+		if (id != -1 && bOwnsTexture)
+		{
+			renderer->DeleteTexture(id);
+			id = -1;
+		}
+	}
+
+	void Renderable::Create(uint32_t width, uint32_t height, bool filter, bool clamp)
+	{
+		pSprite = std::make_unique<alo::Sprite>(width, height);
+		pDecal = std::make_unique<alo::Decal>(pSprite.get(), filter, clamp);
+	}
+
+	alo::rcode Renderable::Load(const std::string& sFile, ResourcePack* pack, bool filter, bool clamp)
+	{
+		pSprite = std::make_unique<alo::Sprite>();
+		if (pSprite->LoadFromFile(sFile, pack) == alo::rcode::OK)
+		{
+			pDecal = std::make_unique<alo::Decal>(pSprite.get(), filter, clamp);
+			return alo::rcode::OK;
+		}
+		else
+		{
+			pSprite.release();
+			pSprite = nullptr;
+			return alo::rcode::NO_FILE;
+		}
+	}
+
+	alo::Decal* Renderable::Decal() const
+	{ return pDecal.get(); }
+
+	alo::Sprite* Renderable::Sprite() const
+	{ return pSprite.get(); }
+
+	// O------------------------------------------------------------------------------O
+	// | alo::DecalAtlas IMPLEMENTATION                                               |
+	// O------------------------------------------------------------------------------O
+	DecalAtlas::DecalAtlas(int32_t nPageSize, bool filter, int32_t nPadding, int32_t nMaxPages)
+		: nPageSize(nPageSize), nPadding(std::max(nPadding, 0)), nMaxPages(std::max(nMaxPages, 0)), bFilter(filter)
+	{ }
+
+	alo::Decal* DecalAtlas::Add(const alo::SpriteView& view)
+	{
+		// Padding on the right and below keeps filtered samples off the neighbours
+		const alo::vi2d vPadded = view.Size() + alo::vi2d(nPadding, nPadding);
+		if (!view.IsValid() || vPadded.x > nPageSize || vPadded.y > nPageSize)
+			return nullptr;
+
+		AtlasPage* page = nullptr;
+		alo::vi2d pos;
+		for (auto& p : vPages)
+			if (Place(*p, vPadded, pos)) { page = p.get(); break; }
+
+		if (page == nullptr)
+		{
+			if (nMaxPages > 0 && vPages.size() >= size_t(nMaxPages)) return nullptr;
+			vPages.push_back(std::make_unique<AtlasPage>());
+			page = vPages.back().get();
+			page->image.Create(nPageSize, nPageSize, bFilter, true);
+			std::fill(page->image.Sprite()->pColData.begin(), page->image.Sprite()->pColData.end(), alo::BLANK);
+			page->image.Decal()->Update();
+			page->vSkyline = { { 0, 0, nPageSize } };
+			Place(*page, vPadded, pos);
+		}
+
+		Write(*page, pos, view);
+		Entry entry;
+		entry.decal = std::make_unique<alo::Decal>(*page->image.Decal(), pos, view.Size());
+		entry.page = page;
+		entry.pos = pos;
+		alo::Decal* decal = entry.decal.get();
+		mapEntries.emplace(decal, std::move(entry));
+		return decal;
+	}
+
+	alo::Decal* DecalAtlas::Add(alo::Sprite* spr)
+	{ return spr == nullptr ? nullptr : Add(spr->View()); }
+
+	void DecalAtlas::Update(const alo::Decal* entry, const alo::SpriteView& view)
+	{
+		auto it = mapEntries.find(entry);
+		if (it == mapEntries.end() || view.Size() != entry->vSize) return;
+		Write(*it->second.page, it->second.pos, view);
+	}
+
+	void DecalAtlas::Clear()
+	{
+		mapEntries.clear();
+		vPages.clear();
+	}
+
+	bool DecalAtlas::Place(AtlasPage& page, const alo::vi2d& size, alo::vi2d& pos) const
+	{
+		// Try the image's left edge at the start of each span, resting on the
+		// highest span beneath it, and keep the lowest position
+		std::vector<Span>& sky = page.vSkyline;
+		size_t nBest = sky.size();
+		int32_t nBestY = nPageSize;
+		for (size_t i = 0; i < sky.size() && sky[i].x + size.x <= nPageSize; i++)
+		{
+			int32_t y = 0;
+			for (size_t j = i; j < sky.size() && sky[j].x < sky[i].x + size.x; j++)
+				y = std::max(y, sky[j].y);
+			if (y + size.y <= nPageSize && y < nBestY) { nBest = i; nBestY = y; }
+		}
+		if (nBest == sky.size()) return false;
+		pos = { sky[nBest].x, nBestY };
+
+		// Raise the skyline under the image, trimming the spans it covers
+		const int32_t nRight = pos.x + size.x;
+		size_t j = nBest;
+		while (j < sky.size() && sky[j].x + sky[j].w <= nRight) j++;
+		if (j < sky.size() && sky[j].x < nRight) { sky[j].w -= nRight - sky[j].x; sky[j].x = nRight; }
+		sky.erase(sky.begin() + nBest, sky.begin() + j);
+		sky.insert(sky.begin() + nBest, { pos.x, pos.y + size.y, size.x });
+
+		for (size_t i = 1; i < sky.size();)
+			if (sky[i].y == sky[i - 1].y) { sky[i - 1].w += sky[i].w; sky.erase(sky.begin() + i); }
+			else i++;
+		return true;
+	}
+
+	void DecalAtlas::Write(AtlasPage& page, const alo::vi2d& pos, const alo::SpriteView& view)
+	{
+		alo::Sprite* spr = page.image.Sprite();
+		for (int32_t y = 0; y < view.height; y++)
+			std::memcpy(spr->GetData() + size_t(pos.y + y) * spr->width + pos.x, view.Row(y), sizeof(alo::Pixel) * view.width);
+		page.image.Decal()->Update(pos, view.Size());
+	}
+
+	// O------------------------------------------------------------------------------O
+	// | alo::ResourcePack IMPLEMENTATION                                             |
+	// O------------------------------------------------------------------------------O
+
+
+	//=============================================================
+	// Resource Packs - Allows you to store files in one large 
+	// scrambled file 
+	ResourceBuffer::ResourceBuffer(std::ifstream& ifs, uint32_t offset, uint32_t size)
+	{
+		vMemory.resize(size);
+		ifs.seekg(offset); ifs.read(vMemory.data(), vMemory.size());
+		setg(vMemory.data(), vMemory.data(), vMemory.data() + size);
+	}
+
+	ResourcePack::ResourcePack() { }
+	ResourcePack::~ResourcePack() { baseFile.close(); }
+
+	bool ResourcePack::AddFile(const std::string& sFile)
+	{
+		const std::string file = makeposix(sFile);
+
+		if (_gfs::exists(file))
+		{
+			sResourceFile e;
+			e.nSize = (uint32_t)_gfs::file_size(file);
+			e.nOffset = 0; // Unknown at this stage			
+			mapFiles[file] = e;
+			return true;
+		}
+		return false;
+	}
+
+	bool ResourcePack::LoadPack(const std::string& sFile, const std::string& sKey)
+	{
+		// Open the resource file
+		baseFile.open(sFile, std::ifstream::binary);
+		if (!baseFile.is_open()) return false;
+
+		// 1) Read Scrambled index
+		uint32_t nIndexSize = 0;
+		baseFile.read((char*)&nIndexSize, sizeof(uint32_t));
+
+		std::vector<char> buffer(nIndexSize);
+		for (uint32_t j = 0; j < nIndexSize; j++)
+			buffer[j] = baseFile.get();
+
+		std::vector<char> decoded = scramble(buffer, sKey);
+		size_t pos = 0;
+		auto read = [&decoded, &pos](char* dst, size_t size) {
+			memcpy((void*)dst, (const void*)(decoded.data() + pos), size);
+			pos += size;
+		};
+
+		auto get = [&read]() -> int { char c; read(&c, 1); return c; };
+
+		// 2) Read Map
+		uint32_t nMapEntries = 0;
+		read((char*)&nMapEntries, sizeof(uint32_t));
+		for (uint32_t i = 0; i < nMapEntries; i++)
+		{
+			uint32_t nFilePathSize = 0;
+			read((char*)&nFilePathSize, sizeof(uint32_t));
+
+			std::string sFileName(nFilePathSize, ' ');
+			for (uint32_t j = 0; j < nFilePathSize; j++)
+				sFileName[j] = get();
+
+			sResourceFile e;
+			read((char*)&e.nSize, sizeof(uint32_t));
+			read((char*)&e.nOffset, sizeof(uint32_t));
+			mapFiles[sFileName] = e;
+		}
+
+		// Don't close base file! we will provide a stream
+		// pointer when the file is requested
+		return true;
+	}
+
+	bool ResourcePack::SavePack(const std::string& sFile, const std::string& sKey)
+	{
+		// Create/Overwrite the resource file
+		std::ofstream ofs(sFile, std::ofstream::binary);
+		if (!ofs.is_open()) return false;
+
+		// Iterate through map
+		uint32_t nIndexSize = 0; // Unknown for now
+		ofs.write((char*)&nIndexSize, sizeof(uint32_t));
+		uint32_t nMapSize = uint32_t(mapFiles.size());
+		ofs.write((char*)&nMapSize, sizeof(uint32_t));
+		for (auto& e : mapFiles)
+		{
+			// Write the path of the file
+			size_t nPathSize = e.first.size();
+			ofs.write((char*)&nPathSize, sizeof(uint32_t));
+			ofs.write(e.first.c_str(), nPathSize);
+
+			// Write the file entry properties
+			ofs.write((char*)&e.second.nSize, sizeof(uint32_t));
+			ofs.write((char*)&e.second.nOffset, sizeof(uint32_t));
+		}
+
+		// 2) Write the individual Data
+		std::streampos offset = ofs.tellp();
+		nIndexSize = (uint32_t)offset;
+		for (auto& e : mapFiles)
+		{
+			// Store beginning of file offset within resource pack file
+			e.second.nOffset = (uint32_t)offset;
+
+			// Load the file to be added
+			std::vector<uint8_t> vBuffer(e.second.nSize);
+			std::ifstream i(e.first, std::ifstream::binary);
+			i.read((char*)vBuffer.data(), e.second.nSize);
+			i.close();
+
+			// Write the loaded file into resource pack file
+			ofs.write((char*)vBuffer.data(), e.second.nSize);
+			offset += e.second.nSize;
+		}
+
+		// 3) Scramble Index
+		std::vector<char> stream;
+		auto write = [&stream](const char* data, size_t size) {
+			size_t sizeNow = stream.size();
+			stream.resize(sizeNow + size);
+			memcpy(stream.data() + sizeNow, data, size);
+		};
+
+		// Iterate through map
+		write((char*)&nMapSize, sizeof(uint32_t));
+		for (auto& e : mapFiles)
+		{
+			// Write the path of the file
+			size_t nPathSize = e.first.size();
+			write((char*)&nPathSize, sizeof(uint32_t));
+			write(e.first.c_str(), nPathSize);
+
+			// Write the file entry properties
+			write((char*)&e.second.nSize, sizeof(uint32_t));
+			write((char*)&e.second.nOffset, sizeof(uint32_t));
+		}
+		std::vector<char> sIndexString = scramble(stream, sKey);
+		uint32_t nIndexStringLen = uint32_t(sIndexString.size());
+		// 4) Rewrite Map (it has been updated with offsets now)
+		// at start of file
+		ofs.seekp(0, std::ios::beg);
+		ofs.write((char*)&nIndexStringLen, sizeof(uint32_t));
+		ofs.write(sIndexString.data(), nIndexStringLen);
+		ofs.close();
+		return true;
+	}
+
+	ResourceBuffer ResourcePack::GetFileBuffer(const std::string& sFile)
+	{ return ResourceBuffer(baseFile, mapFiles[sFile].nOffset, mapFiles[sFile].nSize); }
+
+	bool ResourcePack::Loaded()
+	{ return baseFile.is_open(); }
+
+	std::vector<char> ResourcePack::scramble(const std::vector<char>& data, const std::string& key)
+	{
+		if (key.empty()) return data;
+		std::vector<char> o;
+		size_t c = 0;
+		for (auto s : data)	o.push_back(s ^ key[(c++) % key.size()]);
+		return o;
+	};
+
+	std::string ResourcePack::makeposix(const std::string& path)
+	{
+		std::string o;
+		for (auto s : path) o += std::string(1, s == '\\' ? '/' : s);
+		return o;
+	};
+
+	// O------------------------------------------------------------------------------O
+	// | alo::Blit - Row kernels behind the CPU sprite drawing routines               |
+	// O------------------------------------------------------------------------------O
+	namespace Blit
+	{
+		// All kernels write n pixels to dst. If bFlip is set, src points at the
+		// first source pixel to use and the row is read backwards from there
+
+#if defined(ALO_SIMD_SSE2)
+		inline __m128i Load4(const Pixel* src, int32_t i, bool bFlip)
+		{
+			if (!bFlip) return _mm_loadu_si128((const __m128i*)(src + i));
+			return _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)(src - i - 3)), _MM_SHUFFLE(0, 1, 2, 3));
+		}
+#endif
+
+		void CopyRow(Pixel* dst, const Pixel* src, int32_t n, bool bFlip)
+		{
+			if (!bFlip)
+			{
+				std::memmove(dst, src, size_t(n) * sizeof(Pixel));
+				return;
+			}
+
+			int32_t i = 0;
+#if defined(ALO_SIMD_SSE2)
+			for (; i + 4 <= n; i += 4)
+				_mm_storeu_si128((__m128i*)(dst + i), Load4(src, i, true));
+#endif
+			for (; i < n; i++) dst[i] = src[-i];
+		}
+
+		// Pixel::MASK - only fully opaque source pixels are written
+		void MaskRow(Pixel* dst, const Pixel* src, int32_t n, bool bFlip)
+		{
+			int32_t i = 0;
+#if defined(ALO_SIMD_SSE2)
+			const __m128i vAlpha = _mm_set1_epi32(int32_t(0xFF000000));
+			for (; i + 4 <= n; i += 4)
+			{
+				__m128i s = Load4(src, i, bFlip);
+				__m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+				__m128i m = _mm_cmpeq_epi32(_mm_and_si128(s, vAlpha), vAlpha);
+				_mm_storeu_si128((__m128i*)(dst + i), _mm_or_si128(_mm_and_si128(m, s), _mm_andnot_si128(m, d)));
+			}
+#endif
+			for (; i < n; i++)
+			{
+				Pixel s = bFlip ? src[-i] : src[i];
+				if (s.a == 255) dst[i] = s;
+			}
+		}
+
+		// Pixel::ALPHA - same float arithmetic as GameEngine::Draw(), so both
+		// paths produce identical results
+		void AlphaRow(Pixel* dst, const Pixel* src, int32_t n, float fBlend, bool bFlip)
+		{
+			int32_t i = 0;
+#if defined(ALO_SIMD_SSE2)
+			const __m128 vBlend = _mm_set1_ps(fBlend);
+			const __m128 v255 = _mm_set1_ps(255.0f);
+			const __m128 vOne = _mm_set1_ps(1.0f);
+			const __m128i vZero = _mm_setzero_si128();
+			const __m128i vOpaque = _mm_set1_epi32(int32_t(0xFF000000));
+
+			// One pixel per register, channels as floats
+			auto blend = [&](__m128i s32, __m128i d32)
+			{
+				__m128 sf = _mm_cvtepi32_ps(s32);
+				__m128 df = _mm_cvtepi32_ps(d32);
+				__m128 a = _mm_mul_ps(_mm_div_ps(_mm_shuffle_ps(sf, sf, _MM_SHUFFLE(3, 3, 3, 3)), v255), vBlend);
+				__m128 c = _mm_sub_ps(vOne, a);
+				return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(a, sf), _mm_mul_ps(c, df)));
+			};
+
+			for (; i + 4 <= n; i += 4)
+			{
+				__m128i s = Load4(src, i, bFlip);
+				__m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+				__m128i slo = _mm_unpacklo_epi8(s, vZero), shi = _mm_unpackhi_epi8(s, vZero);
+				__m128i dlo = _mm_unpacklo_epi8(d, vZero), dhi = _mm_unpackhi_epi8(d, vZero);
+				__m128i p0 = blend(_mm_unpacklo_epi16(slo, vZero), _mm_unpacklo_epi16(dlo, vZero));
+				__m128i p1 = blend(_mm_unpackhi_epi16(slo, vZero), _mm_unpackhi_epi16(dlo, vZero));
+				__m128i p2 = blend(_mm_unpacklo_epi16(shi, vZero), _mm_unpacklo_epi16(dhi, vZero));
+				__m128i p3 = blend(_mm_unpackhi_epi16(shi, vZero), _mm_unpackhi_epi16(dhi, vZero));
+				__m128i o = _mm_packus_epi16(_mm_packs_epi32(p0, p1), _mm_packs_epi32(p2, p3));
+				_mm_storeu_si128((__m128i*)(dst + i), _mm_or_si128(o, vOpaque));
+			}
+#endif
+			for (; i < n; i++)
+			{
+				Pixel s = bFlip ? src[-i] : src[i];
+				Pixel d = dst[i];
+				float a = (float)(s.a / 255.0f) * fBlend;
+				float c = 1.0f - a;
+				float r = a * (float)s.r + c * (float)d.r;
+				float g = a * (float)s.g + c * (float)d.g;
+				float b = a * (float)s.b + c * (float)d.b;
+				dst[i] = Pixel((uint8_t)r, (uint8_t)g, (uint8_t)b);
+			}
+		}
+	}
+
+	// O------------------------------------------------------------------------------O
+	// | alo::Raster IMPLEMENTATION                                                   |
+	// O------------------------------------------------------------------------------O
+	namespace Raster
+	{
+		// Calls op(Pixel& dst, x, y, src) with the pen's blend already chosen, so
+		// the per pixel work carries no mode switch
+		template<typename F>
+		void WithPen(const alo::Raster::Pen& pen, F&& op)
+		{
+			switch (pen.mode)
+			{
+			case alo::Pixel::NORMAL:
+				op([](Pixel& d, int32_t, int32_t, const Pixel s) { d = s; });
+				break;
+			case alo::Pixel::MASK:
+				op([](Pixel& d, int32_t, int32_t, const Pixel s) { if (s.a == 255) d = s; });
+				break;
+			case alo::Pixel::ALPHA:
+				op([fBlend = pen.fBlendFactor](Pixel& d, int32_t, int32_t, const Pixel s)
+				{
+					// Same arithmetic as GameEngine::Draw()
+					float a = (float)(s.a / 255.0f) * fBlend;
+					float c = 1.0f - a;
+					float r = a * (float)s.r + c * (float)d.r;
+					float g = a * (float)s.g + c * (float)d.g;
+					float b = a * (float)s.b + c * (float)d.b;
+					d = Pixel((uint8_t)r, (uint8_t)g, (uint8_t)b);
+				});
+				break;
+			case alo::Pixel::CUSTOM:
+				if (pen.funcPixelMode)
+					op([&f = pen.funcPixelMode](Pixel& d, int32_t x, int32_t y, const Pixel s) { d = f(x, y, s, d); });
+				break;
+			}
+		}
+
+		// The stepping of GameEngine::DrawLine(), which always walks from the end
+		// with the lower major coordinate. The start point (x1,y1) is not plotted.
+		template<typename F>
+		void WalkLine(int32_t x1, int32_t y1, int32_t x2, int32_t y2, F&& plot)
+		{
+			int32_t dx = x2 - x1, dy = y2 - y1;
+			int32_t dx1 = std::abs(dx), dy1 = std::abs(dy);
+			int32_t nSteps = std::max(dx1, dy1);
+			if (nSteps == 0) return;
+			const int32_t nMinor = ((dx < 0 && dy < 0) || (dx > 0 && dy > 0)) ? 1 : -1;
+
+			if (dy1 <= dx1)
+			{
+				const bool bForward = dx >= 0;
+				int32_t x = bForward ? x1 : x2, y = bForward ? y1 : y2;
+				int32_t px = 2 * dy1 - dx1;
+				if (!bForward) plot(x, y);
+				for (int32_t i = 1; i <= nSteps; i++)
+				{
+					x++;
+					if (px < 0) px += 2 * dy1;
+					else { y += nMinor; px += 2 * (dy1 - dx1); }
+					if (bForward || i < nSteps) plot(x, y);
+				}
+			}
+			else
+			{
+				const bool bForward = dy >= 0;
+				int32_t x = bForward ? x1 : x2, y = bForward ? y1 : y2;
+				int32_t py = 2 * dx1 - dy1;
+				if (!bForward) plot(x, y);
+				for (int32_t i = 1; i <= nSteps; i++)
+				{
+					y++;
+					if (py <= 0) py += 2 * dx1;
+					else { x += nMinor; py += 2 * (dx1 - dy1); }
+					if (bForward || i < nSteps) plot(x, y);
+				}
+			}
+		}
+
+		// Bounding box of the points, half open, and that box clipped to the target
+		template<typename T>
+		bool Bounds(const alo::SpriteView& target, const T* pPoints, size_t nPoints, alo::DirtyRegion::Rect& rBox, alo::DirtyRegion::Rect& rClip)
+		{
+			if (!target.IsValid() || nPoints == 0) return false;
+			alo::vi2d vMin = alo::vi2d(pPoints[0]), vMax = vMin;
+			for (size_t i = 1; i < nPoints; i++)
+			{
+				alo::vi2d p = alo::vi2d(pPoints[i]);
+				vMin = vMin.min(p); vMax = vMax.max(p);
+			}
+			rBox = { vMin.x, vMin.y, vMax.x + 1, vMax.y + 1 };
+			rClip = { std::max(rBox.x0, 0), std::max(rBox.y0, 0), std::min(rBox.x1, target.width), std::min(rBox.y1, target.height) };
+			return rClip.x0 < rClip.x1 && rClip.y0 < rClip.y1;
+		}
+
+		alo::DirtyRegion::Rect DrawPolyline(const alo::SpriteView& target, const alo::vf2d* pPoints, size_t nPoints,
+			const alo::Pixel* pColours, size_t nColours, const alo::Raster::Pen& pen)
+		{
+			alo::DirtyRegion::Rect rBox, rClip;
+			if (nColours == 0 || !Bounds(target, pPoints, nPoints, rBox, rClip)) return {};
+
+			// Clipping is decided once for the whole batch, and then only for
+			// segments that straddle the edge of the target
+			const bool bInside = rBox.x0 == rClip.x0 && rBox.y0 == rClip.y0 && rBox.x1 == rClip.x1 && rBox.y1 == rClip.y1;
+			const int32_t w = target.width, h = target.height;
+
+			WithPen(pen, [&](auto blend)
+			{
+				Pixel col = pColours[0];
+				auto plot = [&](int32_t x, int32_t y) { blend(target.Row(y)[x], x, y, col); };
+				auto plotClipped = [&](int32_t x, int32_t y) { if (x >= 0 && y >= 0 && x < w && y < h) blend(target.Row(y)[x], x, y, col); };
+
+				const alo::vi2d vFirst = alo::vi2d(pPoints[0]);
+				alo::vi2d a = vFirst;
+				if (bInside) plot(a.x, a.y); else plotClipped(a.x, a.y);
+
+				for (size_t i = 1; i < nPoints; i++)
+				{
+					alo::vi2d b = alo::vi2d(pPoints[i]);
+					col = pColours[(i - 1) % nColours];
+					if (i == nPoints - 1 && b == vFirst)
+					{
+						// A closed loop ends on the pixel it started with
+						WalkLine(a.x, a.y, b.x, b.y, [&](int32_t x, int32_t y) { if (x != vFirst.x || y != vFirst.y) plotClipped(x, y); });
+					}
+					else if (bInside)
+						WalkLine(a.x, a.y, b.x, b.y, plot);
+					else if (std::max(a.x, b.x) >= 0 && std::max(a.y, b.y) >= 0 && std::min(a.x, b.x) < w && std::min(a.y, b.y) < h)
+					{
+						if (std::min(a.x, b.x) >= 0 && std::min(a.y, b.y) >= 0 && std::max(a.x, b.x) < w && std::max(a.y, b.y) < h)
+							WalkLine(a.x, a.y, b.x, b.y, plot);
+						else
+							WalkLine(a.x, a.y, b.x, b.y, plotClipped);
+					}
+					a = b;
+				}
+			});
+			return rClip;
+		}
+
+		alo::DirtyRegion::Rect DrawPoints(const alo::SpriteView& target, const alo::vi2d* pPoints, size_t nPoints,
+			alo::Pixel p, const alo::Raster::Pen& pen)
+		{
+			alo::DirtyRegion::Rect rBox, rClip;
+			if (!Bounds(target, pPoints, nPoints, rBox, rClip)) return {};
+			const bool bInside = rBox.x0 == rClip.x0 && rBox.y0 == rClip.y0 && rBox.x1 == rClip.x1 && rBox.y1 == rClip.y1;
+
+			WithPen(pen, [&](auto blend)
+			{
+				if (bInside)
+				{
+					for (size_t i = 0; i < nPoints; i++)
+						blend(target.Row(pPoints[i].y)[pPoints[i].x], pPoints[i].x, pPoints[i].y, p);
+				}
+				else
+				{
+					for (size_t i = 0; i < nPoints; i++)
+					{
+						const alo::vi2d& v = pPoints[i];
+						if (v.x >= 0 && v.y >= 0 && v.x < target.width && v.y < target.height)
+							blend(target.Row(v.y)[v.x], v.x, v.y, p);
+					}
+				}
+			});
+			return rClip;
+		}
+
+		// x / 255 rounded to nearest, exact for x <= 65407
+		inline uint32_t Div255(uint32_t x) { x += 128; return (x + (x >> 8)) >> 8; }
+
+		// Blends p into n pixels, pixel i weighted by cov[i] * k / 255. The colour
+		// is composited as opaque, so opaque targets stay opaque. The SIMD and scalar
+		// paths give identical results.
+		void CoverRow(Pixel* dst, const uint8_t* cov, int32_t n, const Pixel p, uint32_t k)
+		{
+			int32_t i = 0;
+#if defined(ALO_SIMD_SSE2)
+			const __m128i vZero = _mm_setzero_si128();
+			const __m128i vK = _mm_set1_epi16(int16_t(k));
+			const __m128i v128 = _mm_set1_epi16(128);
+			const __m128i v255 = _mm_set1_epi16(255);
+			const __m128i vSrc = _mm_unpacklo_epi8(_mm_set1_epi32(int32_t(p.n | 0xFF000000)), vZero);
+			auto div255 = [&](__m128i x) { x = _mm_add_epi16(x, v128); return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8); };
+			auto blend = [&](__m128i d, __m128i a) { return div255(_mm_add_epi16(_mm_mullo_epi16(vSrc, a), _mm_mullo_epi16(d, _mm_sub_epi16(v255, a)))); };
+			for (; i + 4 <= n; i += 4)
+			{
+				int32_t c;
+				std::memcpy(&c, cov + i, sizeof(c));
+				if (c == 0) continue;
+				// Coverage of 4 pixels to 16 bit alphas, spread across each pixel's channels
+				__m128i a = div255(_mm_mullo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(c), vZero), vK));
+				a = _mm_unpacklo_epi16(a, a);
+				__m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+				__m128i lo = blend(_mm_unpacklo_epi8(d, vZero), _mm_unpacklo_epi32(a, a));
+				__m128i hi = blend(_mm_unpackhi_epi8(d, vZero), _mm_unpackhi_epi32(a, a));
+				_mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(lo, hi));
+			}
+#endif
+			for (; i < n; i++)
+			{
+				if (cov[i] == 0) continue;
+				uint32_t a = Div255(cov[i] * k), ia = 255 - a;
+				Pixel& d = dst[i];
+				d = Pixel(uint8_t(Div255(p.r * a + d.r * ia)), uint8_t(Div255(p.g * a + d.g * ia)),
+					uint8_t(Div255(p.b * a + d.b * ia)), uint8_t(Div255(255 * a + d.a * ia)));
+			}
+		}
+
+		// Stroke pieces in coordinates where pixel centres are integers
+		struct Capsule { float ax, ay, dx, dy, fInvLen2; };
+		// Convex quad as four edges n.p <= c, with unit normals
+		struct Quad { float nx[4], ny[4], c[4]; };
+
+		// Narrows [xl, xr] to the x where a * x + b lies in [lo, hi]
+		inline void ClipLinear(float a, float b, float lo, float hi, float& xl, float& xr)
+		{
+			if (std::abs(a) < 1e-6f)
+			{
+				if (b < lo || b > hi) { xl = 1.0f; xr = 0.0f; }
+				return;
+			}
+			float t1 = (lo - b) / a, t2 = (hi - b) / a;
+			xl = std::max(xl, std::min(t1, t2));
+			xr = std::min(xr, std::max(t1, t2));
+		}
+
+		// Maxes the coverage of a capsule of radius r along row y into cov, which
+		// holds columns [x0, x1). nMin and nMax grow to include the columns touched.
+		void CapsuleRow(const Capsule& c, float r, int32_t y, int32_t x0, int32_t x1, uint8_t* cov, int32_t& nMin, int32_t& nMax)
+		{
+			const float fReach = r + 0.5f, fy = float(y) - c.ay;
+
+			// Span of the row within reach, from the end discs and the body between
+			float lo = FLT_MAX, hi = -FLT_MAX;
+			auto disc = [&](float cx, float cy)
+			{
+				float h = fReach * fReach - cy * cy;
+				if (h < 0.0f) return;
+				h = std::sqrt(h);
+				lo = std::min(lo, cx - h); hi = std::max(hi, cx + h);
+			};
+			disc(0.0f, fy);
+			disc(c.dx, fy - c.dy);
+			if (c.fInvLen2 > 0.0f)
+			{
+				const float fLen = std::sqrt(c.dx * c.dx + c.dy * c.dy);
+				const float ux = c.dx / fLen, uy = c.dy / fLen;
+				float xl = -FLT_MAX, xr = FLT_MAX;
+				ClipLinear(ux, fy * uy, 0.0f, fLen, xl, xr);
+				ClipLinear(-uy, fy * ux, -fReach, fReach, xl, xr);
+				if (xl <= xr) { lo = std::min(lo, xl); hi = std::max(hi, xr); }
+			}
+			if (lo > hi) return;
+
+			int32_t xs = std::max(x0, int32_t(std::ceil(lo + c.ax)));
+			int32_t xe = std::min(x1 - 1, int32_t(std::floor(hi + c.ax)));
+			if (xs > xe) return;
+			nMin = std::min(nMin, xs - x0);
+			nMax = std::max(nMax, xe - x0);
+
+			// Coverage falls from 1 to 0 across the pixel straddling the edge
+			int32_t x = xs;
+			uint8_t* pCov = cov - x0;
+#if defined(ALO_SIMD_SSE2)
+			const __m128 vZero = _mm_setzero_ps(), vOne = _mm_set1_ps(1.0f);
+			const __m128 vFy = _mm_set1_ps(fy), vDx = _mm_set1_ps(c.dx), vDy = _mm_set1_ps(c.dy);
+			const __m128 vInv = _mm_set1_ps(c.fInvLen2), vReach = _mm_set1_ps(fReach);
+			const __m128 v255 = _mm_set1_ps(255.0f), vHalf = _mm_set1_ps(0.5f);
+			for (; x + 4 <= xe + 1; x += 4)
+			{
+				const float fx = float(x) - c.ax;
+				__m128 px = _mm_add_ps(_mm_set1_ps(fx), _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f));
+				__m128 t = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(px, vDx), _mm_mul_ps(vFy, vDy)), vInv);
+				t = _mm_min_ps(_mm_max_ps(t, vZero), vOne);
+				__m128 qx = _mm_sub_ps(px, _mm_mul_ps(t, vDx));
+				__m128 qy = _mm_sub_ps(vFy, _mm_mul_ps(t, vDy));
+				__m128 d = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(qx, qx), _mm_mul_ps(qy, qy)));
+				__m128 v = _mm_min_ps(_mm_max_ps(_mm_sub_ps(vReach, d), vZero), vOne);
+				__m128i n = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, v255), vHalf));
+				n = _mm_packus_epi16(_mm_packs_epi32(n, n), n);
+				int32_t old;
+				std::memcpy(&old, pCov + x, sizeof(old));
+				int32_t out = _mm_cvtsi128_si32(_mm_max_epu8(n, _mm_cvtsi32_si128(old)));
+				std::memcpy(pCov + x, &out, sizeof(out));
+			}
+#endif
+			for (; x <= xe; x++)
+			{
+				const float px = float(x) - c.ax;
+				float t = (px * c.dx + fy * c.dy) * c.fInvLen2;
+				t = std::min(std::max(t, 0.0f), 1.0f);
+				float qx = px - t * c.dx, qy = fy - t * c.dy;
+				float d = std::sqrt(qx * qx + qy * qy);
+				float v = std::min(std::max(fReach - d, 0.0f), 1.0f);
+				pCov[x] = std::max(pCov[x], uint8_t(v * 255.0f + 0.5f));
+			}
+		}
+
+		// As CapsuleRow() for a convex quad, using the distance to its furthest edge
+		void QuadRow(const Quad& q, int32_t y, int32_t x0, int32_t x1, uint8_t* cov, int32_t& nMin, int32_t& nMax)
+		{
+			const float fy = float(y);
+			float xl = -FLT_MAX, xr = FLT_MAX;
+			for (int e = 0; e < 4; e++)
+				ClipLinear(q.nx[e], q.ny[e] * fy - q.c[e], -FLT_MAX, 0.5f, xl, xr);
+			if (xl > xr) return;
+
+			int32_t xs = std::max(x0, int32_t(std::ceil(xl)));
+			int32_t xe = std::min(x1 - 1, int32_t(std::floor(xr)));
+			if (xs > xe) return;
+			nMin = std::min(nMin, xs - x0);
+			nMax = std::max(nMax, xe - x0);
+			for (int32_t x = xs; x <= xe; x++)
+			{
+				float sd = -FLT_MAX;
+				for (int e = 0; e < 4; e++)
+					sd = std::max(sd, q.nx[e] * float(x) + q.ny[e] * fy - q.c[e]);
+				float v = std::min(std::max(0.5f - sd, 0.0f), 1.0f);
+				cov[x - x0] = std::max(cov[x - x0], uint8_t(v * 255.0f + 0.5f));
+			}
+		}
+
+		alo::DirtyRegion::Rect DrawStroke(const alo::SpriteView& target, const alo::vf2d* pPoints, size_t nPoints, float fWidth,
+			alo::Pixel p, alo::Raster::Join join, const alo::Raster::Pen& pen, float fMiterLimit)
+		{
+			if (!target.IsValid() || nPoints == 0 || !(fWidth > 0.0f)) return {};
+			if (pen.mode == alo::Pixel::MASK && p.a != 255) return {};
+			if (pen.mode == alo::Pixel::CUSTOM && !pen.funcPixelMode) return {};
+			const float r = fWidth * 0.5f, fReach = r + 0.5f;
+
+			// Scratch is per thread, so strokes can be drawn in parallel
+			thread_local std::vector<alo::vf2d> vPts;
+			thread_local std::vector<Capsule> vCaps;
+			thread_local std::vector<Quad> vQuads;
+			thread_local std::vector<std::pair<float, float>> vSpanY;
+			thread_local std::vector<uint32_t> vBandStart, vBandShapes;
+			thread_local std::vector<uint8_t> vCoverage;
+			vPts.clear(); vCaps.clear(); vQuads.clear(); vSpanY.clear();
+
+			// Repeated points say nothing about direction, so drop them
+			for (size_t i = 0; i < nPoints; i++)
+			{
+				alo::vf2d v = pPoints[i] - alo::vf2d(0.5f, 0.5f);
+				if (vPts.empty() || v != vPts.back()) vPts.push_back(v);
+			}
+
+			alo::vf2d vMin = vPts[0], vMax = vPts[0];
+			for (const auto& v : vPts) { vMin = vMin.min(v); vMax = vMax.max(v); }
+
+			for (size_t i = 0; i < std::max(vPts.size(), size_t(2)) - 1; i++)
+			{
+				const alo::vf2d a = vPts[i], d = vPts.size() > 1 ? vPts[i + 1] - a : alo::vf2d(0.0f, 0.0f);
+				const float fLen2 = d.mag2();
+				vCaps.push_back({ a.x, a.y, d.x, d.y, fLen2 > 0.0f ? 1.0f / fLen2 : 0.0f });
+				vSpanY.push_back({ std::min(a.y, a.y + d.y) - fReach, std::max(a.y, a.y + d.y) + fReach });
+			}
+
+			// Round joins come free from the capsule ends. A miter only adds the
+			// kite between the outer edges, as the capsule ends fill the rest.
+			const size_t nLast = vPts.size() - 1;
+			const bool bClosed = vPts.size() > 3 && vPts.front() == vPts.back();
+			if (join == alo::Raster::Join::MITER && vPts.size() > 2)
+			{
+				for (size_t i = bClosed ? 0 : 1; i < nLast; i++)
+				{
+					const alo::vf2d v = vPts[i];
+					const alo::vf2d d0 = (v - vPts[i == 0 ? nLast - 1 : i - 1]).norm(), d1 = (vPts[i + 1] - v).norm();
+					const float fCross = d0.cross(d1), fDot = d0.dot(d1);
+					if (std::abs(fCross) < 1e-4f) continue;
+					const float fRatio = 1.0f / std::sqrt(std::max((1.0f + fDot) * 0.5f, 1e-12f));
+					if (fRatio > fMiterLimit) continue;
+
+					const float fSide = fCross > 0.0f ? -1.0f : 1.0f;
+					const alo::vf2d n0 = d0.perp() * fSide, n1 = d1.perp() * fSide;
+					const alo::vf2d vKite[4] = { v, v + n0 * r, v + (n0 + n1).norm() * (r * fRatio), v + n1 * r };
+
+					// Edges with outward unit normals, whichever way the kite winds
+					float fArea = 0.0f;
+					for (int e = 0; e < 4; e++) fArea += vKite[e].cross(vKite[(e + 1) % 4]);
+					Quad q;
+					for (int e = 0; e < 4; e++)
+					{
+						alo::vf2d en = (vKite[(e + 1) % 4] - vKite[e]).perp().norm() * (fArea > 0.0f ? -1.0f : 1.0f);
+						q.nx[e] = en.x; q.ny[e] = en.y; q.c[e] = en.dot(vKite[e]);
+					}
+					vQuads.push_back(q);
+					float y0 = FLT_MAX, y1 = -FLT_MAX;
+					for (const auto& k : vKite) { y0 = std::min(y0, k.y); y1 = std::max(y1, k.y); vMin = vMin.min(k); vMax = vMax.max(k); }
+					vSpanY.push_back({ y0 - 0.5f, y1 + 0.5f });
+				}
+			}
+
+			// Everything drawn lies within reach of the points and kites
+			alo::DirtyRegion::Rect rClip = {
+				std::max(int32_t(std::floor(vMin.x - fReach)), 0), std::max(int32_t(std::floor(vMin.y - fReach)), 0),
+				std::min(int32_t(std::ceil(vMax.x + fReach)) + 1, target.width), std::min(int32_t(std::ceil(vMax.y + fReach)) + 1, target.height) };
+			if (rClip.x0 >= rClip.x1 || rClip.y0 >= rClip.y1) return {};
+
+			// Shapes are sorted into bands of rows, and each band's coverage is
+			// built up, then blended into the target in one pass per row
+			constexpr int32_t nBandRows = 32;
+			const int32_t nWidth = rClip.x1 - rClip.x0;
+			const int32_t nBands = (rClip.y1 - rClip.y0 + nBandRows - 1) / nBandRows;
+			auto bandRange = [&](size_t s, int32_t& b0, int32_t& b1)
+			{
+				b0 = std::max(int32_t(std::floor(vSpanY[s].first)) - rClip.y0, 0) / nBandRows;
+				b1 = std::min(int32_t(std::ceil(vSpanY[s].second)) - rClip.y0, rClip.y1 - rClip.y0 - 1);
+				b1 = b1 < 0 ? -1 : b1 / nBandRows;
+			};
+			vBandStart.assign(size_t(nBands) + 1, 0);
+			for (size_t s = 0; s < vSpanY.size(); s++)
+			{
+				int32_t b0, b1; bandRange(s, b0, b1);
+				for (int32_t b = b0; b <= b1; b++) vBandStart[b + 1]++;
+			}
+			for (int32_t b = 0; b < nBands; b++) vBandStart[b + 1] += vBandStart[b];
+			vBandShapes.resize(vBandStart[nBands]);
+			for (size_t s = 0; s < vSpanY.size(); s++)
+			{
+				int32_t b0, b1; bandRange(s, b0, b1);
+				for (int32_t b = b0; b <= b1; b++) vBandShapes[vBandStart[b]++] = uint32_t(s);
+			}
+			// Filling moved each band's start up to the next band's start
+			for (int32_t b = nBands; b > 0; b--) vBandStart[b] = vBandStart[b - 1];
+			vBandStart[0] = 0;
+
+			// Coverage rows are returned to zero after blending
+			if (vCoverage.size() < size_t(nWidth) * nBandRows) vCoverage.assign(size_t(nWidth) * nBandRows, 0);
+			int32_t vRowMin[nBandRows], vRowMax[nBandRows];
+
+			const uint32_t k = pen.mode == alo::Pixel::ALPHA ? uint32_t(float(p.a) * pen.fBlendFactor + 0.5f) : 255;
+			for (int32_t b = 0; b < nBands; b++)
+			{
+				const int32_t by0 = rClip.y0 + b * nBandRows, by1 = std::min(by0 + nBandRows, rClip.y1);
+				for (int32_t i = 0; i < nBandRows; i++) { vRowMin[i] = nWidth; vRowMax[i] = -1; }
+
+				for (uint32_t e = vBandStart[b]; e < vBandStart[b + 1]; e++)
+				{
+					const uint32_t s = vBandShapes[e];
+					const int32_t sy0 = std::max(by0, int32_t(std::floor(vSpanY[s].first)));
+					const int32_t sy1 = std::min(by1 - 1, int32_t(std::ceil(vSpanY[s].second)));
+					for (int32_t y = sy0; y <= sy1; y++)
+					{
+						uint8_t* cov = vCoverage.data() + size_t(y - by0) * nWidth;
+						if (s < vCaps.size())
+							CapsuleRow(vCaps[s], r, y, rClip.x0, rClip.x1, cov, vRowMin[y - by0], vRowMax[y - by0]);
+						else
+							QuadRow(vQuads[s - vCaps.size()], y, rClip.x0, rClip.x1, cov, vRowMin[y - by0], vRowMax[y - by0]);
+					}
+				}
+
+				for (int32_t y = by0; y < by1; y++)
+				{
+					const int32_t lo = vRowMin[y - by0], hi = vRowMax[y - by0];
+					if (lo > hi) continue;
+					uint8_t* cov = vCoverage.data() + size_t(y - by0) * nWidth + lo;
+					Pixel* dst = target.Row(y) + rClip.x0 + lo;
+					if (pen.mode == alo::Pixel::CUSTOM)
+					{
+						for (int32_t i = 0; i <= hi - lo; i++)
+							if (cov[i]) dst[i] = pen.funcPixelMode(rClip.x0 + lo + i, y, Pixel(p.r, p.g, p.b, uint8_t(cov[i])), dst[i]);
+					}
+					else
+						CoverRow(dst, cov, hi - lo + 1, p, k);
+					std::memset(cov, 0, size_t(hi - lo + 1));
+				}
+			}
+			return rClip;
+		}
+
+		void Stroke::Clear()
+		{
+			vPoints.clear();
+			mapCells.clear();
+			vVisited.clear();
+			nVisit = 0;
+		}
+
+		alo::DirtyRegion::Rect ExtendStroke(const alo::SpriteView& target, alo::Raster::Stroke& stroke, const alo::vf2d& vPoint,
+			float fWidth, alo::Pixel p, const alo::Raster::Pen& pen)
+		{
+			// The first point only starts the stroke
+			stroke.vPoints.push_back(vPoint - alo::vf2d(0.5f, 0.5f));
+			const size_t nPoints = stroke.vPoints.size();
+			if (nPoints < 2 || !(fWidth > 0.0f)) return {};
+			const float r = fWidth * 0.5f, fReach = r + 0.5f;
+
+			const alo::vf2d a = stroke.vPoints[nPoints - 2], b = stroke.vPoints[nPoints - 1];
+			const alo::vf2d vMin = a.min(b) - alo::vf2d(fReach, fReach), vMax = a.max(b) + alo::vf2d(fReach, fReach);
+
+			// Cells of the rectangle the segment reaches into
+			constexpr int32_t nCell = alo::Raster::Stroke::nCellSize;
+			const int32_t cx0 = int32_t(std::floor(vMin.x / nCell)), cy0 = int32_t(std::floor(vMin.y / nCell));
+			const int32_t cx1 = int32_t(std::floor(vMax.x / nCell)), cy1 = int32_t(std::floor(vMax.y / nCell));
+			auto key = [](int32_t x, int32_t y) { return (uint64_t(uint32_t(y)) << 32) | uint32_t(x); };
+
+			// Earlier segments, including ones the stroke crosses again, that share
+			// a cell with the new one. The new segment is filed for later extensions
+			thread_local std::vector<uint32_t> vNear;
+			vNear.clear();
+			if (++stroke.nVisit == 0) { std::fill(stroke.vVisited.begin(), stroke.vVisited.end(), 0); stroke.nVisit = 1; }
+			const uint32_t nSegment = uint32_t(nPoints - 2);
+			for (int32_t cy = cy0; cy <= cy1; cy++)
+				for (int32_t cx = cx0; cx <= cx1; cx++)
+				{
+					std::vector<uint32_t>& vCell = stroke.mapCells[key(cx, cy)];
+					for (uint32_t s : vCell)
+						if (stroke.vVisited[s] != stroke.nVisit) { stroke.vVisited[s] = stroke.nVisit; vNear.push_back(s); }
+					vCell.push_back(nSegment);
+				}
+			stroke.vVisited.push_back(0);
+
+			if (!target.IsValid()) return {};
+			if (pen.mode == alo::Pixel::MASK && p.a != 255) return {};
+			if (pen.mode == alo::Pixel::CUSTOM && !pen.funcPixelMode) return {};
+
+			alo::DirtyRegion::Rect rClip = {
+				std::max(int32_t(std::floor(vMin.x)), 0), std::max(int32_t(std::floor(vMin.y)), 0),
+				std::min(int32_t(std::ceil(vMax.x)) + 1, target.width), std::min(int32_t(std::ceil(vMax.y)) + 1, target.height) };
+			if (rClip.x0 >= rClip.x1 || rClip.y0 >= rClip.y1) return {};
+
+			auto capsule = [](alo::vf2d u, alo::vf2d v)
+			{
+				const alo::vf2d d = v - u;
+				const float fLen2 = d.mag2();
+				return Capsule{ u.x, u.y, d.x, d.y, fLen2 > 0.0f ? 1.0f / fLen2 : 0.0f };
+			};
+			const Capsule cNew = capsule(a, b);
+
+			thread_local std::vector<Capsule> vCaps;
+			thread_local std::vector<uint8_t> vNew, vOld;
+			vCaps.clear();
+			for (uint32_t s : vNear)
+			{
+				const alo::vf2d u = stroke.vPoints[s], v = stroke.vPoints[s + 1];
+				const alo::vf2d lo = u.min(v) - alo::vf2d(fReach, fReach), hi = u.max(v) + alo::vf2d(fReach, fReach);
+				if (hi.x < float(rClip.x0) || hi.y < float(rClip.y0) || lo.x >= float(rClip.x1) || lo.y >= float(rClip.y1)) continue;
+				vCaps.push_back(capsule(u, v));
+			}
+
+			const int32_t nWidth = rClip.x1 - rClip.x0;
+			if (vNew.size() < size_t(nWidth)) { vNew.assign(size_t(nWidth), 0); vOld.assign(size_t(nWidth), 0); }
+
+			const uint32_t k = pen.mode == alo::Pixel::ALPHA ? uint32_t(float(p.a) * pen.fBlendFactor + 0.5f) : 255;
+			for (int32_t y = rClip.y0; y < rClip.y1; y++)
+			{
+				int32_t lo = nWidth, hi = -1, nOldMin = nWidth, nOldMax = -1;
+				CapsuleRow(cNew, r, y, rClip.x0, rClip.x1, vNew.data(), lo, hi);
+				if (lo > hi) continue;
+				for (const auto& c : vCaps)
+					CapsuleRow(c, r, y, rClip.x0, rClip.x1, vOld.data(), nOldMin, nOldMax);
+
+				// What is left to blend, given the earlier alpha, to reach the new alpha
+				for (int32_t i = lo; i <= hi; i++)
+				{
+					const uint32_t nOld = Div255(vOld[i] * k), nNew = Div255(vNew[i] * k);
+					vNew[i] = nNew > nOld ? uint8_t(((nNew - nOld) * 255 + (255 - nOld) / 2) / (255 - nOld)) : 0;
+				}
+
+				uint8_t* cov = vNew.data() + lo;
+				Pixel* dst = target.Row(y) + rClip.x0 + lo;
+				if (pen.mode == alo::Pixel::CUSTOM)
+				{
+					for (int32_t i = 0; i <= hi - lo; i++)
+						if (cov[i]) dst[i] = pen.funcPixelMode(rClip.x0 + lo + i, y, Pixel(p.r, p.g, p.b, uint8_t(cov[i])), dst[i]);
+				}
+				else
+					CoverRow(dst, cov, hi - lo + 1, p, 255);
+				std::memset(cov, 0, size_t(hi - lo + 1));
+				if (nOldMin <= nOldMax) std::memset(vOld.data() + nOldMin, 0, size_t(nOldMax - nOldMin + 1));
+			}
+			return rClip;
+		}
+
+		alo::DirtyRegion::Rect FloodFill(const alo::SpriteView& target, const alo::vi2d& vSeed, alo::Pixel p,
+			uint8_t nTolerance, const alo::Raster::Pen& pen)
+		{
+			if (!target.IsValid()) return {};
+			const int32_t w = target.width, h = target.height;
+			if (vSeed.x < 0 || vSeed.y < 0 || vSeed.x >= w || vSeed.y >= h) return {};
+
+			const Pixel seed = target.Row(vSeed.y)[vSeed.x];
+			auto match = [&](const Pixel q)
+			{
+				return std::abs(int32_t(q.r) - seed.r) <= nTolerance && std::abs(int32_t(q.g) - seed.g) <= nTolerance
+					&& std::abs(int32_t(q.b) - seed.b) <= nTolerance && std::abs(int32_t(q.a) - seed.a) <= nTolerance;
+			};
+
+			// Pixels are blended as soon as they are claimed, and claimed pixels are
+			// never tested again, so the fill colour can never feed back into the match
+			struct Span { int32_t x0, x1, y; };
+			thread_local std::vector<uint64_t> vSeen;
+			thread_local std::vector<Span> vStack;
+			const size_t nWords = size_t(w + 63) / 64;
+			vSeen.assign(nWords * h, 0);
+			vStack.clear();
+
+			alo::DirtyRegion::Rect r = { w, h, 0, 0 };
+			WithPen(pen, [&](auto blend)
+			{
+				// Claims the run of matching pixels through x on row y, and queues
+				// the rows either side of it
+				auto claim = [&](int32_t x, int32_t y) -> int32_t
+				{
+					Pixel* row = target.Row(y);
+					uint64_t* seen = vSeen.data() + nWords * y;
+					auto isFree = [&](int32_t i) { return !(seen[i >> 6] & (uint64_t(1) << (i & 63))) && match(row[i]); };
+					int32_t x0 = x, x1 = x;
+					while (x0 > 0 && isFree(x0 - 1)) x0--;
+					while (x1 < w - 1 && isFree(x1 + 1)) x1++;
+					for (int32_t i = x0; i <= x1; i++)
+					{
+						seen[i >> 6] |= uint64_t(1) << (i & 63);
+						blend(row[i], i, y, p);
+					}
+					r = { std::min(r.x0, x0), std::min(r.y0, y), std::max(r.x1, x1 + 1), std::max(r.y1, y + 1) };
+					if (y > 0) vStack.push_back({ x0, x1, y - 1 });
+					if (y < h - 1) vStack.push_back({ x0, x1, y + 1 });
+					return x1;
+				};
+
+				claim(vSeed.x, vSeed.y);
+				while (!vStack.empty())
+				{
+					const Span s = vStack.back();
+					vStack.pop_back();
+					const Pixel* row = target.Row(s.y);
+					const uint64_t* seen = vSeen.data() + nWords * s.y;
+					for (int32_t x = s.x0; x <= s.x1; x++)
+						if (!(seen[x >> 6] & (uint64_t(1) << (x & 63))) && match(row[x]))
+							x = claim(x, s.y);
+				}
+			});
+			return r.x0 < r.x1 ? r : alo::DirtyRegion::Rect{};
+		}
+
+		alo::DirtyRegion::Rect FillPolygon(const alo::SpriteView& target, const alo::vf2d* pPoints, size_t nPoints, alo::Pixel p,
+			alo::Raster::FillRule rule, const alo::Raster::Pen& pen)
+		{
+			if (!target.IsValid() || nPoints < 3) return {};
+			const int32_t w = target.width, h = target.height;
+
+			// An edge covers the rows whose pixel centres lie in [top, bottom)
+			struct Edge { float x, fStep; int32_t y0, y1, nWind; };
+			thread_local std::vector<Edge> vEdges, vActive;
+			thread_local std::vector<uint32_t> vRowStart;
+			thread_local std::vector<int32_t> vWind;
+			vEdges.clear(); vActive.clear();
+			for (size_t i = 0; i < nPoints; i++)
+			{
+				alo::vf2d a = pPoints[i], b = pPoints[(i + 1) % nPoints];
+				if (a.y == b.y || !std::isfinite(a.x + a.y + b.x + b.y)) continue;
+				const int32_t nWind = b.y > a.y ? 1 : -1;
+				if (nWind < 0) std::swap(a, b);
+				const int32_t y0 = std::max(int32_t(std::ceil(a.y - 0.5f)), 0);
+				const int32_t y1 = std::min(int32_t(std::ceil(b.y - 0.5f)), h);
+				if (y0 >= y1) continue;
+				const float fStep = (b.x - a.x) / (b.y - a.y);
+				vEdges.push_back({ a.x + (float(y0) + 0.5f - a.y) * fStep, fStep, y0, y1, nWind });
+			}
+			if (vEdges.empty()) return {};
+
+			// Windings along a row are summed in vWind, which is left zeroed
+			if (vWind.size() < size_t(w) + 1) vWind.assign(size_t(w) + 1, 0);
+
+			// Edge table, bucketed by first row
+			vRowStart.assign(size_t(h) + 1, 0);
+			for (const auto& e : vEdges) vRowStart[e.y0 + 1]++;
+			for (int32_t y = 0; y < h; y++) vRowStart[y + 1] += vRowStart[y];
+			std::sort(vEdges.begin(), vEdges.end(), [](const Edge& a, const Edge& b) { return a.y0 < b.y0; });
+
+			alo::DirtyRegion::Rect r = { w, h, 0, 0 };
+			WithPen(pen, [&](auto blend)
+			{
+				for (int32_t y = vEdges.front().y0; y < h; y++)
+				{
+					vActive.erase(std::remove_if(vActive.begin(), vActive.end(), [y](const Edge& e) { return e.y1 <= y; }), vActive.end());
+					for (uint32_t i = vRowStart[y]; i < vRowStart[y + 1]; i++)
+						vActive.push_back(vEdges[i]);
+					if (vActive.empty())
+					{
+						if (vRowStart[y + 1] == vEdges.size()) break;
+						continue;
+					}
+
+					// Each edge adds its winding at the first pixel whose centre lies right
+					// of it, so a running sum along the row gives every pixel's winding
+					// without sorting the crossings
+					int32_t xMin = w, xMax = 0;
+					for (const auto& e : vActive)
+					{
+						const int32_t x = int32_t(std::min(std::max(std::ceil(e.x - 0.5f), 0.0f), float(w)));
+						vWind[x] += e.nWind;
+						xMin = std::min(xMin, x); xMax = std::max(xMax, x);
+					}
+
+					Pixel* row = target.Row(y);
+					int32_t nWind = 0, xStart = -1;
+					for (int32_t x = xMin; x <= xMax; x++)
+					{
+						nWind += vWind[x];
+						vWind[x] = 0;
+						const bool bInside = rule == alo::Raster::FillRule::NONZERO ? nWind != 0 : (nWind & 1) != 0;
+						if (bInside && xStart < 0) xStart = x;
+						else if (!bInside && xStart >= 0)
+						{
+							for (int32_t i = xStart; i < x; i++) blend(row[i], i, y, p);
+							r = { std::min(r.x0, xStart), std::min(r.y0, y), std::max(r.x1, x), std::max(r.y1, y + 1) };
+							xStart = -1;
+						}
+					}
+
+					for (auto& e : vActive) e.x += e.fStep;
+				}
+			});
+			return r.x0 < r.x1 ? r : alo::DirtyRegion::Rect{};
+		}
+
+		// Two lobed Lanczos weights for the taps around a block of n source pixels,
+		// the first tap at offset o0 from the block's start. Weights sum to one
+		void LanczosTaps(int32_t n, int32_t& o0, std::vector<float>& vWeights)
+		{
+			const float fCentre = float(n - 1) * 0.5f, fInvN = 1.0f / float(n);
+			o0 = int32_t(std::floor(fCentre - 2.0f * float(n))) + 1;
+			vWeights.resize(size_t(4 * n));
+			float fSum = 0.0f;
+			for (int32_t t = 0; t < 4 * n; t++)
+			{
+				const float x = (float(o0 + t) - fCentre) * fInvN;
+				float w = 0.0f;
+				if (x == 0.0f) w = 1.0f;
+				else if (std::abs(x) < 2.0f)
+				{
+					const float px = 3.14159265f * x;
+					w = 2.0f * std::sin(px) * std::sin(px * 0.5f) / (px * px);
+				}
+				vWeights[t] = w;
+				fSum += w;
+			}
+			for (auto& w : vWeights) w /= fSum;
+		}
+
+		void Downsample(const alo::SpriteView& src, const alo::SpriteView& dst, int32_t n,
+			alo::Raster::Downsampler filter, const alo::DirtyRegion::Rect& r)
+		{
+			if (!src.IsValid() || !dst.IsValid() || n < 1) return;
+			const int32_t x0 = std::max(r.x0, 0), x1 = std::min({ r.x1, dst.width, src.width / n });
+			const int32_t y0 = std::max(r.y0, 0), y1 = std::min({ r.y1, dst.height, src.height / n });
+			if (x0 >= x1 || y0 >= y1) return;
+
+			if (n == 1)
+			{
+				for (int32_t y = y0; y < y1; y++)
+					std::memcpy(dst.Row(y) + x0, src.Row(y) + x0, size_t(x1 - x0) * sizeof(Pixel));
+				return;
+			}
+
+			if (filter == alo::Raster::Downsampler::BOX)
+			{
+				// Columns of each block are summed down into 16 bit channels, which
+				// hold up to 257 pixels, then across. Division is by a 32 bit
+				// reciprocal, exact for these sums
+				const int32_t nCols = (x1 - x0) * n;
+				const uint32_t nArea = uint32_t(n * n);
+				const uint64_t nRecip = ((uint64_t(1) << 32) + nArea - 1) / nArea;
+				thread_local std::vector<uint16_t> vSum;
+				vSum.resize(size_t(nCols) * 4);
+				for (int32_t y = y0; y < y1; y++)
+				{
+					std::fill(vSum.begin(), vSum.end(), uint16_t(0));
+					for (int32_t j = 0; j < n; j++)
+					{
+						const uint8_t* s = reinterpret_cast<const uint8_t*>(src.Row(y * n + j) + x0 * n);
+						uint16_t* acc = vSum.data();
+						int32_t i = 0;
+#if defined(ALO_SIMD_SSE2)
+						const __m128i vZero = _mm_setzero_si128();
+						for (; i + 4 <= nCols; i += 4)
+						{
+							__m128i p = _mm_loadu_si128((const __m128i*)(s + i * 4));
+							__m128i* a = (__m128i*)(acc + i * 4);
+							_mm_storeu_si128(a, _mm_add_epi16(_mm_loadu_si128(a), _mm_unpacklo_epi8(p, vZero)));
+							_mm_storeu_si128(a + 1, _mm_add_epi16(_mm_loadu_si128(a + 1), _mm_unpackhi_epi8(p, vZero)));
+						}
+#endif
+						for (i *= 4; i < nCols * 4; i++)
+							acc[i] = uint16_t(acc[i] + s[i]);
+					}
+
+					uint8_t* out = reinterpret_cast<uint8_t*>(dst.Row(y) + x0);
+					const uint16_t* acc = vSum.data();
+					for (int32_t x = 0; x < x1 - x0; x++, acc += n * 4)
+					{
+						uint32_t nTotal[4] = { nArea / 2, nArea / 2, nArea / 2, nArea / 2 };
+						for (int32_t i = 0; i < n * 4; i += 4)
+							for (int32_t c = 0; c < 4; c++) nTotal[c] += acc[i + c];
+						for (int32_t c = 0; c < 4; c++)
+							out[x * 4 + c] = uint8_t((nTotal[c] * nRecip) >> 32);
+					}
+				}
+				return;
+			}
+
+			// Lanczos is separable, and every block sees the same taps. Each output
+			// row is filtered down the source columns it reads, then across them
+			thread_local std::vector<float> vWeights, vCols;
+			int32_t o0 = 0;
+			LanczosTaps(n, o0, vWeights);
+			const int32_t nTaps = 4 * n;
+			const int32_t cx0 = std::max(x0 * n + o0, 0), cx1 = std::min((x1 - 1) * n + o0 + nTaps, src.width);
+			vCols.resize(size_t(cx1 - cx0) * 4);
+			const int32_t mx = src.width - 1, my = src.height - 1;
+
+			for (int32_t y = y0; y < y1; y++)
+			{
+				std::fill(vCols.begin(), vCols.end(), 0.0f);
+				for (int32_t t = 0; t < nTaps; t++)
+				{
+					const float w = vWeights[t];
+					const uint8_t* s = reinterpret_cast<const uint8_t*>(src.Row(std::clamp(y * n + o0 + t, 0, my)) + cx0);
+					float* acc = vCols.data();
+					int32_t i = 0;
+#if defined(ALO_SIMD_SSE2)
+					const __m128i vZero = _mm_setzero_si128();
+					const __m128 vW = _mm_set1_ps(w);
+					for (; i + 4 <= cx1 - cx0; i += 4)
+					{
+						__m128i p = _mm_loadu_si128((const __m128i*)(s + i * 4));
+						__m128i lo = _mm_unpacklo_epi8(p, vZero), hi = _mm_unpackhi_epi8(p, vZero);
+						__m128 f[4] = { _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, vZero)), _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, vZero)),
+							_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, vZero)), _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, vZero)) };
+						for (int k = 0; k < 4; k++)
+							_mm_storeu_ps(acc + (i + k) * 4, _mm_add_ps(_mm_loadu_ps(acc + (i + k) * 4), _mm_mul_ps(f[k], vW)));
+					}
+#endif
+					for (i *= 4; i < (cx1 - cx0) * 4; i++)
+						acc[i] += float(s[i]) * w;
+				}
 
-		if (_gfs::exists(file))
-		{
-			sResourceFile e;
-			e.nSize = (uint32_t)_gfs::file_size(file);
-			e.nOffset = 0; // Unknown at this stage			
-			mapFiles[file] = e;
-			return true;
+				uint8_t* out = reinterpret_cast<uint8_t*>(dst.Row(y) + x0);
+				for (int32_t x = x0; x < x1; x++)
+				{
+#if defined(ALO_SIMD_SSE2)
+					// All four channels of a pixel at once, rounded and saturated by the packs
+					__m128 vc = _mm_setzero_ps();
+					for (int32_t t = 0; t < nTaps; t++)
+						vc = _mm_add_ps(vc, _mm_mul_ps(_mm_loadu_ps(vCols.data() + size_t(std::clamp(x * n + o0 + t, 0, mx) - cx0) * 4), _mm_set1_ps(vWeights[t])));
+					__m128i vi = _mm_cvtps_epi32(vc);
+					vi = _mm_packus_epi16(_mm_packs_epi32(vi, vi), vi);
+					const int32_t nOut = _mm_cvtsi128_si32(vi);
+					std::memcpy(out + (x - x0) * 4, &nOut, sizeof(nOut));
+#else
+					float c[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+					for (int32_t t = 0; t < nTaps; t++)
+					{
+						const float* col = vCols.data() + size_t(std::clamp(x * n + o0 + t, 0, mx) - cx0) * 4;
+						for (int k = 0; k < 4; k++) c[k] += col[k] * vWeights[t];
+					}
+					for (int k = 0; k < 4; k++)
+						out[(x - x0) * 4 + k] = uint8_t(std::min(std::max(std::nearbyint(c[k]), 0.0f), 255.0f));
+#endif
+				}
+			}
 		}
-		return false;
-	}
 
-	bool ResourcePack::LoadPack(const std::string& sFile, const std::string& sKey)
-	{
-		// Open the resource file
-		baseFile.open(sFile, std::ifstream::binary);
-		if (!baseFile.is_open()) return false;
+		// Rounded division of a 16 bit channel sum by d = 2r + 1, as a multiply by a
+		// reciprocal of 15 or 16 significant bits and a shift. Exact for d up to 129
+		struct BoxDivisor
+		{
+			uint16_t nHalf = 0, nMul = 0;
+			int32_t nShift = 0;
 
-		// 1) Read Scrambled index
-		uint32_t nIndexSize = 0;
-		baseFile.read((char*)&nIndexSize, sizeof(uint32_t));
+			explicit BoxDivisor(int32_t r)
+			{
+				const uint32_t d = uint32_t(2 * r + 1);
+				while ((2u << nShift) <= d) nShift++;
+				nHalf = uint16_t(d / 2);
+				nMul = uint16_t(((uint32_t(1) << (16 + nShift)) + d - 1) / d);
+			}
 
-		std::vector<char> buffer(nIndexSize);
-		for (uint32_t j = 0; j < nIndexSize; j++)
-			buffer[j] = baseFile.get();
+			uint8_t operator()(uint32_t nSum) const
+			{ return uint8_t(((nSum + nHalf) * nMul) >> (16 + nShift)); }
 
-		std::vector<char> decoded = scramble(buffer, sKey);
-		size_t pos = 0;
-		auto read = [&decoded, &pos](char* dst, size_t size) {
-			memcpy((void*)dst, (const void*)(decoded.data() + pos), size);
-			pos += size;
+#if defined(ALO_SIMD_SSE2)
+			__m128i operator()(__m128i vSum) const
+			{
+				return _mm_srl_epi16(_mm_mulhi_epu16(_mm_add_epi16(vSum, _mm_set1_epi16(int16_t(nHalf))),
+					_mm_set1_epi16(int16_t(nMul))), _mm_cvtsi32_si128(nShift));
+			}
+#endif
 		};
 
-		auto get = [&read]() -> int { char c; read(&c, 1); return c; };
-
-		// 2) Read Map
-		uint32_t nMapEntries = 0;
-		read((char*)&nMapEntries, sizeof(uint32_t));
-		for (uint32_t i = 0; i < nMapEntries; i++)
+		// Rows are blurred across in pairs, interleaved pixel by pixel so one register
+		// holds pixel x of both, with nPad copies of the end pixels either side so
+		// no pass has to clamp
+		void PadPair(Pixel* pair, int32_t w, int32_t nPad)
 		{
-			uint32_t nFilePathSize = 0;
-			read((char*)&nFilePathSize, sizeof(uint32_t));
-
-			std::string sFileName(nFilePathSize, ' ');
-			for (uint32_t j = 0; j < nFilePathSize; j++)
-				sFileName[j] = get();
+			for (int32_t i = 1; i <= nPad; i++)
+			{
+				pair[-2 * i] = pair[0];
+				pair[1 - 2 * i] = pair[1];
+				pair[2 * (w - 1 + i)] = pair[2 * (w - 1)];
+				pair[2 * (w - 1 + i) + 1] = pair[2 * (w - 1) + 1];
+			}
+		}
 
-			sResourceFile e;
-			read((char*)&e.nSize, sizeof(uint32_t));
-			read((char*)&e.nOffset, sizeof(uint32_t));
-			mapFiles[sFileName] = e;
+		void InterleavePair(const Pixel* a, const Pixel* b, Pixel* pair, int32_t w, int32_t nPad)
+		{
+			int32_t x = 0;
+#if defined(ALO_SIMD_SSE2)
+			for (; x + 4 <= w; x += 4)
+			{
+				const __m128i va = _mm_loadu_si128((const __m128i*)(a + x)), vb = _mm_loadu_si128((const __m128i*)(b + x));
+				_mm_storeu_si128((__m128i*)(pair + 2 * x), _mm_unpacklo_epi32(va, vb));
+				_mm_storeu_si128((__m128i*)(pair + 2 * x + 4), _mm_unpackhi_epi32(va, vb));
+			}
+#endif
+			for (; x < w; x++)
+			{
+				pair[2 * x] = a[x];
+				pair[2 * x + 1] = b[x];
+			}
+			PadPair(pair, w, nPad);
 		}
 
-		// Don't close base file! we will provide a stream
-		// pointer when the file is requested
-		return true;
-	}
+		void DeinterleavePair(const Pixel* pair, Pixel* a, Pixel* b, int32_t w)
+		{
+			int32_t x = 0;
+#if defined(ALO_SIMD_SSE2)
+			for (; x + 4 <= w; x += 4)
+			{
+				const __m128i p0 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)(pair + 2 * x)), _MM_SHUFFLE(3, 1, 2, 0));
+				const __m128i p1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)(pair + 2 * x + 4)), _MM_SHUFFLE(3, 1, 2, 0));
+				_mm_storeu_si128((__m128i*)(a + x), _mm_unpacklo_epi64(p0, p1));
+				_mm_storeu_si128((__m128i*)(b + x), _mm_unpackhi_epi64(p0, p1));
+			}
+#endif
+			for (; x < w; x++)
+			{
+				a[x] = pair[2 * x];
+				b[x] = pair[2 * x + 1];
+			}
+		}
 
-	bool ResourcePack::SavePack(const std::string& sFile, const std::string& sKey)
-	{
-		// Create/Overwrite the resource file
-		std::ofstream ofs(sFile, std::ofstream::binary);
-		if (!ofs.is_open()) return false;
+		// One box pass of reach r, less than nPad, across an interleaved pair
+		void BoxPair(const Pixel* in, Pixel* out, int32_t w, int32_t r, int32_t nPad)
+		{
+			const BoxDivisor div(r);
+#if defined(ALO_SIMD_SSE2)
+			const __m128i vZero = _mm_setzero_si128();
+			auto load = [&](int32_t x) { return _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(in + 2 * x)), vZero); };
+			__m128i vSum = vZero;
+			for (int32_t i = -r; i <= r; i++) vSum = _mm_add_epi16(vSum, load(i));
+			for (int32_t x = 0; x < w; x++)
+			{
+				_mm_storel_epi64((__m128i*)(out + 2 * x), _mm_packus_epi16(div(vSum), vZero));
+				vSum = _mm_sub_epi16(_mm_add_epi16(vSum, load(x + r + 1)), load(x - r));
+			}
+#else
+			const uint8_t* p = reinterpret_cast<const uint8_t*>(in);
+			uint8_t* o = reinterpret_cast<uint8_t*>(out);
+			uint32_t nSum[8] = {};
+			for (int32_t i = -r; i <= r; i++)
+				for (int c = 0; c < 8; c++) nSum[c] += p[i * 8 + c];
+			for (int32_t x = 0; x < w; x++)
+				for (int c = 0; c < 8; c++)
+				{
+					o[x * 8 + c] = div(nSum[c]);
+					nSum[c] += p[(x + r + 1) * 8 + c] - p[(x - r) * 8 + c];
+				}
+#endif
+			PadPair(out, w, nPad);
+		}
 
-		// Iterate through map
-		uint32_t nIndexSize = 0; // Unknown for now
-		ofs.write((char*)&nIndexSize, sizeof(uint32_t));
-		uint32_t nMapSize = uint32_t(mapFiles.size());
-		ofs.write((char*)&nMapSize, sizeof(uint32_t));
-		for (auto& e : mapFiles)
+		// One box pass of reach r down nCols columns of h rows, clamped at top and
+		// bottom. Works a row at a time, keeping a running sum per column
+		void BoxColumns(const Pixel* in, Pixel* out, size_t nStride, int32_t nCols, int32_t h, int32_t r)
 		{
-			// Write the path of the file
-			size_t nPathSize = e.first.size();
-			ofs.write((char*)&nPathSize, sizeof(uint32_t));
-			ofs.write(e.first.c_str(), nPathSize);
+			const BoxDivisor div(r);
+			const int32_t nChannels = nCols * 4;
+			auto row = [&](int32_t y) { return reinterpret_cast<const uint8_t*>(in + size_t(std::clamp(y, 0, h - 1)) * nStride); };
+
+			thread_local std::vector<uint16_t> vSum;
+			vSum.assign(size_t(nChannels), 0);
+			uint16_t* sum = vSum.data();
+			for (int32_t y = -r; y <= r; y++)
+			{
+				const uint8_t* s = row(y);
+				for (int32_t i = 0; i < nChannels; i++) sum[i] = uint16_t(sum[i] + s[i]);
+			}
 
-			// Write the file entry properties
-			ofs.write((char*)&e.second.nSize, sizeof(uint32_t));
-			ofs.write((char*)&e.second.nOffset, sizeof(uint32_t));
+			for (int32_t y = 0; y < h; y++)
+			{
+				uint8_t* o = reinterpret_cast<uint8_t*>(out + size_t(y) * nStride);
+				const uint8_t* pIn = row(y + r + 1);
+				const uint8_t* pOut = row(y - r);
+				int32_t i = 0;
+#if defined(ALO_SIMD_SSE2)
+				const __m128i vZero = _mm_setzero_si128();
+				for (; i + 16 <= nChannels; i += 16)
+				{
+					__m128i* s = (__m128i*)(sum + i);
+					__m128i lo = _mm_loadu_si128(s), hi = _mm_loadu_si128(s + 1);
+					_mm_storeu_si128((__m128i*)(o + i), _mm_packus_epi16(div(lo), div(hi)));
+					const __m128i a = _mm_loadu_si128((const __m128i*)(pIn + i)), b = _mm_loadu_si128((const __m128i*)(pOut + i));
+					lo = _mm_sub_epi16(_mm_add_epi16(lo, _mm_unpacklo_epi8(a, vZero)), _mm_unpacklo_epi8(b, vZero));
+					hi = _mm_sub_epi16(_mm_add_epi16(hi, _mm_unpackhi_epi8(a, vZero)), _mm_unpackhi_epi8(b, vZero));
+					_mm_storeu_si128(s, lo);
+					_mm_storeu_si128(s + 1, hi);
+				}
+#endif
+				for (; i < nChannels; i++)
+				{
+					o[i] = div(sum[i]);
+					sum[i] = uint16_t(sum[i] + pIn[i] - pOut[i]);
+				}
+			}
 		}
 
-		// 2) Write the individual Data
-		std::streampos offset = ofs.tellp();
-		nIndexSize = (uint32_t)offset;
-		for (auto& e : mapFiles)
+		// dst = src + blur * s / 256 per channel, saturating
+		void AddScaled(const Pixel* src, const Pixel* blur, Pixel* dst, int32_t n, uint16_t s)
 		{
-			// Store beginning of file offset within resource pack file
-			e.second.nOffset = (uint32_t)offset;
-
-			// Load the file to be added
-			std::vector<uint8_t> vBuffer(e.second.nSize);
-			std::ifstream i(e.first, std::ifstream::binary);
-			i.read((char*)vBuffer.data(), e.second.nSize);
-			i.close();
+			const uint8_t* a = reinterpret_cast<const uint8_t*>(src);
+			const uint8_t* b = reinterpret_cast<const uint8_t*>(blur);
+			uint8_t* o = reinterpret_cast<uint8_t*>(dst);
+			int32_t i = 0;
+#if defined(ALO_SIMD_SSE2)
+			// Unpacking under zero puts each channel in the high byte, so the high
+			// half of the multiply is the channel times s / 256
+			const __m128i vZero = _mm_setzero_si128(), vS = _mm_set1_epi16(int16_t(s));
+			for (; i + 16 <= n * 4; i += 16)
+			{
+				const __m128i p = _mm_loadu_si128((const __m128i*)(b + i));
+				const __m128i g = _mm_packus_epi16(_mm_mulhi_epu16(_mm_unpacklo_epi8(vZero, p), vS), _mm_mulhi_epu16(_mm_unpackhi_epi8(vZero, p), vS));
+				_mm_storeu_si128((__m128i*)(o + i), _mm_adds_epu8(_mm_loadu_si128((const __m128i*)(a + i)), g));
+			}
+#endif
+			for (; i < n * 4; i++)
+				o[i] = uint8_t(std::min(uint32_t(a[i]) + ((uint32_t(b[i]) * s) >> 8), 255u));
+		}
 
-			// Write the loaded file into resource pack file
-			ofs.write((char*)vBuffer.data(), e.second.nSize);
-			offset += e.second.nSize;
+		// Reaches of the box passes making up a kernel, passes of no reach left out
+		int32_t BlurPasses(int32_t nRadius, alo::Raster::BlurKernel kernel, int32_t vRadii[3])
+		{
+			int32_t nPasses = 0;
+			if (kernel == alo::Raster::BlurKernel::BOX)
+			{
+				if (nRadius > 0) vRadii[nPasses++] = std::min(nRadius, 64);
+			}
+			else
+			{
+				nRadius = std::clamp(nRadius, 0, 192);
+				for (int32_t i = 0; i < 3; i++)
+					if ((nRadius + i) / 3 > 0) vRadii[nPasses++] = (nRadius + i) / 3;
+			}
+			return nPasses;
 		}
 
-		// 3) Scramble Index
-		std::vector<char> stream;
-		auto write = [&stream](const char* data, size_t size) {
-			size_t sizeNow = stream.size();
-			stream.resize(sizeNow + size);
-			memcpy(stream.data() + sizeNow, data, size);
-		};
+		int32_t BlurReach(int32_t nRadius, alo::Raster::BlurKernel kernel)
+		{
+			int32_t vRadii[3], nReach = 0;
+			const int32_t nPasses = BlurPasses(nRadius, kernel, vRadii);
+			for (int32_t i = 0; i < nPasses; i++) nReach += vRadii[i];
+			return nReach;
+		}
 
-		// Iterate through map
-		write((char*)&nMapSize, sizeof(uint32_t));
-		for (auto& e : mapFiles)
+		// Shared by Blur and Glow, nStrength < 0 replacing rather than adding
+		void BlurInto(const alo::SpriteView& src, const alo::SpriteView& dst, int32_t nRadius,
+			alo::Raster::BlurKernel kernel, int32_t nStrength, const alo::DirtyRegion::Rect& r)
 		{
-			// Write the path of the file
-			size_t nPathSize = e.first.size();
-			write((char*)&nPathSize, sizeof(uint32_t));
-			write(e.first.c_str(), nPathSize);
+			if (!src.IsValid() || !dst.IsValid() || src.width != dst.width || src.height != dst.height) return;
+			const int32_t x0 = std::max(r.x0, 0), x1 = std::min(r.x1, src.width);
+			const int32_t y0 = std::max(r.y0, 0), y1 = std::min(r.y1, src.height);
+			if (x0 >= x1 || y0 >= y1) return;
 
-			// Write the file entry properties
-			write((char*)&e.second.nSize, sizeof(uint32_t));
-			write((char*)&e.second.nOffset, sizeof(uint32_t));
-		}
-		std::vector<char> sIndexString = scramble(stream, sKey);
-		uint32_t nIndexStringLen = uint32_t(sIndexString.size());
-		// 4) Rewrite Map (it has been updated with offsets now)
-		// at start of file
-		ofs.seekp(0, std::ios::beg);
-		ofs.write((char*)&nIndexStringLen, sizeof(uint32_t));
-		ofs.write(sIndexString.data(), nIndexStringLen);
-		ofs.close();
-		return true;
-	}
+			auto finish = [&](int32_t y, const Pixel* blur, int32_t x, int32_t n)
+			{
+				if (nStrength < 0)
+				{
+					if (blur != dst.Row(y) + x) std::memcpy(dst.Row(y) + x, blur, size_t(n) * sizeof(Pixel));
+				}
+				else
+					AddScaled(src.Row(y) + x, blur, dst.Row(y) + x, n, uint16_t(nStrength));
+			};
 
-	ResourceBuffer ResourcePack::GetFileBuffer(const std::string& sFile)
-	{ return ResourceBuffer(baseFile, mapFiles[sFile].nOffset, mapFiles[sFile].nSize); }
+			int32_t vRadii[3];
+			const int32_t nPasses = BlurPasses(nRadius, kernel, vRadii);
+			if (nPasses == 0)
+			{
+				for (int32_t y = y0; y < y1; y++) finish(y, src.Row(y) + x0, x0, x1 - x0);
+				return;
+			}
 
-	bool ResourcePack::Loaded()
-	{ return baseFile.is_open(); }
+			// Passes run over the rectangle grown by the reach, each clamping at its
+			// edges. Clamping error travels no further in than the reach, so outside
+			// the edges of src it never gets back into r
+			int32_t nReach = 0;
+			for (int32_t i = 0; i < nPasses; i++) nReach += vRadii[i];
+			const int32_t wx0 = std::max(x0 - nReach, 0), wx1 = std::min(x1 + nReach, src.width);
+			const int32_t wy0 = std::max(y0 - nReach, 0), wy1 = std::min(y1 + nReach, src.height);
+			const int32_t ww = wx1 - wx0, wh = wy1 - wy0;
+			thread_local alo::PixelBuffer vA, vB;
+			vA.resize(size_t(ww) * size_t(wh));
+			vB.resize(size_t(ww) * size_t(wh));
+			Pixel* pA = vA.data();
+			Pixel* pB = vB.data();
+
+			// Across: each pair of rows goes through every pass in scratch, landing in A
+			int32_t nPad = 0;
+			for (int32_t i = 0; i < nPasses; i++) nPad = std::max(nPad, vRadii[i] + 1);
+			alo::ParallelRows(0, wh, 8, [&](int32_t ya, int32_t yb)
+			{
+				const size_t nPair = size_t(ww + 2 * nPad) * 2;
+				thread_local alo::PixelBuffer vRows;
+				vRows.resize(nPair * 2 + size_t(ww));
+				Pixel* vPair[2] = { vRows.data() + nPad * 2, vRows.data() + nPair + nPad * 2 };
+				for (int32_t y = ya; y < yb; y += 2)
+				{
+					const bool bPair = y + 1 < yb;
+					const Pixel* a = src.Row(wy0 + y) + wx0;
+					InterleavePair(a, bPair ? a + src.stride : a, vPair[0], ww, nPad);
+					for (int32_t k = 0; k < nPasses; k++)
+						BoxPair(vPair[k & 1], vPair[(k + 1) & 1], ww, vRadii[k], nPad);
+					Pixel* oa = pA + size_t(y) * ww;
+					DeinterleavePair(vPair[nPasses & 1], oa, bPair ? oa + ww : vRows.data() + nPair * 2, ww);
+				}
+			});
 
-	std::vector<char> ResourcePack::scramble(const std::vector<char>& data, const std::string& key)
-	{
-		if (key.empty()) return data;
-		std::vector<char> o;
-		size_t c = 0;
-		for (auto s : data)	o.push_back(s ^ key[(c++) % key.size()]);
-		return o;
-	};
+			// Down: strips of columns go through every pass between A and B, then
+			// the rows of r are written out
+			alo::ParallelRows(x0 - wx0, x1 - wx0, 16, [&](int32_t c0, int32_t c1)
+			{
+				Pixel* pIn = pA + c0;
+				Pixel* pOut = pB + c0;
+				for (int32_t k = 0; k < nPasses; k++)
+				{
+					BoxColumns(pIn, pOut, size_t(ww), c1 - c0, wh, vRadii[k]);
+					std::swap(pIn, pOut);
+				}
+				for (int32_t y = y0; y < y1; y++)
+					finish(y, pIn + size_t(y - wy0) * ww, wx0 + c0, c1 - c0);
+			});
+		}
 
-	std::string ResourcePack::makeposix(const std::string& path)
-	{
-		std::string o;
-		for (auto s : path) o += std::string(1, s == '\\' ? '/' : s);
-		return o;
-	};
+		void Blur(const alo::SpriteView& src, const alo::SpriteView& dst, int32_t nRadius,
+			alo::Raster::BlurKernel kernel, const alo::DirtyRegion::Rect& r)
+		{ BlurInto(src, dst, nRadius, kernel, -1, r); }
+
+		void Glow(const alo::SpriteView& src, const alo::SpriteView& dst, int32_t nRadius,
+			alo::Raster::BlurKernel kernel, float fStrength, const alo::DirtyRegion::Rect& r)
+		{ BlurInto(src, dst, nRadius, kernel, int32_t(std::clamp(fStrength * 256.0f + 0.5f, 0.0f, 65535.0f)), r); }
+	}
 
 	// O------------------------------------------------------------------------------O
 	// | alo::GameEngine IMPLEMENTATION                                               |
@@ -1432,7 +4543,12 @@ namespace alo
 	}
 
 	GameEngine::~GameEngine()
-	{}
+	{
+		// Targets outliving the engine must not call back into it
+		for (auto& desc : vDecalTargets)
+			if (desc.target != nullptr) desc.target->pTargetOwner = nullptr;
+		if (Renderer::ptrGE == this) Renderer::ptrGE = nullptr;
+	}
 
 
 	alo::rcode GameEngine::Construct(int32_t screen_w, int32_t screen_h, int32_t pixel_w, int32_t pixel_h, bool full_screen, bool vsync, bool cohesion)
@@ -1440,6 +4556,7 @@ namespace alo
 		bPixelCohesion = cohesion;
 		vScreenSize = { screen_w, screen_h };
 		vInvScreenSize = { 1.0f / float(screen_w), 1.0f / float(screen_h) };
+		vInvDecalSize = vInvScreenSize;
 		vPixelSize = { pixel_w, pixel_h };
 		vWindowSize = vScreenSize * vPixelSize;
 		bFullScreen = full_screen;
@@ -1460,7 +4577,24 @@ namespace alo
 		{
 			layer.pDrawTarget.Create(vScreenSize.x, vScreenSize.y);
 			layer.bUpdate = true;
+			if (layer.pCanvas)
+			{
+				// The canvas starts again at the new size, under the same entry
+				std::unique_ptr<alo::Decal> pCanvas = std::make_unique<alo::Decal>(vScreenSize);
+				for (auto& desc : vDecalTargets)
+					if (desc.target == layer.pCanvas.get())
+					{
+						desc.target->pTargetOwner = nullptr;
+						desc.target = pCanvas.get();
+						desc.target->pTargetOwner = this;
+					}
+				layer.pCanvas = std::move(pCanvas);
+			}
 		}
+		// A canvas being drawn into keeps on, at its new size
+		SetDecalTarget(nDecalTarget < 0 ? nullptr : vDecalTargets[nDecalTarget].target);
+		if (pSupersample)
+			pSupersample = std::make_unique<alo::Sprite>(vScreenSize.x * nSupersample, vScreenSize.y * nSupersample);
 		SetDrawTarget(nullptr);
 		renderer->ClearBuffer(alo::BLACK, true);
 		renderer->DisplayFrame();
@@ -1495,6 +4629,10 @@ namespace alo
 
 	void GameEngine::SetDrawTarget(Sprite* target)
 	{
+		// Layer 0 is drawn through its supersampled canvas, when it has one
+		if (pSupersample && !vLayers.empty() && target == vLayers[0].pDrawTarget.Sprite())
+			target = nullptr;
+
 		if (target)
 		{
 			pDrawTarget = target;
@@ -1502,16 +4640,42 @@ namespace alo
 		else
 		{
 			nTargetLayer = 0;
-			pDrawTarget = vLayers[0].pDrawTarget.Sprite();
+			pDrawTarget = pSupersample ? pSupersample.get() : vLayers[0].pDrawTarget.Sprite();
+		}
+		if (pDrawTarget) pDrawTarget->SetLayout(alo::Sprite::Layout::LINEAR);
+		vDrawTarget = pDrawTarget ? pDrawTarget->View() : alo::SpriteView();
+
+		// Writes are tracked if the sprite belongs to a layer
+		nDirtyLayer = -1;
+		nDrawScale = 1;
+		for (size_t i = 0; i < vLayers.size(); i++)
+			if (vLayers[i].pDrawTarget.Sprite() == pDrawTarget)
+				nDirtyLayer = int32_t(i);
+		if (pSupersample && pDrawTarget == pSupersample.get())
+		{
+			nDirtyLayer = 0;
+			nDrawScale = nSupersample;
 		}
 	}
 
+	void GameEngine::SetDrawTarget(const alo::SpriteView& target)
+	{
+		pDrawTarget = nullptr;
+		vDrawTarget = target;
+		nDirtyLayer = -1;
+		nDrawScale = 1;
+	}
+
 	void GameEngine::SetDrawTarget(uint8_t layer, bool bDirty)
 	{
 		if (layer < vLayers.size())
 		{
-			pDrawTarget = vLayers[layer].pDrawTarget.Sprite();
-			vLayers[layer].bUpdate = bDirty;
+			const bool bCanvas = layer == 0 && pSupersample;
+			pDrawTarget = bCanvas ? pSupersample.get() : vLayers[layer].pDrawTarget.Sprite();
+			pDrawTarget->SetLayout(alo::Sprite::Layout::LINEAR);
+			vDrawTarget = pDrawTarget->View();
+			nDirtyLayer = bDirty ? int32_t(layer) : -1;
+			nDrawScale = bCanvas ? nSupersample : 1;
 			nTargetLayer = layer;
 		}
 	}
@@ -1540,36 +4704,174 @@ namespace alo
 	std::vector<LayerDesc>& GameEngine::GetLayers()
 	{ return vLayers; }
 
-	uint32_t GameEngine::CreateLayer()
-	{
-		LayerDesc ld;
-		ld.pDrawTarget.Create(vScreenSize.x, vScreenSize.y);
-		vLayers.push_back(std::move(ld));
-		return uint32_t(vLayers.size()) - 1;
+	void GameEngine::SetLayerGlow(uint8_t layer, int32_t nRadius, float fStrength, alo::Raster::BlurKernel kernel)
+	{
+		if (layer >= vLayers.size()) return;
+		LayerDesc& ld = vLayers[layer];
+		ld.nGlowRadius = std::max(nRadius, 0);
+		ld.fGlowStrength = fStrength;
+		ld.glowKernel = kernel;
+		if (ld.nGlowRadius == 0) ld.pGlow.reset();
+		ld.bUpdate = true;
+	}
+
+	void GameEngine::SetLayerCanvas(uint8_t layer, bool bCanvas)
+	{
+		if (layer >= vLayers.size()) return;
+		if (!bCanvas)
+			vLayers[layer].pCanvas.reset();
+		else if (!vLayers[layer].pCanvas)
+			vLayers[layer].pCanvas = std::make_unique<alo::Decal>(vScreenSize);
+	}
+
+	uint32_t GameEngine::CreateLayer()
+	{
+		LayerDesc ld;
+		ld.pDrawTarget.Create(vScreenSize.x, vScreenSize.y);
+		vLayers.push_back(std::move(ld));
+		return uint32_t(vLayers.size()) - 1;
+	}
+
+	void GameEngine::SetSupersample(int32_t n, alo::Raster::Downsampler filter)
+	{
+		nSupersample = std::clamp(n, 1, 8);
+		supersampleFilter = filter;
+		if (!vLayers.empty()) CreateSupersampleCanvas();
+	}
+
+	int32_t GameEngine::GetSupersample() const
+	{ return nSupersample; }
+
+	// Builds, resizes or drops layer 0's canvas to suit nSupersample, keeping
+	// what layer 0 currently shows
+	void GameEngine::CreateSupersampleCanvas()
+	{
+		const bool bTargetLayer0 = vDrawTarget.data == (pSupersample ? pSupersample->GetData() : vLayers[0].pDrawTarget.Sprite()->GetData());
+		if (pSupersample) ResolveSupersample();
+
+		if (nSupersample > 1)
+		{
+			pSupersample = std::make_unique<alo::Sprite>(vScreenSize.x * nSupersample, vScreenSize.y * nSupersample);
+			vLayers[0].pDrawTarget.Sprite()->ResampleTo(pSupersample.get(), alo::Sprite::Filter::NEAREST);
+		}
+		else
+			pSupersample.reset();
+
+		vLayers[0].dirty.Clear();
+		vLayers[0].bUpdate = true;
+		if (bTargetLayer0) SetDrawTarget(nullptr);
+	}
+
+	alo::Sprite* GameEngine::ResolveSupersample()
+	{
+		if (vLayers.empty()) return nullptr;
+		LayerDesc& layer = vLayers[0];
+		if (!pSupersample) return layer.pDrawTarget.Sprite();
+
+		// Canvas rectangles become screen rectangles, grown by the reach of the filter
+		const int32_t n = nSupersample;
+		const int32_t nReach = supersampleFilter == alo::Raster::Downsampler::LANCZOS ? 2 : 0;
+		alo::DirtyRegion::Rect vRects[8];
+		size_t nRects = 0;
+		if (layer.bUpdate)
+			vRects[nRects++] = { 0, 0, vScreenSize.x, vScreenSize.y };
+		else
+			for (size_t i = 0; i < layer.dirty.Count() && nRects < 8; i++)
+			{
+				const alo::DirtyRegion::Rect& r = layer.dirty[i];
+				vRects[nRects++] = { std::max(r.x0 / n - nReach, 0), std::max(r.y0 / n - nReach, 0),
+					std::min((r.x1 + n - 1) / n + nReach, vScreenSize.x), std::min((r.y1 + n - 1) / n + nReach, vScreenSize.y) };
+			}
+
+		const alo::SpriteView src = pSupersample->View(), dst = layer.pDrawTarget.Sprite()->View();
+		layer.dirty.Clear();
+		for (size_t i = 0; i < nRects; i++)
+		{
+			const alo::DirtyRegion::Rect r = vRects[i];
+			alo::ParallelRows(r.y0, r.y1, 8, [&](int32_t y0, int32_t y1)
+			{
+				alo::Raster::Downsample(src, dst, n, supersampleFilter, { r.x0, y0, r.x1, y1 });
+			});
+			if (!layer.bUpdate) layer.dirty.Add(r.x0, r.y0, r.x1, r.y1);
+		}
+		return layer.pDrawTarget.Sprite();
+	}
+
+	// Brings the parts of pGlow that the layer's changes reach up to date, and
+	// widens the dirty regions to match. Returns nullptr for sprites not laid out
+	// linearly, which present as they are
+	alo::Sprite* GameEngine::ApplyGlow(LayerDesc& layer)
+	{
+		const alo::SpriteView src = layer.pDrawTarget.Sprite()->View();
+		if (!src.IsValid()) return nullptr;
+		if (!layer.pGlow || layer.pGlow->width != src.width || layer.pGlow->height != src.height)
+		{
+			layer.pGlow = std::make_unique<alo::Sprite>(src.width, src.height, false);
+			layer.bUpdate = true;
+		}
+
+		const alo::SpriteView dst = layer.pGlow->View();
+		if (layer.bUpdate)
+		{
+			alo::Raster::Glow(src, dst, layer.nGlowRadius, layer.glowKernel, layer.fGlowStrength, { 0, 0, src.width, src.height });
+			return layer.pGlow.get();
+		}
+
+		const int32_t nReach = alo::Raster::BlurReach(layer.nGlowRadius, layer.glowKernel);
+		alo::DirtyRegion grown;
+		for (size_t i = 0; i < layer.dirty.Count(); i++)
+		{
+			const alo::DirtyRegion::Rect& r = layer.dirty[i];
+			grown.Add(std::max(r.x0 - nReach, 0), std::max(r.y0 - nReach, 0), std::min(r.x1 + nReach, src.width), std::min(r.y1 + nReach, src.height));
+		}
+		layer.dirty = grown;
+		for (size_t i = 0; i < layer.dirty.Count(); i++)
+			alo::Raster::Glow(src, dst, layer.nGlowRadius, layer.glowKernel, layer.fGlowStrength, layer.dirty[i]);
+		return layer.pGlow.get();
 	}
 
 	Sprite* GameEngine::GetDrawTarget() const
 	{ return pDrawTarget; }
 
-	int32_t GameEngine::GetDrawTargetWidth() const
+	const alo::SpriteView& GameEngine::GetDrawTargetView() const
+	{ return vDrawTarget; }
+
+	bool GameEngine::SetSpriteLayout(alo::Sprite* sprite, alo::Sprite::Layout layout)
 	{
-		if (pDrawTarget)
-			return pDrawTarget->width;
-		else
-			return 0;
+		if (sprite == nullptr) return false;
+		if (sprite == pDrawTarget && layout != alo::Sprite::Layout::LINEAR) return false;
+		sprite->SetLayout(layout);
+		return true;
 	}
 
-	int32_t GameEngine::GetDrawTargetHeight() const
+	alo::FrameArena& GameEngine::GetFrameArena()
+	{ return frameArena; }
+
+	void GameEngine::MarkDirty(int32_t x, int32_t y, int32_t w, int32_t h)
+	{ MarkDirtyRect(x * nDrawScale, y * nDrawScale, (x + w) * nDrawScale, (y + h) * nDrawScale); }
+
+	// Half open rectangle, clipped to the draw target
+	void GameEngine::MarkDirtyRect(int32_t x0, int32_t y0, int32_t x1, int32_t y1)
 	{
-		if (pDrawTarget)
-			return pDrawTarget->height;
-		else
-			return 0;
+		if (nDirtyLayer < 0) return;
+		vLayers[nDirtyLayer].dirty.Add(std::max(x0, 0), std::max(y0, 0), std::min(x1, vDrawTarget.width), std::min(y1, vDrawTarget.height));
 	}
 
+	int32_t GameEngine::GetDrawTargetWidth() const
+	{ return vDrawTarget.data ? vDrawTarget.width / nDrawScale : 0; }
+
+	int32_t GameEngine::GetDrawTargetHeight() const
+	{ return vDrawTarget.data ? vDrawTarget.height / nDrawScale : 0; }
+
 	uint32_t GameEngine::GetFPS() const
 	{ return nLastFPS; }
 
+	const alo::Renderer::FrameStats& GameEngine::GetRenderStats() const
+	{ return renderer->GetFrameStats(); }
+
+	void GameEngine::ReadScreenAsync(std::function<void(alo::Sprite&)> callback)
+	{ vScreenReads.push_back(std::move(callback)); }
+
 	bool GameEngine::IsFocused() const
 	{ return bHasInputFocus; }
 
@@ -1621,33 +4923,51 @@ namespace alo
 	// This is it, the critical function that plots a pixel
 	bool GameEngine::Draw(int32_t x, int32_t y, Pixel p)
 	{
-		if (!pDrawTarget) return false;
+		if (!vDrawTarget.data) return false;
+
+		// A supersampled target takes a block of pixels per screen pixel
+		if (nDrawScale > 1)
+		{
+			if (x < 0 || y < 0 || x >= GetDrawTargetWidth() || y >= GetDrawTargetHeight()) return false;
+			for (int32_t j = 0; j < nDrawScale; j++)
+				WriteSpan(x * nDrawScale, x * nDrawScale + nDrawScale - 1, y * nDrawScale + j, p);
+			return nPixelMode != Pixel::MASK || p.a == 255;
+		}
+
+		if (x < 0 || y < 0 || x >= vDrawTarget.width || y >= vDrawTarget.height) return false;
+		if (nDirtyLayer >= 0) vLayers[nDirtyLayer].dirty.Add(x, y, x + 1, y + 1);
+		Pixel& d = vDrawTarget.Row(y)[x];
 
 		if (nPixelMode == Pixel::NORMAL)
 		{
-			return pDrawTarget->SetPixel(x, y, p);
+			d = p;
+			return true;
 		}
 
 		if (nPixelMode == Pixel::MASK)
 		{
 			if (p.a == 255)
-				return pDrawTarget->SetPixel(x, y, p);
+			{
+				d = p;
+				return true;
+			}
 		}
 
 		if (nPixelMode == Pixel::ALPHA)
 		{
-			Pixel d = pDrawTarget->GetPixel(x, y);
 			float a = (float)(p.a / 255.0f) * fBlendFactor;
 			float c = 1.0f - a;
 			float r = a * (float)p.r + c * (float)d.r;
 			float g = a * (float)p.g + c * (float)d.g;
 			float b = a * (float)p.b + c * (float)d.b;
-			return pDrawTarget->SetPixel(x, y, Pixel((uint8_t)r, (uint8_t)g, (uint8_t)b/*, (uint8_t)(p.a * fBlendFactor)*/));
+			d = Pixel((uint8_t)r, (uint8_t)g, (uint8_t)b/*, (uint8_t)(p.a * fBlendFactor)*/);
+			return true;
 		}
 
 		if (nPixelMode == Pixel::CUSTOM)
 		{
-			return pDrawTarget->SetPixel(x, y, funcPixelMode(x, y, p, pDrawTarget->GetPixel(x, y)));
+			d = funcPixelMode(x, y, p, d);
+			return true;
 		}
 
 		return false;
@@ -1659,6 +4979,14 @@ namespace alo
 
 	void GameEngine::DrawLine(int32_t x1, int32_t y1, int32_t x2, int32_t y2, Pixel p, uint32_t pattern)
 	{
+		// Solid lines on a supersampled target are rasterised finely, one screen
+		// pixel wide through the centres of the end pixels
+		if (nDrawScale > 1 && pattern == 0xFFFFFFFF)
+		{
+			DrawStroke({ float(x1) + 0.5f, float(y1) + 0.5f }, { float(x2) + 0.5f, float(y2) + 0.5f }, 1.0f, p);
+			return;
+		}
+
 		int x, y, dx, dy, dx1, dy1, px, py, xe, ye, i;
 		dx = x2 - x1; dy = y2 - y1;
 
@@ -1669,6 +4997,7 @@ namespace alo
 		//	return;
 		x1 = p1.x; y1 = p1.y;
 		x2 = p2.x; y2 = p2.y;
+		MarkDirtyRect(std::min(x1, x2), std::min(y1, y2), std::max(x1, x2) + 1, std::max(y1, y2) + 1);
 
 		// straight lines idea by gurkanctn
 		if (dx == 0) // Line is vertical
@@ -1749,26 +5078,42 @@ namespace alo
 	{ 
 		if (radius < 0 || x < -radius || y < -radius || x - GetDrawTargetWidth() > radius || y - GetDrawTargetHeight() > radius)
 			return;
+		MarkDirtyRect(x - radius, y - radius, x + radius + 1, y + radius + 1);
 
 		if (radius > 0)
 		{
 			int x0 = 0;
 			int y0 = radius;
 			int d = 3 - 2 * radius;
+			int xs = 0; // Start of the run along row y0
 
 			while (y0 >= x0) // only formulate 1/8 of circle
 			{
-				// Draw even octants
-				if (mask & 0x01) Draw(x + x0, y - y0, p);// Q6 - upper right right
-				if (mask & 0x04) Draw(x + y0, y + x0, p);// Q4 - lower lower right
-				if (mask & 0x10) Draw(x - x0, y + y0, p);// Q2 - lower left left
-				if (mask & 0x40) Draw(x - y0, y - x0, p);// Q0 - upper upper left
+				// Steep octants move one row per step, so are single pixels
+				if (mask & 0x04) DrawSpan(x + y0, x + y0, y + x0, p);// Q4 - lower lower right
+				if (mask & 0x40) DrawSpan(x - y0, x - y0, y - x0, p);// Q0 - upper upper left
 				if (x0 != 0 && x0 != y0)
 				{
-					if (mask & 0x02) Draw(x + y0, y - x0, p);// Q7 - upper upper right
-					if (mask & 0x08) Draw(x + x0, y + y0, p);// Q5 - lower right right
-					if (mask & 0x20) Draw(x - y0, y + x0, p);// Q3 - lower lower left
-					if (mask & 0x80) Draw(x - x0, y - y0, p);// Q1 - upper left left
+					if (mask & 0x02) DrawSpan(x + y0, x + y0, y - x0, p);// Q7 - upper upper right
+					if (mask & 0x20) DrawSpan(x - y0, x - y0, y + x0, p);// Q3 - lower lower left
+				}
+
+				// Flat octants stay on row y0 until it steps, so emit the
+				// whole run in one go when it is about to change
+				if (d >= 0 || x0 + 1 > y0)
+				{
+					if (mask & 0x01) DrawSpan(x + xs, x + x0, y - y0, p);// Q6 - upper right right
+					if (mask & 0x10) DrawSpan(x - x0, x - xs, y + y0, p);// Q2 - lower left left
+
+					// Odd octants skip the points shared with their neighbours
+					int os = std::max(xs, 1);
+					int oe = (x0 == y0) ? x0 - 1 : x0;
+					if (os <= oe)
+					{
+						if (mask & 0x08) DrawSpan(x + os, x + oe, y + y0, p);// Q5 - lower right right
+						if (mask & 0x80) DrawSpan(x - oe, x - os, y - y0, p);// Q1 - upper left left
+					}
+					xs = x0 + 1;
 				}
 
 				if (d < 0)
@@ -1788,6 +5133,7 @@ namespace alo
 	{ 
 		if (radius < 0 || x < -radius || y < -radius || x - GetDrawTargetWidth() > radius || y - GetDrawTargetHeight() > radius)
 			return;
+		MarkDirtyRect(x - radius, y - radius, x + radius + 1, y + radius + 1);
 
 		if (radius > 0)
 		{
@@ -1795,16 +5141,10 @@ namespace alo
 			int y0 = radius;
 			int d = 3 - 2 * radius;
 
-			auto drawline = [&](int sx, int ex, int y)
-			{
-				for (int x = sx; x <= ex; x++)
-					Draw(x, y, p);
-			};
-
 			while (y0 >= x0)
 			{
-				drawline(x - y0, x + y0, y - x0);
-				if (x0 > 0)	drawline(x - y0, x + y0, y + x0);
+				DrawSpan(x - y0, x + y0, y - x0, p);
+				if (x0 > 0)	DrawSpan(x - y0, x + y0, y + x0, p);
 
 				if (d < 0)
 					d += 4 * x0++ + 6;
@@ -1812,8 +5152,8 @@ namespace alo
 				{
 					if (x0 != y0)
 					{
-						drawline(x - x0, x + x0, y - y0);
-						drawline(x - x0, x + x0, y + y0);
+						DrawSpan(x - x0, x + x0, y - y0, p);
+						DrawSpan(x - x0, x + x0, y + y0, p);
 					}
 					d += 4 * (x0++ - y0--) + 10;
 				}
@@ -1823,6 +5163,171 @@ namespace alo
 			Draw(x, y, p);
 	}
 
+	void GameEngine::DrawEllipse(const alo::vi2d& pos, const alo::vi2d& radius, Pixel p)
+	{ DrawEllipse(pos.x, pos.y, radius.x, radius.y, p); }
+
+	void GameEngine::DrawEllipse(int32_t x, int32_t y, int32_t rx, int32_t ry, Pixel p)
+	{
+		if (rx < 0 || ry < 0 || x < -rx || y < -ry || x - GetDrawTargetWidth() > rx || y - GetDrawTargetHeight() > ry)
+			return;
+		MarkDirtyRect(x - rx, y - ry, x + rx + 1, y + ry + 1);
+
+		// Midpoint test with doubled coordinates, so the boundary
+		// sits half a pixel outside the requested radii
+		const int64_t a2 = int64_t(2 * rx + 1) * int64_t(2 * rx + 1);
+		const int64_t b2 = int64_t(2 * ry + 1) * int64_t(2 * ry + 1);
+		auto inside = [&](int64_t px, int64_t py) { return 4 * (px * px * b2 + py * py * a2) <= a2 * b2; };
+
+		int32_t w = rx;
+		for (int32_t dy = 0; dy <= ry; dy++)
+		{
+			while (w > 0 && !inside(w, dy)) w--;
+
+			// Half width of the next row out, the outline on this
+			// row is whatever that row does not cover
+			int32_t wn = -1;
+			if (dy < ry) { wn = w; while (wn > 0 && !inside(wn, dy + 1)) wn--; }
+
+			int32_t s = std::min(wn + 1, w);
+			if (s <= 0)
+			{
+				DrawSpan(x - w, x + w, y - dy, p);
+				if (dy > 0) DrawSpan(x - w, x + w, y + dy, p);
+			}
+			else
+			{
+				DrawSpan(x - w, x - s, y - dy, p);
+				DrawSpan(x + s, x + w, y - dy, p);
+				if (dy > 0)
+				{
+					DrawSpan(x - w, x - s, y + dy, p);
+					DrawSpan(x + s, x + w, y + dy, p);
+				}
+			}
+		}
+	}
+
+	void GameEngine::FillEllipse(const alo::vi2d& pos, const alo::vi2d& radius, Pixel p)
+	{ FillEllipse(pos.x, pos.y, radius.x, radius.y, p); }
+
+	void GameEngine::FillEllipse(int32_t x, int32_t y, int32_t rx, int32_t ry, Pixel p)
+	{
+		if (rx < 0 || ry < 0 || x < -rx || y < -ry || x - GetDrawTargetWidth() > rx || y - GetDrawTargetHeight() > ry)
+			return;
+		MarkDirtyRect(x - rx, y - ry, x + rx + 1, y + ry + 1);
+
+		const int64_t a2 = int64_t(2 * rx + 1) * int64_t(2 * rx + 1);
+		const int64_t b2 = int64_t(2 * ry + 1) * int64_t(2 * ry + 1);
+		auto inside = [&](int64_t px, int64_t py) { return 4 * (px * px * b2 + py * py * a2) <= a2 * b2; };
+
+		int32_t w = rx;
+		for (int32_t dy = 0; dy <= ry; dy++)
+		{
+			while (w > 0 && !inside(w, dy)) w--;
+			DrawSpan(x - w, x + w, y - dy, p);
+			if (dy > 0) DrawSpan(x - w, x + w, y + dy, p);
+		}
+	}
+
+	void GameEngine::FillRing(const alo::vi2d& pos, int32_t inner, int32_t outer, Pixel p)
+	{ FillRing(pos.x, pos.y, inner, outer, p); }
+
+	void GameEngine::FillRing(int32_t x, int32_t y, int32_t inner, int32_t outer, Pixel p)
+	{
+		if (inner > outer) std::swap(inner, outer);
+		if (outer < 0 || x < -outer || y < -outer || x - GetDrawTargetWidth() > outer || y - GetDrawTargetHeight() > outer)
+			return;
+		MarkDirtyRect(x - outer, y - outer, x + outer + 1, y + outer + 1);
+
+		// Both radii are inclusive, so the hole is the disc one pixel
+		// inside the inner radius
+		const int32_t hole = inner - 1;
+		const int64_t o2 = int64_t(2 * outer + 1) * int64_t(2 * outer + 1);
+		const int64_t h2 = int64_t(2 * hole + 1) * int64_t(2 * hole + 1);
+
+		int32_t wo = outer, wh = hole;
+		for (int32_t dy = 0; dy <= outer; dy++)
+		{
+			while (wo > 0 && 4 * (int64_t(wo) * wo + int64_t(dy) * dy) > o2) wo--;
+
+			if (dy > hole)
+			{
+				DrawSpan(x - wo, x + wo, y - dy, p);
+				if (dy > 0) DrawSpan(x - wo, x + wo, y + dy, p);
+			}
+			else
+			{
+				while (wh > 0 && 4 * (int64_t(wh) * wh + int64_t(dy) * dy) > h2) wh--;
+				DrawSpan(x - wo, x - wh - 1, y - dy, p);
+				DrawSpan(x + wh + 1, x + wo, y - dy, p);
+				if (dy > 0)
+				{
+					DrawSpan(x - wo, x - wh - 1, y + dy, p);
+					DrawSpan(x + wh + 1, x + wo, y + dy, p);
+				}
+			}
+		}
+	}
+
+	void GameEngine::DrawSpan(int32_t x1, int32_t x2, int32_t y, Pixel p)
+	{
+		if (x1 > x2) std::swap(x1, x2);
+		if (nDrawScale == 1)
+		{
+			WriteSpan(x1, x2, y, p);
+			return;
+		}
+		for (int32_t j = 0; j < nDrawScale; j++)
+			WriteSpan(x1 * nDrawScale, x2 * nDrawScale + nDrawScale - 1, y * nDrawScale + j, p);
+	}
+
+	// DrawSpan() in draw target pixels, x1 <= x2
+	void GameEngine::WriteSpan(int32_t x1, int32_t x2, int32_t y, Pixel p)
+	{
+		if (!vDrawTarget.data) return;
+
+		// Clip the whole run once, rather than per pixel
+		if (y < 0 || y >= vDrawTarget.height || x2 < 0 || x1 >= vDrawTarget.width)
+			return;
+		x1 = std::max(x1, 0);
+		x2 = std::min(x2, vDrawTarget.width - 1);
+		if (nDirtyLayer >= 0) vLayers[nDirtyLayer].dirty.Add(x1, y, x2 + 1, y + 1);
+
+		Pixel* row = vDrawTarget.Row(y);
+
+		if (nPixelMode == Pixel::NORMAL)
+		{
+			std::fill(row + x1, row + x2 + 1, p);
+			return;
+		}
+
+		if (nPixelMode == Pixel::MASK)
+		{
+			if (p.a == 255) std::fill(row + x1, row + x2 + 1, p);
+			return;
+		}
+
+		if (nPixelMode == Pixel::ALPHA)
+		{
+			// Source terms are constant along the run
+			float a = (float)(p.a / 255.0f) * fBlendFactor;
+			float c = 1.0f - a;
+			float sr = a * (float)p.r, sg = a * (float)p.g, sb = a * (float)p.b;
+			for (int32_t x = x1; x <= x2; x++)
+			{
+				Pixel d = row[x];
+				row[x] = Pixel((uint8_t)(sr + c * (float)d.r), (uint8_t)(sg + c * (float)d.g), (uint8_t)(sb + c * (float)d.b));
+			}
+			return;
+		}
+
+		if (nPixelMode == Pixel::CUSTOM)
+		{
+			for (int32_t x = x1; x <= x2; x++)
+				row[x] = funcPixelMode(x, y, p, row[x]);
+		}
+	}
+
 	void GameEngine::DrawRect(const alo::vi2d& pos, const alo::vi2d& size, Pixel p)
 	{ DrawRect(pos.x, pos.y, size.x, size.y, p); }
 
@@ -1836,9 +5341,13 @@ namespace alo
 
 	void GameEngine::Clear(Pixel p)
 	{
-		int pixels = GetDrawTargetWidth() * GetDrawTargetHeight();
-		Pixel* m = GetDrawTarget()->GetData();
-		for (int i = 0; i < pixels; i++) m[i] = p;
+		if (!vDrawTarget.data) return;
+		MarkDirtyRect(0, 0, vDrawTarget.width, vDrawTarget.height);
+		if (vDrawTarget.IsContiguous())
+			std::fill(vDrawTarget.data, vDrawTarget.data + size_t(vDrawTarget.width) * vDrawTarget.height, p);
+		else
+			for (int32_t y = 0; y < vDrawTarget.height; y++)
+				std::fill(vDrawTarget.Row(y), vDrawTarget.Row(y) + vDrawTarget.width, p);
 	}
 
 	void GameEngine::ClearBuffer(Pixel p, bool bDepth)
@@ -1904,9 +5413,9 @@ namespace alo
 		if (y2 < 0) y2 = 0;
 		if (y2 >= (int32_t)GetDrawTargetHeight()) y2 = (int32_t)GetDrawTargetHeight();
 
-		for (int i = x; i < x2; i++)
-			for (int j = y; j < y2; j++)
-				Draw(i, j, p);
+		if (x >= x2) return;
+		for (int j = y; j < y2; j++)
+			DrawSpan(x, x2 - 1, j, p);
 	}
 
 	void GameEngine::DrawTriangle(const alo::vi2d& pos1, const alo::vi2d& pos2, const alo::vi2d& pos3, Pixel p)
@@ -1926,6 +5435,7 @@ namespace alo
 	void GameEngine::FillTriangle(int32_t x1, int32_t y1, int32_t x2, int32_t y2, int32_t x3, int32_t y3, Pixel p)
 	{
 		auto drawline = [&](int sx, int ex, int ny) { for (int i = sx; i <= ex; i++) Draw(i, ny, p); };
+		MarkDirtyRect(std::min({ x1, x2, x3 }), std::min({ y1, y2, y3 }), std::max({ x1, x2, x3 }) + 1, std::max({ y1, y2, y3 }) + 1);
 
 		int t1x, t2x, y, minx, maxx, t1xp, t2xp;
 		bool changed1 = false;
@@ -2066,6 +5576,10 @@ namespace alo
 		if (sprite == nullptr)
 			return;
 
+		if (scale == 1 && BlitPartialSprite(x, y, sprite, 0, 0, sprite->width, sprite->height, flip))
+			return;
+		MarkDirty(x, y, sprite->width * int32_t(scale), sprite->height * int32_t(scale));
+
 		int32_t fxs = 0, fxm = 1, fx = 0;
 		int32_t fys = 0, fym = 1, fy = 0;
 		if (flip & alo::Sprite::Flip::HORIZ) { fxs = sprite->width - 1; fxm = -1; }
@@ -2095,6 +5609,26 @@ namespace alo
 		}
 	}
 
+	void GameEngine::DrawSprite(const alo::vi2d& pos, const alo::SpriteView& view, uint8_t flip)
+	{ DrawSprite(pos.x, pos.y, view, flip); }
+
+	void GameEngine::DrawSprite(int32_t x, int32_t y, const alo::SpriteView& view, uint8_t flip)
+	{
+		if (!view.IsValid() || BlitPartialSprite(x, y, view, 0, 0, view.width, view.height, flip))
+			return;
+		MarkDirty(x, y, view.width, view.height);
+
+		// Custom pixel modes go through Draw()
+		const bool bFlipX = (flip & alo::Sprite::Flip::HORIZ) != 0;
+		const bool bFlipY = (flip & alo::Sprite::Flip::VERT) != 0;
+		for (int32_t j = 0; j < view.height; j++)
+		{
+			const Pixel* row = view.Row(bFlipY ? view.height - 1 - j : j);
+			for (int32_t i = 0; i < view.width; i++)
+				Draw(x + i, y + j, row[bFlipX ? view.width - 1 - i : i]);
+		}
+	}
+
 	void GameEngine::DrawPartialSprite(const alo::vi2d& pos, Sprite* sprite, const alo::vi2d& sourcepos, const alo::vi2d& size, uint32_t scale, uint8_t flip)
 	{ DrawPartialSprite(pos.x, pos.y, sprite, sourcepos.x, sourcepos.y, size.x, size.y, scale, flip); }
 
@@ -2103,6 +5637,10 @@ namespace alo
 		if (sprite == nullptr)
 			return;
 
+		if (scale == 1 && BlitPartialSprite(x, y, sprite, ox, oy, w, h, flip))
+			return;
+		MarkDirty(x, y, w * int32_t(scale), h * int32_t(scale));
+
 		int32_t fxs = 0, fxm = 1, fx = 0;
 		int32_t fys = 0, fym = 1, fy = 0;
 		if (flip & alo::Sprite::Flip::HORIZ) { fxs = w - 1; fxm = -1; }
@@ -2132,71 +5670,264 @@ namespace alo
 		}
 	}
 
+	// Unscaled sprite drawing, row at a time. Returns false if the request needs
+	// the general per-pixel path instead (custom blending, a supersampled target,
+	// or a source region that strays outside the sprite and so depends on its
+	// sample mode)
+	bool GameEngine::BlitPartialSprite(int32_t x, int32_t y, const alo::SpriteView& src, int32_t ox, int32_t oy, int32_t w, int32_t h, uint8_t flip)
+	{
+		if (!vDrawTarget.data || !src.data || nPixelMode == Pixel::CUSTOM || nDrawScale > 1)
+			return false;
+		if (ox < 0 || oy < 0 || w < 0 || h < 0 || ox + w > src.width || oy + h > src.height)
+			return false;
+
+		// Clip destination rectangle to draw target
+		int32_t cx0 = std::max(x, 0), cx1 = std::min(x + w, vDrawTarget.width);
+		int32_t cy0 = std::max(y, 0), cy1 = std::min(y + h, vDrawTarget.height);
+		if (cx0 >= cx1 || cy0 >= cy1)
+			return true;
+		MarkDirtyRect(cx0, cy0, cx1, cy1);
+
+		const bool bFlipX = (flip & alo::Sprite::Flip::HORIZ) != 0;
+		const bool bFlipY = (flip & alo::Sprite::Flip::VERT) != 0;
+		const int32_t n = cx1 - cx0;
+		const int32_t i0 = cx0 - x;
+		const int32_t sx = bFlipX ? ox + w - 1 - i0 : ox + i0;
+
+		for (int32_t dy = cy0; dy < cy1; dy++)
+		{
+			int32_t j = dy - y;
+			int32_t sy = bFlipY ? oy + h - 1 - j : oy + j;
+			const Pixel* s = src.Row(sy) + sx;
+			Pixel* d = vDrawTarget.Row(dy) + cx0;
+
+			if (nPixelMode == Pixel::NORMAL)
+				Blit::CopyRow(d, s, n, bFlipX);
+			else if (nPixelMode == Pixel::MASK)
+				Blit::MaskRow(d, s, n, bFlipX);
+			else
+				Blit::AlphaRow(d, s, n, fBlendFactor, bFlipX);
+		}
+		return true;
+	}
+
+	void GameEngine::DrawSpriteTransformed(Sprite* sprite, const alo::Transform2D& transform, alo::Sprite::Filter filter)
+	{
+		if (sprite == nullptr || !vDrawTarget.data || sprite->width <= 0 || sprite->height <= 0)
+			return;
+
+		// A supersampled target is mapped to at its own resolution
+		alo::Transform2D toTarget = transform;
+		if (nDrawScale > 1) toTarget.Scale(float(nDrawScale), float(nDrawScale));
+
+		alo::Transform2D inv;
+		if (!toTarget.Inverse(inv))
+			return;
+
+		// Destination bounding box of the transformed sprite, clipped once
+		const float sw = float(sprite->width), sh = float(sprite->height);
+		alo::vf2d c[4] = { toTarget.Forward({ 0, 0 }), toTarget.Forward({ sw, 0 }), toTarget.Forward({ 0, sh }), toTarget.Forward({ sw, sh }) };
+		alo::vf2d vMin = c[0], vMax = c[0];
+		for (auto& p : c) { vMin = vMin.min(p); vMax = vMax.max(p); }
+		int32_t bx0 = std::max(int32_t(std::floor(vMin.x)), 0), bx1 = std::min(int32_t(std::ceil(vMax.x)), vDrawTarget.width);
+		int32_t by0 = std::max(int32_t(std::floor(vMin.y)), 0), by1 = std::min(int32_t(std::ceil(vMax.y)), vDrawTarget.height);
+		if (bx0 >= bx1 || by0 >= by1)
+			return;
+		MarkDirtyRect(bx0, by0, bx1, by1);
+
+		// Source position steps by a constant amount per destination pixel
+		const float du = inv.m[0][0], dv = inv.m[1][0];
+		const int32_t nDu = int32_t(std::lround(du * 65536.0f)), nDv = int32_t(std::lround(dv * 65536.0f));
+		const bool bBilinear = filter == alo::Sprite::Filter::BILINEAR;
+		const float fBias = bBilinear ? 0.5f : 0.0f;
+
+		// Range of i for which a + i * d lies in [0, lim)
+		auto span = [](float a, float d, float lim, int32_t& lo, int32_t& hi)
+		{
+			if (std::abs(d) < 1e-9f)
+			{
+				if (a < 0.0f || a >= lim) hi = lo;
+				return;
+			}
+			float t0 = -a / d, t1 = (lim - a) / d;
+			if (d < 0.0f) std::swap(t0, t1);
+			lo = std::max(lo, int32_t(std::max(std::ceil(t0), -1e9f)));
+			hi = std::min(hi, int32_t(std::min(std::ceil(t1), 1e9f)));
+		};
+
+		alo::FrameArena::Marker mark = frameArena.Mark();
+		Pixel* pRow = frameArena.Allocate<Pixel>(size_t(bx1 - bx0));
+		const Pixel* pData = sprite->GetData();
+		const int32_t mx = sprite->width - 1, my = sprite->height - 1;
+
+		for (int32_t y = by0; y < by1; y++)
+		{
+			float ua = inv.m[0][0] * (float(bx0) + 0.5f) + inv.m[0][1] * (float(y) + 0.5f) + inv.m[0][2];
+			float va = inv.m[1][0] * (float(bx0) + 0.5f) + inv.m[1][1] * (float(y) + 0.5f) + inv.m[1][2];
+			int32_t lo = 0, hi = bx1 - bx0;
+			span(ua, du, sw, lo, hi);
+			span(va, dv, sh, lo, hi);
+			if (lo >= hi) continue;
+
+			// 16.16 fixed point walk along the row
+			int64_t u = std::llround((ua + du * float(lo) - fBias) * 65536.0f);
+			int64_t v = std::llround((va + dv * float(lo) - fBias) * 65536.0f);
+			const int32_t n = hi - lo;
+			if (bBilinear)
+			{
+				for (int32_t i = 0; i < n; i++, u += nDu, v += nDv)
+				{
+					int32_t x0 = int32_t(u >> 16), y0 = int32_t(v >> 16);
+					const Pixel* r0 = pData + sprite->RowOffset(std::clamp(y0, 0, my));
+					const Pixel* r1 = pData + sprite->RowOffset(std::clamp(y0 + 1, 0, my));
+					size_t c0 = sprite->ColOffset(std::clamp(x0, 0, mx)), c1 = sprite->ColOffset(std::clamp(x0 + 1, 0, mx));
+					pRow[i] = BilerpFixed(r0[c0], r0[c1], r1[c0], r1[c1], uint32_t(u >> 8) & 0xFF, uint32_t(v >> 8) & 0xFF);
+				}
+			}
+			else
+			{
+				for (int32_t i = 0; i < n; i++, u += nDu, v += nDv)
+					pRow[i] = pData[sprite->Index(std::clamp(int32_t(u >> 16), 0, mx), std::clamp(int32_t(v >> 16), 0, my))];
+			}
+
+			Pixel* dst = vDrawTarget.Row(y) + bx0 + lo;
+			if (nPixelMode == Pixel::NORMAL)
+				Blit::CopyRow(dst, pRow, n, false);
+			else if (nPixelMode == Pixel::MASK)
+				Blit::MaskRow(dst, pRow, n, false);
+			else if (nPixelMode == Pixel::ALPHA)
+				Blit::AlphaRow(dst, pRow, n, fBlendFactor, false);
+			else
+				for (int32_t i = 0; i < n; i++)
+					dst[i] = funcPixelMode(bx0 + lo + i, y, pRow[i], dst[i]);
+		}
+		frameArena.Rewind(mark);
+	}
+
+	// Tiled sprites are gathered into a linear row at a time, then blitted as usual
+	bool GameEngine::BlitPartialSprite(int32_t x, int32_t y, Sprite* sprite, int32_t ox, int32_t oy, int32_t w, int32_t h, uint8_t flip)
+	{
+		if (sprite->GetLayout() == alo::Sprite::Layout::LINEAR)
+			return BlitPartialSprite(x, y, sprite->View(), ox, oy, w, h, flip);
+
+		if (!vDrawTarget.data || nPixelMode == Pixel::CUSTOM || nDrawScale > 1)
+			return false;
+		if (ox < 0 || oy < 0 || w < 0 || h < 0 || ox + w > sprite->width || oy + h > sprite->height)
+			return false;
+
+		const bool bFlipY = (flip & alo::Sprite::Flip::VERT) != 0;
+		MarkDirtyRect(x, y, x + w, y + h);
+		alo::FrameArena::Marker mark = frameArena.Mark();
+		Pixel* pRow = frameArena.Allocate<Pixel>(size_t(w));
+		for (int32_t dy = std::max(y, 0); dy < std::min(y + h, vDrawTarget.height); dy++)
+		{
+			int32_t j = dy - y;
+			sprite->ReadRow(ox, bFlipY ? oy + h - 1 - j : oy + j, w, pRow);
+			BlitPartialSprite(x, dy, alo::SpriteView(pRow, w, 1), 0, 0, w, 1, flip & alo::Sprite::Flip::HORIZ);
+		}
+		frameArena.Rewind(mark);
+		return true;
+	}
+
 	void GameEngine::SetDecalMode(const alo::DecalMode& mode)
 	{ nDecalMode = mode; }
 
 	void GameEngine::SetDecalStructure(const alo::DecalStructure& structure)
 	{ nDecalStructure = structure; }
 
+	void GameEngine::SetDecalTarget(alo::Decal* target)
+	{
+		if (target == nullptr || target->nTarget == 0)
+		{
+			nDecalTarget = -1;
+			vInvDecalSize = vInvScreenSize;
+			return;
+		}
+		nDecalTarget = int32_t(FindDecalTarget(target));
+		vInvDecalSize = { 1.0f / float(target->vSize.x), 1.0f / float(target->vSize.y) };
+	}
+
+	void GameEngine::ClearDecalTarget(alo::Decal* target, const alo::Pixel& p)
+	{
+		if (target == nullptr || target->nTarget == 0) return;
+		DecalTargetDesc& desc = vDecalTargets[FindDecalTarget(target)];
+		desc.bClear = true;
+		desc.clear = p;
+	}
+
+	// Entries are released rather than erased, so the one set stays valid by
+	// index, and a released entry is reused with its stream's storage
+	size_t GameEngine::FindDecalTarget(alo::Decal* target)
+	{
+		size_t nFree = vDecalTargets.size();
+		for (size_t i = 0; i < vDecalTargets.size(); i++)
+		{
+			if (vDecalTargets[i].target == target) return i;
+			if (vDecalTargets[i].target == nullptr && nFree == vDecalTargets.size()) nFree = i;
+		}
+		if (nFree == vDecalTargets.size()) vDecalTargets.emplace_back();
+		vDecalTargets[nFree].target = target;
+		target->pTargetOwner = this;
+		return nFree;
+	}
+
+	void GameEngine::DropDecalTarget(alo::Decal* target)
+	{
+		for (size_t i = 0; i < vDecalTargets.size(); i++)
+			if (vDecalTargets[i].target == target)
+			{
+				target->pTargetOwner = nullptr;
+				vDecalTargets[i].target = nullptr;
+				vDecalTargets[i].decals.Clear();
+				vDecalTargets[i].bClear = false;
+				if (nDecalTarget == int32_t(i)) SetDecalTarget(nullptr);
+			}
+	}
+
+	alo::DecalStream& GameEngine::DecalTargetStream()
+	{ return nDecalTarget < 0 ? vLayers[nTargetLayer].decals : vDecalTargets[nDecalTarget].decals; }
+
 	void GameEngine::DrawPartialDecal(const alo::vf2d& pos, alo::Decal* decal, const alo::vf2d& source_pos, const alo::vf2d& source_size, const alo::vf2d& scale, const alo::Pixel& tint)
 	{
 		alo::vf2d vScreenSpacePos =
 		{
-			  (pos.x * vInvScreenSize.x) * 2.0f - 1.0f,
-			-((pos.y * vInvScreenSize.y) * 2.0f - 1.0f)
+			  (pos.x * vInvDecalSize.x) * 2.0f - 1.0f,
+			-((pos.y * vInvDecalSize.y) * 2.0f - 1.0f)
 		};
 
 		
 		alo::vf2d vScreenSpaceDim =
 		{
-			  ((pos.x + source_size.x * scale.x) * vInvScreenSize.x) * 2.0f - 1.0f,
-			-(((pos.y + source_size.y * scale.y) * vInvScreenSize.y) * 2.0f - 1.0f)
+			  ((pos.x + source_size.x * scale.x) * vInvDecalSize.x) * 2.0f - 1.0f,
+			-(((pos.y + source_size.y * scale.y) * vInvDecalSize.y) * 2.0f - 1.0f)
 		};
 
 		alo::vf2d vWindow = alo::vf2d(vViewSize);
 		alo::vf2d vQuantisedPos = ((vScreenSpacePos * vWindow) + alo::vf2d(0.5f, 0.5f)).floor() / vWindow;
 		alo::vf2d vQuantisedDim = ((vScreenSpaceDim * vWindow) + alo::vf2d(0.5f, -0.5f)).ceil() / vWindow;
 
-		DecalInstance di;
-		di.points = 4;
-		di.decal = decal;
-		di.tint = { tint, tint, tint, tint };
-		di.pos = { { vQuantisedPos.x, vQuantisedPos.y }, { vQuantisedPos.x, vQuantisedDim.y }, { vQuantisedDim.x, vQuantisedDim.y }, { vQuantisedDim.x, vQuantisedPos.y } };
-		alo::vf2d uvtl = (source_pos + alo::vf2d(0.0001f, 0.0001f)) * decal->vUVScale;
-		alo::vf2d uvbr = (source_pos + source_size - alo::vf2d(0.0001f, 0.0001f)) * decal->vUVScale;
-		di.uv = { { uvtl.x, uvtl.y }, { uvtl.x, uvbr.y }, { uvbr.x, uvbr.y }, { uvbr.x, uvtl.y } };
-		di.w = { 1,1,1,1 };
-		di.mode = nDecalMode;
-		di.structure = nDecalStructure;
-		vLayers[nTargetLayer].vecDecalInstance.push_back(di);
+		alo::vf2d uvtl = decal->vUVOffset + (source_pos + alo::vf2d(0.0001f, 0.0001f)) * decal->vUVScale;
+		alo::vf2d uvbr = decal->vUVOffset + (source_pos + source_size - alo::vf2d(0.0001f, 0.0001f)) * decal->vUVScale;
+		PushQuad(decal, vQuantisedPos, vQuantisedDim, uvtl, uvbr, tint);
 	}
 
 	void GameEngine::DrawPartialDecal(const alo::vf2d& pos, const alo::vf2d& size, alo::Decal* decal, const alo::vf2d& source_pos, const alo::vf2d& source_size, const alo::Pixel& tint)
 	{
 		alo::vf2d vScreenSpacePos =
 		{
-			(pos.x * vInvScreenSize.x) * 2.0f - 1.0f,
-			((pos.y * vInvScreenSize.y) * 2.0f - 1.0f) * -1.0f
+			(pos.x * vInvDecalSize.x) * 2.0f - 1.0f,
+			((pos.y * vInvDecalSize.y) * 2.0f - 1.0f) * -1.0f
 		};
 
 		alo::vf2d vScreenSpaceDim =
 		{
-			vScreenSpacePos.x + (2.0f * size.x * vInvScreenSize.x),
-			vScreenSpacePos.y - (2.0f * size.y * vInvScreenSize.y)
+			vScreenSpacePos.x + (2.0f * size.x * vInvDecalSize.x),
+			vScreenSpacePos.y - (2.0f * size.y * vInvDecalSize.y)
 		};
 
-		DecalInstance di;
-		di.points = 4;
-		di.decal = decal;
-		di.tint = { tint, tint, tint, tint };
-		di.pos = { { vScreenSpacePos.x, vScreenSpacePos.y }, { vScreenSpacePos.x, vScreenSpaceDim.y }, { vScreenSpaceDim.x, vScreenSpaceDim.y }, { vScreenSpaceDim.x, vScreenSpacePos.y } };
-		alo::vf2d uvtl = (source_pos) * decal->vUVScale;
+		alo::vf2d uvtl = decal->vUVOffset + (source_pos) * decal->vUVScale;
 		alo::vf2d uvbr = uvtl + ((source_size) * decal->vUVScale);
-		di.uv = { { uvtl.x, uvtl.y }, { uvtl.x, uvbr.y }, { uvbr.x, uvbr.y }, { uvbr.x, uvtl.y } };
-		di.w = { 1,1,1,1 };
-		di.mode = nDecalMode;
-		di.structure = nDecalStructure;
-		vLayers[nTargetLayer].vecDecalInstance.push_back(di);
+		PushQuad(decal, vScreenSpacePos, vScreenSpaceDim, uvtl, uvbr, tint);
 	}
 
 
@@ -2204,149 +5935,140 @@ namespace alo
 	{
 		alo::vf2d vScreenSpacePos =
 		{
-			(pos.x * vInvScreenSize.x) * 2.0f - 1.0f,
-			((pos.y * vInvScreenSize.y) * 2.0f - 1.0f) * -1.0f
+			(pos.x * vInvDecalSize.x) * 2.0f - 1.0f,
+			((pos.y * vInvDecalSize.y) * 2.0f - 1.0f) * -1.0f
 		};
 
 		alo::vf2d vScreenSpaceDim =
 		{
-			vScreenSpacePos.x + (2.0f * (float(decal->sprite->width) * vInvScreenSize.x)) * scale.x,
-			vScreenSpacePos.y - (2.0f * (float(decal->sprite->height) * vInvScreenSize.y)) * scale.y
+			vScreenSpacePos.x + (2.0f * (float(decal->vSize.x) * vInvDecalSize.x)) * scale.x,
+			vScreenSpacePos.y - (2.0f * (float(decal->vSize.y) * vInvDecalSize.y)) * scale.y
 		};
 
-		DecalInstance di;
-		di.decal = decal;
-		di.points = 4;
-		di.tint = { tint, tint, tint, tint };
-		di.pos = { { vScreenSpacePos.x, vScreenSpacePos.y }, { vScreenSpacePos.x, vScreenSpaceDim.y }, { vScreenSpaceDim.x, vScreenSpaceDim.y }, { vScreenSpaceDim.x, vScreenSpacePos.y } };
-		di.uv = { { 0.0f, 0.0f}, {0.0f, 1.0f}, {1.0f, 1.0f}, {1.0f, 0.0f} };
-		di.w = { 1, 1, 1, 1 };
-		di.mode = nDecalMode;
-		di.structure = nDecalStructure;
-		vLayers[nTargetLayer].vecDecalInstance.push_back(di);
+		PushQuad(decal, vScreenSpacePos, vScreenSpaceDim, decal->vUVOffset, decal->vUVOffset + decal->vUVExtent, tint);
 	}
 
 	void GameEngine::DrawExplicitDecal(alo::Decal* decal, const alo::vf2d* pos, const alo::vf2d* uv, const alo::Pixel* col, uint32_t elements)
 	{
-		DecalInstance di;
-		di.decal = decal;
-		di.pos.resize(elements);
-		di.uv.resize(elements);
-		di.w.resize(elements);
-		di.tint.resize(elements);
-		di.points = elements;
+		// Texture coordinates are over the decal's own image, wherever it sits in its texture
+		const alo::vf2d vUVOffset = decal ? decal->vUVOffset : alo::vf2d(0.0f, 0.0f), vUVExtent = decal ? decal->vUVExtent : alo::vf2d(1.0f, 1.0f);
+		alo::DecalVertex* v = PushDecal(decal, elements);
 		for (uint32_t i = 0; i < elements; i++)
 		{
-			di.pos[i] = { (pos[i].x * vInvScreenSize.x) * 2.0f - 1.0f, ((pos[i].y * vInvScreenSize.y) * 2.0f - 1.0f) * -1.0f };
-			di.uv[i] = uv[i];
-			di.tint[i] = col[i];
-			di.w[i] = 1.0f;
+			v[i].pos = { (pos[i].x * vInvDecalSize.x) * 2.0f - 1.0f, ((pos[i].y * vInvDecalSize.y) * 2.0f - 1.0f) * -1.0f };
+			v[i].uv = vUVOffset + uv[i] * vUVExtent;
+			v[i].tint = col[i];
 		}
-		di.mode = nDecalMode;
-		di.structure = nDecalStructure;
-		vLayers[nTargetLayer].vecDecalInstance.push_back(di);
 	}
 
 	void GameEngine::DrawPolygonDecal(alo::Decal* decal, const std::vector<alo::vf2d>& pos, const std::vector<alo::vf2d>& uv, const alo::Pixel tint)
 	{
-		DecalInstance di;
-		di.decal = decal;
-		di.points = uint32_t(pos.size());
-		di.pos.resize(di.points);
-		di.uv.resize(di.points);
-		di.w.resize(di.points);
-		di.tint.resize(di.points);
-		for (uint32_t i = 0; i < di.points; i++)
+		const alo::vf2d vUVOffset = decal ? decal->vUVOffset : alo::vf2d(0.0f, 0.0f), vUVExtent = decal ? decal->vUVExtent : alo::vf2d(1.0f, 1.0f);
+		alo::DecalVertex* v = PushDecal(decal, uint32_t(pos.size()));
+		for (size_t i = 0; i < pos.size(); i++)
 		{
-			di.pos[i] = { (pos[i].x * vInvScreenSize.x) * 2.0f - 1.0f, ((pos[i].y * vInvScreenSize.y) * 2.0f - 1.0f) * -1.0f };
-			di.uv[i] = uv[i];
-			di.tint[i] = tint;
-			di.w[i] = 1.0f;
+			v[i].pos = { (pos[i].x * vInvDecalSize.x) * 2.0f - 1.0f, ((pos[i].y * vInvDecalSize.y) * 2.0f - 1.0f) * -1.0f };
+			v[i].uv = vUVOffset + uv[i] * vUVExtent;
+			v[i].tint = tint;
 		}
-		di.mode = nDecalMode;
-		di.structure = nDecalStructure;
-		vLayers[nTargetLayer].vecDecalInstance.push_back(di);
 	}
 
 	void GameEngine::DrawPolygonDecal(alo::Decal* decal, const std::vector<alo::vf2d>& pos, const std::vector<alo::vf2d>& uv, const std::vector<alo::Pixel> &tint)
 	{
-		DecalInstance di;
-		di.decal = decal;
-		di.points = uint32_t(pos.size());
-		di.pos.resize(di.points);
-		di.uv.resize(di.points);
-		di.w.resize(di.points);
-		di.tint.resize(di.points);
-		for (uint32_t i = 0; i < di.points; i++)
+		const alo::vf2d vUVOffset = decal ? decal->vUVOffset : alo::vf2d(0.0f, 0.0f), vUVExtent = decal ? decal->vUVExtent : alo::vf2d(1.0f, 1.0f);
+		alo::DecalVertex* v = PushDecal(decal, uint32_t(pos.size()));
+		for (size_t i = 0; i < pos.size(); i++)
 		{
-			di.pos[i] = { (pos[i].x * vInvScreenSize.x) * 2.0f - 1.0f, ((pos[i].y * vInvScreenSize.y) * 2.0f - 1.0f) * -1.0f };
-			di.uv[i] = uv[i];
-			di.tint[i] = tint[i];
-			di.w[i] = 1.0f;
+			v[i].pos = { (pos[i].x * vInvDecalSize.x) * 2.0f - 1.0f, ((pos[i].y * vInvDecalSize.y) * 2.0f - 1.0f) * -1.0f };
+			v[i].uv = vUVOffset + uv[i] * vUVExtent;
+			v[i].tint = tint[i];
 		}
-		di.mode = nDecalMode;
-		di.structure = nDecalStructure;
-		vLayers[nTargetLayer].vecDecalInstance.push_back(di);
 	}
 
 	void GameEngine::DrawPolygonDecal(alo::Decal* decal, const std::vector<alo::vf2d>& pos, const std::vector<float>& depth, const std::vector<alo::vf2d>& uv, const alo::Pixel tint)
 	{
-		DecalInstance di;
-		di.decal = decal;
-		di.points = uint32_t(pos.size());
-		di.pos.resize(di.points);
-		di.uv.resize(di.points);
-		di.w.resize(di.points);
-		di.tint.resize(di.points);
-		for (uint32_t i = 0; i < di.points; i++)
+		UNUSED(depth);
+		DrawPolygonDecal(decal, pos, uv, tint);
+	}
+
+	void GameEngine::DrawIndexedDecal(alo::Decal* decal, const std::vector<alo::vf2d>& pos, const std::vector<alo::vf2d>& uv, const std::vector<uint32_t>& indices, const alo::Pixel tint)
+	{
+		const alo::vf2d vUVOffset = decal ? decal->vUVOffset : alo::vf2d(0.0f, 0.0f), vUVExtent = decal ? decal->vUVExtent : alo::vf2d(1.0f, 1.0f);
+		alo::DecalVertex* v = PushDecal(decal, uint32_t(pos.size()));
+		for (size_t i = 0; i < pos.size(); i++)
+		{
+			v[i].pos = { (pos[i].x * vInvDecalSize.x) * 2.0f - 1.0f, ((pos[i].y * vInvDecalSize.y) * 2.0f - 1.0f) * -1.0f };
+			v[i].uv = i < uv.size() ? vUVOffset + uv[i] * vUVExtent : vUVOffset;
+			v[i].tint = tint;
+		}
+		PushDecalIndices(indices, uint32_t(pos.size()));
+	}
+
+	void GameEngine::DrawIndexedDecal(alo::Decal* decal, const std::vector<alo::vf2d>& pos, const std::vector<alo::vf2d>& uv, const std::vector<uint32_t>& indices, const std::vector<alo::Pixel>& tint)
+	{
+		const alo::vf2d vUVOffset = decal ? decal->vUVOffset : alo::vf2d(0.0f, 0.0f), vUVExtent = decal ? decal->vUVExtent : alo::vf2d(1.0f, 1.0f);
+		alo::DecalVertex* v = PushDecal(decal, uint32_t(pos.size()));
+		for (size_t i = 0; i < pos.size(); i++)
+		{
+			v[i].pos = { (pos[i].x * vInvDecalSize.x) * 2.0f - 1.0f, ((pos[i].y * vInvDecalSize.y) * 2.0f - 1.0f) * -1.0f };
+			v[i].uv = i < uv.size() ? vUVOffset + uv[i] * vUVExtent : vUVOffset;
+			v[i].tint = tint[i];
+		}
+		PushDecalIndices(indices, uint32_t(pos.size()));
+	}
+
+	// Indices past the last vertex become restarts, dropping the primitives using them
+	void GameEngine::PushDecalIndices(const std::vector<uint32_t>& indices, uint32_t nVertices)
+	{
+		uint32_t* pIndices = DecalTargetStream().PushIndices(uint32_t(indices.size()));
+		for (size_t i = 0; i < indices.size(); i++)
+			pIndices[i] = indices[i] < nVertices ? indices[i] : alo::nDecalRestart;
+	}
+
+	void GameEngine::DrawInstancedDecal(alo::Decal* decal, const alo::QuadInstance* pInstances, size_t nCount)
+	{
+		if (nCount == 0) return;
+		const alo::vf2d vUVOffset = decal ? decal->vUVOffset : alo::vf2d(0.0f, 0.0f), vUVExtent = decal ? decal->vUVExtent : alo::vf2d(1.0f, 1.0f);
+		const alo::vf2d vScale = { 2.0f * vInvDecalSize.x, -2.0f * vInvDecalSize.y };
+		alo::QuadInstance* q = DecalTargetStream().PushInstances(decal, nDecalMode, uint32_t(nCount));
+		for (size_t i = 0; i < nCount; i++)
 		{
-			di.pos[i] = { (pos[i].x * vInvScreenSize.x) * 2.0f - 1.0f, ((pos[i].y * vInvScreenSize.y) * 2.0f - 1.0f) * -1.0f };
-			di.uv[i] = uv[i];
-			di.tint[i] = tint;
-			di.w[i] = 1.0f;
+			q[i].pos = pInstances[i].pos * vScale + alo::vf2d(-1.0f, 1.0f);
+			q[i].axisX = pInstances[i].axisX * vScale;
+			q[i].axisY = pInstances[i].axisY * vScale;
+			q[i].uv = vUVOffset + pInstances[i].uv * vUVExtent;
+			q[i].uvSize = pInstances[i].uvSize * vUVExtent;
+			q[i].tint = pInstances[i].tint;
 		}
-		di.mode = nDecalMode;
-		di.structure = nDecalStructure;
-		vLayers[nTargetLayer].vecDecalInstance.push_back(di);
 	}
 
+	void GameEngine::DrawInstancedDecal(alo::Decal* decal, const std::vector<alo::QuadInstance>& vInstances)
+	{ DrawInstancedDecal(decal, vInstances.data(), vInstances.size()); }
+
 	void GameEngine::DrawLineDecal(const alo::vf2d& pos1, const alo::vf2d& pos2, Pixel p)
 	{
-		auto m = nDecalMode;
-		nDecalMode = alo::DecalMode::WIREFRAME;
-		DrawPolygonDecal(nullptr, { pos1, pos2 }, { {0, 0}, {0,0} }, p);
-		nDecalMode = m;
-
-		/*DecalInstance di;
-		di.decal = nullptr;
-		di.points = uint32_t(2);
-		di.pos.resize(di.points);
-		di.uv.resize(di.points);
-		di.w.resize(di.points);
-		di.tint.resize(di.points);
-		di.pos[0] = { (pos1.x * vInvScreenSize.x) * 2.0f - 1.0f, ((pos1.y * vInvScreenSize.y) * 2.0f - 1.0f) * -1.0f };
-		di.uv[0] = { 0.0f, 0.0f };
-		di.tint[0] = p;
-		di.w[0] = 1.0f;
-		di.pos[1] = { (pos2.x * vInvScreenSize.x) * 2.0f - 1.0f, ((pos2.y * vInvScreenSize.y) * 2.0f - 1.0f) * -1.0f };
-		di.uv[1] = { 0.0f, 0.0f };
-		di.tint[1] = p;
-		di.w[1] = 1.0f;
-		di.mode = olc::DecalMode::WIREFRAME;
-		di.structure = nDecalStructure;
-		vLayers[nTargetLayer].vecDecalInstance.push_back(di);*/
+		// A line whatever structure is set, as strips and lists need three points
+		alo::DecalVertex* v = DecalTargetStream().Push(nullptr, alo::DecalMode::WIREFRAME, alo::DecalStructure::LINE, 2);
+		v[0].pos = { (pos1.x * vInvDecalSize.x) * 2.0f - 1.0f, ((pos1.y * vInvDecalSize.y) * 2.0f - 1.0f) * -1.0f };
+		v[0].tint = p;
+		v[1].pos = { (pos2.x * vInvDecalSize.x) * 2.0f - 1.0f, ((pos2.y * vInvDecalSize.y) * 2.0f - 1.0f) * -1.0f };
+		v[1].tint = p;
 	}
 
 	void GameEngine::DrawRectDecal(const alo::vf2d& pos, const alo::vf2d& size, const alo::Pixel col)
 	{
+		// Outlined as a wireframe fan whatever structure is set
 		auto m = nDecalMode;
+		auto s = nDecalStructure;
 		SetDecalMode(alo::DecalMode::WIREFRAME);
+		nDecalStructure = alo::DecalStructure::FAN;
 		alo::vf2d vNewSize = size;// (size - olc::vf2d(0.375f, 0.375f)).ceil();
 		std::array<alo::vf2d, 4> points = { { {pos}, {pos.x, pos.y + vNewSize.y}, {pos + vNewSize}, {pos.x + vNewSize.x, pos.y} } };
 		std::array<alo::vf2d, 4> uvs = { {{0,0},{0,0},{0,0},{0,0}} };
 		std::array<alo::Pixel, 4> cols = { {col, col, col, col} };
 		DrawExplicitDecal(nullptr, points.data(), uvs.data(), cols.data(), 4);
 		SetDecalMode(m);
+		nDecalStructure = s;
 
 	}
 
@@ -2369,75 +6091,55 @@ namespace alo
 
 	void GameEngine::DrawRotatedDecal(const alo::vf2d& pos, alo::Decal* decal, const float fAngle, const alo::vf2d& center, const alo::vf2d& scale, const alo::Pixel& tint)
 	{
-		DecalInstance di;
-		di.decal = decal;
-		di.pos.resize(4);
-		di.uv = { { 0.0f, 0.0f}, {0.0f, 1.0f}, {1.0f, 1.0f}, {1.0f, 0.0f} };
-		di.w = { 1, 1, 1, 1 };
-		di.tint = { tint, tint, tint, tint };
-		di.points = 4;
-		di.pos[0] = (alo::vf2d(0.0f, 0.0f) - center) * scale;
-		di.pos[1] = (alo::vf2d(0.0f, float(decal->sprite->height)) - center) * scale;
-		di.pos[2] = (alo::vf2d(float(decal->sprite->width), float(decal->sprite->height)) - center) * scale;
-		di.pos[3] = (alo::vf2d(float(decal->sprite->width), 0.0f) - center) * scale;
+		alo::DecalVertex* v = PushDecal(decal, 4);
+		v[0].pos = (alo::vf2d(0.0f, 0.0f) - center) * scale;
+		v[1].pos = (alo::vf2d(0.0f, float(decal->vSize.y)) - center) * scale;
+		v[2].pos = (alo::vf2d(float(decal->vSize.x), float(decal->vSize.y)) - center) * scale;
+		v[3].pos = (alo::vf2d(float(decal->vSize.x), 0.0f) - center) * scale;
+		const alo::vf2d uvtl = decal->vUVOffset, uvbr = decal->vUVOffset + decal->vUVExtent;
+		v[0].uv = { uvtl.x, uvtl.y }; v[1].uv = { uvtl.x, uvbr.y }; v[2].uv = { uvbr.x, uvbr.y }; v[3].uv = { uvbr.x, uvtl.y };
 		float c = cos(fAngle), s = sin(fAngle);
 		for (int i = 0; i < 4; i++)
 		{
-			di.pos[i] = pos + alo::vf2d(di.pos[i].x * c - di.pos[i].y * s, di.pos[i].x * s + di.pos[i].y * c);
-			di.pos[i] = di.pos[i] * vInvScreenSize * 2.0f - alo::vf2d(1.0f, 1.0f);
-			di.pos[i].y *= -1.0f;
-			di.w[i] = 1;
+			v[i].pos = pos + alo::vf2d(v[i].pos.x * c - v[i].pos.y * s, v[i].pos.x * s + v[i].pos.y * c);
+			v[i].pos = v[i].pos * vInvDecalSize * 2.0f - alo::vf2d(1.0f, 1.0f);
+			v[i].pos.y *= -1.0f;
+			v[i].tint = tint;
 		}
-		di.mode = nDecalMode;
-		di.structure = nDecalStructure;
-		vLayers[nTargetLayer].vecDecalInstance.push_back(di);
 	}
 
 
 	void GameEngine::DrawPartialRotatedDecal(const alo::vf2d& pos, alo::Decal* decal, const float fAngle, const alo::vf2d& center, const alo::vf2d& source_pos, const alo::vf2d& source_size, const alo::vf2d& scale, const alo::Pixel& tint)
 	{
-		DecalInstance di;
-		di.decal = decal;
-		di.points = 4;
-		di.tint = { tint, tint, tint, tint };
-		di.w = { 1, 1, 1, 1 };
-		di.pos.resize(4);
-		di.pos[0] = (alo::vf2d(0.0f, 0.0f) - center) * scale;
-		di.pos[1] = (alo::vf2d(0.0f, source_size.y) - center) * scale;
-		di.pos[2] = (alo::vf2d(source_size.x, source_size.y) - center) * scale;
-		di.pos[3] = (alo::vf2d(source_size.x, 0.0f) - center) * scale;
+		alo::DecalVertex* v = PushDecal(decal, 4);
+		v[0].pos = (alo::vf2d(0.0f, 0.0f) - center) * scale;
+		v[1].pos = (alo::vf2d(0.0f, source_size.y) - center) * scale;
+		v[2].pos = (alo::vf2d(source_size.x, source_size.y) - center) * scale;
+		v[3].pos = (alo::vf2d(source_size.x, 0.0f) - center) * scale;
 		float c = cos(fAngle), s = sin(fAngle);
 		for (int i = 0; i < 4; i++)
 		{
-			di.pos[i] = pos + alo::vf2d(di.pos[i].x * c - di.pos[i].y * s, di.pos[i].x * s + di.pos[i].y * c);
-			di.pos[i] = di.pos[i] * vInvScreenSize * 2.0f - alo::vf2d(1.0f, 1.0f);
-			di.pos[i].y *= -1.0f;
+			v[i].pos = pos + alo::vf2d(v[i].pos.x * c - v[i].pos.y * s, v[i].pos.x * s + v[i].pos.y * c);
+			v[i].pos = v[i].pos * vInvDecalSize * 2.0f - alo::vf2d(1.0f, 1.0f);
+			v[i].pos.y *= -1.0f;
+			v[i].tint = tint;
 		}
 
-		alo::vf2d uvtl = source_pos * decal->vUVScale;
+		alo::vf2d uvtl = decal->vUVOffset + source_pos * decal->vUVScale;
 		alo::vf2d uvbr = uvtl + (source_size * decal->vUVScale);
-		di.uv = { { uvtl.x, uvtl.y }, { uvtl.x, uvbr.y }, { uvbr.x, uvbr.y }, { uvbr.x, uvtl.y } };
-		di.mode = nDecalMode;
-		di.structure = nDecalStructure;
-		vLayers[nTargetLayer].vecDecalInstance.push_back(di);
+		v[0].uv = { uvtl.x, uvtl.y }; v[1].uv = { uvtl.x, uvbr.y }; v[2].uv = { uvbr.x, uvbr.y }; v[3].uv = { uvbr.x, uvtl.y };
 	}
 
 	void GameEngine::DrawPartialWarpedDecal(alo::Decal* decal, const alo::vf2d* pos, const alo::vf2d& source_pos, const alo::vf2d& source_size, const alo::Pixel& tint)
 	{
-		DecalInstance di;
-		di.points = 4;
-		di.decal = decal;
-		di.tint = { tint, tint, tint, tint };
-		di.w = { 1, 1, 1, 1 };
-		di.pos.resize(4);
-		di.uv = { { 0.0f, 0.0f}, {0.0f, 1.0f}, {1.0f, 1.0f}, {1.0f, 0.0f} };
 		alo::vf2d center;
 		float rd = ((pos[2].x - pos[0].x) * (pos[3].y - pos[1].y) - (pos[3].x - pos[1].x) * (pos[2].y - pos[0].y));
 		if (rd != 0)
 		{
-			alo::vf2d uvtl = source_pos * decal->vUVScale;
+			alo::vf2d uvtl = decal->vUVOffset + source_pos * decal->vUVScale;
 			alo::vf2d uvbr = uvtl + (source_size * decal->vUVScale);
-			di.uv = { { uvtl.x, uvtl.y }, { uvtl.x, uvbr.y }, { uvbr.x, uvbr.y }, { uvbr.x, uvtl.y } };
+			alo::DecalVertex* v = PushDecal(decal, 4);
+			v[0].uv = { uvtl.x, uvtl.y }; v[1].uv = { uvtl.x, uvbr.y }; v[2].uv = { uvbr.x, uvbr.y }; v[3].uv = { uvbr.x, uvtl.y };
 
 			rd = 1.0f / rd;
 			float rn = ((pos[3].x - pos[1].x) * (pos[0].y - pos[1].y) - (pos[3].y - pos[1].y) * (pos[0].x - pos[1].x)) * rd;
@@ -2447,28 +6149,23 @@ namespace alo
 			for (int i = 0; i < 4; i++)
 			{
 				float q = d[i] == 0.0f ? 1.0f : (d[i] + d[(i + 2) & 3]) / d[(i + 2) & 3];
-				di.uv[i] *= q; di.w[i] *= q;
-				di.pos[i] = { (pos[i].x * vInvScreenSize.x) * 2.0f - 1.0f, ((pos[i].y * vInvScreenSize.y) * 2.0f - 1.0f) * -1.0f };
+				v[i].uv *= q; v[i].w *= q;
+				v[i].pos = { (pos[i].x * vInvDecalSize.x) * 2.0f - 1.0f, ((pos[i].y * vInvDecalSize.y) * 2.0f - 1.0f) * -1.0f };
+				v[i].tint = tint;
 			}
-			di.mode = nDecalMode;
-			di.structure = nDecalStructure;
-			vLayers[nTargetLayer].vecDecalInstance.push_back(di);
 		}
 	}
 
 	void GameEngine::DrawWarpedDecal(alo::Decal* decal, const alo::vf2d* pos, const alo::Pixel& tint)
 	{
-		DecalInstance di;
-		di.points = 4;
-		di.decal = decal;
-		di.tint = { tint, tint, tint, tint };
-		di.w = { 1, 1, 1, 1 };
-		di.pos.resize(4);
-		di.uv = { { 0.0f, 0.0f}, {0.0f, 1.0f}, {1.0f, 1.0f}, {1.0f, 0.0f} };
 		alo::vf2d center;
 		float rd = ((pos[2].x - pos[0].x) * (pos[3].y - pos[1].y) - (pos[3].x - pos[1].x) * (pos[2].y - pos[0].y));
 		if (rd != 0)
 		{
+			const alo::vf2d uvtl = decal->vUVOffset, uvbr = decal->vUVOffset + decal->vUVExtent;
+			alo::DecalVertex* v = PushDecal(decal, 4);
+			v[0].uv = { uvtl.x, uvtl.y }; v[1].uv = { uvtl.x, uvbr.y }; v[2].uv = { uvbr.x, uvbr.y }; v[3].uv = { uvbr.x, uvtl.y };
+
 			rd = 1.0f / rd;
 			float rn = ((pos[3].x - pos[1].x) * (pos[0].y - pos[1].y) - (pos[3].y - pos[1].y) * (pos[0].x - pos[1].x)) * rd;
 			float sn = ((pos[2].x - pos[0].x) * (pos[0].y - pos[1].y) - (pos[2].y - pos[0].y) * (pos[0].x - pos[1].x)) * rd;
@@ -2477,15 +6174,28 @@ namespace alo
 			for (int i = 0; i < 4; i++)
 			{
 				float q = d[i] == 0.0f ? 1.0f : (d[i] + d[(i + 2) & 3]) / d[(i + 2) & 3];
-				di.uv[i] *= q; di.w[i] *= q;
-				di.pos[i] = { (pos[i].x * vInvScreenSize.x) * 2.0f - 1.0f, ((pos[i].y * vInvScreenSize.y) * 2.0f - 1.0f) * -1.0f };
+				v[i].uv *= q; v[i].w *= q;
+				v[i].pos = { (pos[i].x * vInvDecalSize.x) * 2.0f - 1.0f, ((pos[i].y * vInvDecalSize.y) * 2.0f - 1.0f) * -1.0f };
+				v[i].tint = tint;
 			}
-			di.mode = nDecalMode;
-			di.structure = nDecalStructure;
-			vLayers[nTargetLayer].vecDecalInstance.push_back(di);
 		}
 	}
 
+	// An axis aligned quad between corners tl and br in device coordinates,
+	// wound tl, bl, br, tr
+	void GameEngine::PushQuad(alo::Decal* decal, const alo::vf2d& tl, const alo::vf2d& br, const alo::vf2d& uvtl, const alo::vf2d& uvbr, const alo::Pixel& tint)
+	{
+		alo::DecalVertex* v = PushDecal(decal, 4);
+		v[0].pos = { tl.x, tl.y }; v[0].uv = { uvtl.x, uvtl.y };
+		v[1].pos = { tl.x, br.y }; v[1].uv = { uvtl.x, uvbr.y };
+		v[2].pos = { br.x, br.y }; v[2].uv = { uvbr.x, uvbr.y };
+		v[3].pos = { br.x, tl.y }; v[3].uv = { uvbr.x, uvtl.y };
+		for (int i = 0; i < 4; i++) v[i].tint = tint;
+	}
+
+	alo::DecalVertex* GameEngine::PushDecal(alo::Decal* decal, uint32_t nPoints)
+	{ return DecalTargetStream().Push(decal, nDecalMode, nDecalStructure, nPoints); }
+
 	void GameEngine::DrawWarpedDecal(alo::Decal* decal, const std::array<alo::vf2d, 4>& pos, const alo::Pixel& tint)
 	{ DrawWarpedDecal(decal, pos.data(), tint); }
 
@@ -2590,23 +6300,109 @@ namespace alo
 		}
 	}
 
-	alo::vi2d GameEngine::GetTextSize(const std::string& s)
+	alo::vi2d GameEngine::GetTextSize(const std::string& s)
+	{
+		alo::vi2d size = { 0,1 };
+		alo::vi2d pos = { 0,1 };
+		for (auto c : s)
+		{
+			if (c == '\n') { pos.y++;  pos.x = 0; }
+			else if (c == '\t') { pos.x += nTabSizeInSpaces; }
+			else pos.x++;
+			size.x = std::max(size.x, pos.x);
+			size.y = std::max(size.y, pos.y);
+		}
+		return size * 8;
+	}
+
+	void GameEngine::DrawString(const alo::vi2d& pos, const std::string& sText, Pixel col, uint32_t scale)
+	{ DrawString(pos.x, pos.y, sText, col, scale); }
+
+	// Screen coordinates to draw target coordinates, copied into the frame arena
+	// when the target is supersampled
+	const alo::vf2d* GameEngine::ScaledPoints(const alo::vf2d* pPoints, size_t nPoints)
+	{
+		if (nDrawScale == 1) return pPoints;
+		alo::vf2d* pScaled = frameArena.Allocate<alo::vf2d>(nPoints);
+		for (size_t i = 0; i < nPoints; i++) pScaled[i] = pPoints[i] * float(nDrawScale);
+		return pScaled;
+	}
+
+	void GameEngine::DrawPolyline(const std::vector<alo::vf2d>& points, const std::vector<Pixel>& colours)
+	{
+		if (nDrawScale > 1 && !colours.empty())
+		{
+			// Supersampled polylines are stroked one screen pixel wide. Segments of
+			// many colours extend one stroke, so every joint is blended once
+			if (colours.size() == 1) { DrawStroke(points, 1.0f, colours[0]); return; }
+			alo::Raster::Stroke stroke;
+			if (!points.empty()) ExtendStroke(stroke, points[0], 1.0f);
+			for (size_t i = 1; i < points.size(); i++)
+				ExtendStroke(stroke, points[i], 1.0f, colours[(i - 1) % colours.size()]);
+			return;
+		}
+		alo::DirtyRegion::Rect r = alo::Raster::DrawPolyline(vDrawTarget, points.data(), points.size(), colours.data(), colours.size(), CurrentPen());
+		MarkDirtyRect(r.x0, r.y0, r.x1, r.y1);
+	}
+
+	void GameEngine::DrawPolyline(const std::vector<alo::vf2d>& points, Pixel p)
 	{
-		alo::vi2d size = { 0,1 };
-		alo::vi2d pos = { 0,1 };
-		for (auto c : s)
+		if (nDrawScale > 1) { DrawStroke(points, 1.0f, p); return; }
+		alo::DirtyRegion::Rect r = alo::Raster::DrawPolyline(vDrawTarget, points.data(), points.size(), &p, 1, CurrentPen());
+		MarkDirtyRect(r.x0, r.y0, r.x1, r.y1);
+	}
+
+	void GameEngine::DrawPoints(const std::vector<alo::vi2d>& points, Pixel p)
+	{
+		if (nDrawScale > 1)
 		{
-			if (c == '\n') { pos.y++;  pos.x = 0; }
-			else if (c == '\t') { pos.x += nTabSizeInSpaces; }
-			else pos.x++;
-			size.x = std::max(size.x, pos.x);
-			size.y = std::max(size.y, pos.y);
+			for (const auto& v : points) Draw(v, p);
+			return;
 		}
-		return size * 8;
+		alo::DirtyRegion::Rect r = alo::Raster::DrawPoints(vDrawTarget, points.data(), points.size(), p, CurrentPen());
+		MarkDirtyRect(r.x0, r.y0, r.x1, r.y1);
 	}
 
-	void GameEngine::DrawString(const alo::vi2d& pos, const std::string& sText, Pixel col, uint32_t scale)
-	{ DrawString(pos.x, pos.y, sText, col, scale); }
+	void GameEngine::DrawStroke(const std::vector<alo::vf2d>& points, float fWidth, Pixel p, alo::Raster::Join join)
+	{
+		alo::FrameArena::Marker mark = frameArena.Mark();
+		alo::DirtyRegion::Rect r = alo::Raster::DrawStroke(vDrawTarget, ScaledPoints(points.data(), points.size()), points.size(),
+			fWidth * float(nDrawScale), p, join, CurrentPen());
+		frameArena.Rewind(mark);
+		MarkDirtyRect(r.x0, r.y0, r.x1, r.y1);
+	}
+
+	void GameEngine::DrawStroke(const alo::vf2d& pos1, const alo::vf2d& pos2, float fWidth, Pixel p)
+	{
+		const alo::vf2d vPoints[2] = { pos1 * float(nDrawScale), pos2 * float(nDrawScale) };
+		alo::DirtyRegion::Rect r = alo::Raster::DrawStroke(vDrawTarget, vPoints, 2, fWidth * float(nDrawScale), p, alo::Raster::Join::ROUND, CurrentPen());
+		MarkDirtyRect(r.x0, r.y0, r.x1, r.y1);
+	}
+
+	void GameEngine::ExtendStroke(alo::Raster::Stroke& stroke, const alo::vf2d& pos, float fWidth, Pixel p)
+	{
+		alo::DirtyRegion::Rect r = alo::Raster::ExtendStroke(vDrawTarget, stroke, pos * float(nDrawScale), fWidth * float(nDrawScale), p, CurrentPen());
+		MarkDirtyRect(r.x0, r.y0, r.x1, r.y1);
+	}
+
+	void GameEngine::FloodFill(const alo::vi2d& pos, Pixel p, uint8_t nTolerance)
+	{ FloodFill(pos.x, pos.y, p, nTolerance); }
+
+	void GameEngine::FloodFill(int32_t x, int32_t y, Pixel p, uint8_t nTolerance)
+	{
+		// Seeded from the middle of the screen pixel's block
+		const alo::vi2d vSeed = alo::vi2d(x, y) * nDrawScale + alo::vi2d(nDrawScale / 2, nDrawScale / 2);
+		alo::DirtyRegion::Rect r = alo::Raster::FloodFill(vDrawTarget, vSeed, p, nTolerance, CurrentPen());
+		MarkDirtyRect(r.x0, r.y0, r.x1, r.y1);
+	}
+
+	void GameEngine::FillPolygon(const std::vector<alo::vf2d>& points, Pixel p, alo::Raster::FillRule rule)
+	{
+		alo::FrameArena::Marker mark = frameArena.Mark();
+		alo::DirtyRegion::Rect r = alo::Raster::FillPolygon(vDrawTarget, ScaledPoints(points.data(), points.size()), points.size(), p, rule, CurrentPen());
+		frameArena.Rewind(mark);
+		MarkDirtyRect(r.x0, r.y0, r.x1, r.y1);
+	}
 
 	void GameEngine::DrawString(int32_t x, int32_t y, const std::string& sText, Pixel col, uint32_t scale)
 	{
@@ -2631,25 +6427,9 @@ namespace alo
 			}
 			else			
 			{
-				int32_t ox = (c - 32) % 16;
-				int32_t oy = (c - 32) / 16;
-
-				if (scale > 1)
-				{
-					for (uint32_t i = 0; i < 8; i++)
-						for (uint32_t j = 0; j < 8; j++)
-							if (fontRenderable.Sprite()->GetPixel(i + ox * 8, j + oy * 8).r > 0)
-								for (uint32_t is = 0; is < scale; is++)
-									for (uint32_t js = 0; js < scale; js++)
-										Draw(x + sx + (i * scale) + is, y + sy + (j * scale) + js, col);
-				}
-				else
-				{
-					for (uint32_t i = 0; i < 8; i++)
-						for (uint32_t j = 0; j < 8; j++)
-							if (fontRenderable.Sprite()->GetPixel(i + ox * 8, j + oy * 8).r > 0)
-								Draw(x + sx + i, y + sy + j, col);
-				}
+				uint8_t n = uint8_t(c) - 32;
+				if (n < vFontGlyphs.size())
+					DrawGlyph(x + sx, y + sy, vFontGlyphs[n], false, col, scale);
 				sx += 8 * scale;
 			}
 		}
@@ -2699,31 +6479,42 @@ namespace alo
 			}
 			else
 			{
-				int32_t ox = (c - 32) % 16;
-				int32_t oy = (c - 32) / 16;
-
-				if (scale > 1)
-				{
-					for (int32_t i = 0; i < vFontSpacing[c - 32].y; i++)
-						for (int32_t j = 0; j < 8; j++)
-							if (fontRenderable.Sprite()->GetPixel(i + ox * 8 + vFontSpacing[c - 32].x, j + oy * 8).r > 0)
-								for (int32_t is = 0; is < int(scale); is++)
-									for (int32_t js = 0; js < int(scale); js++)
-										Draw(x + sx + (i * scale) + is, y + sy + (j * scale) + js, col);
-				}
-				else
+				uint8_t n = uint8_t(c) - 32;
+				if (n < vFontGlyphs.size())
 				{
-					for (int32_t i = 0; i < vFontSpacing[c - 32].y; i++)
-						for (int32_t j = 0; j < 8; j++)
-							if (fontRenderable.Sprite()->GetPixel(i + ox * 8 + vFontSpacing[c - 32].x, j + oy * 8).r > 0)
-								Draw(x + sx + i, y + sy + j, col);
+					DrawGlyph(x + sx, y + sy, vFontGlyphs[n], true, col, scale);
+					sx += vFontGlyphs[n].width * scale;
 				}
-				sx += vFontSpacing[c - 32].y * scale;
 			}
 		}
 		SetPixelMode(m);
 	}
 
+	// Draws one baked glyph, scanning each row's bitmask for runs of lit
+	// texels and filling each run as a single span
+	void GameEngine::DrawGlyph(int32_t x, int32_t y, const FontGlyph& glyph, bool bProp, Pixel col, uint32_t scale)
+	{
+		const int32_t s = std::max(int32_t(scale), 1);
+		const int32_t w = bProp ? glyph.width : 8;
+		if (x >= GetDrawTargetWidth() || y >= GetDrawTargetHeight() || x + w * s <= 0 || y + 8 * s <= 0)
+			return;
+
+		const uint32_t keep = (1u << w) - 1;
+		for (int32_t j = 0; j < 8; j++)
+		{
+			uint32_t bits = bProp ? (uint32_t(glyph.rows[j]) >> glyph.offset) & keep : uint32_t(glyph.rows[j]);
+			int32_t i = 0;
+			while (bits)
+			{
+				while (!(bits & 1)) { bits >>= 1; i++; }
+				int32_t start = i;
+				while (bits & 1) { bits >>= 1; i++; }
+				for (int32_t js = 0; js < s; js++)
+					DrawSpan(x + start * s, x + i * s - 1, y + j * s + js, col);
+			}
+		}
+	}
+
 	void GameEngine::SetPixelMode(Pixel::Mode m)
 	{ nPixelMode = m; }
 
@@ -2736,6 +6527,15 @@ namespace alo
 		nPixelMode = Pixel::Mode::CUSTOM;
 	}
 
+	alo::Raster::Pen GameEngine::CurrentPen() const
+	{
+		alo::Raster::Pen pen;
+		pen.mode = nPixelMode;
+		pen.fBlendFactor = fBlendFactor;
+		if (nPixelMode == Pixel::CUSTOM) pen.funcPixelMode = funcPixelMode;
+		return pen;
+	}
+
 	void GameEngine::SetPixelBlend(float fBlend)
 	{
 		fBlendFactor = fBlend;
@@ -3059,6 +6859,8 @@ namespace alo
 			}
 		}
 
+		// Reads still in flight are delivered before the context goes
+		renderer->PollReadbacks(true);
 		platform->ThreadCleanUp();
 	}
 
@@ -3074,6 +6876,7 @@ namespace alo
 		CreateLayer();
 		vLayers[0].bUpdate = true;
 		vLayers[0].bShow = true;
+		if (nSupersample > 1) CreateSupersampleCanvas();
 		SetDrawTarget(nullptr);
 
 		m_tp1 = std::chrono::system_clock::now();
@@ -3092,6 +6895,8 @@ namespace alo
 		float fElapsedTime = elapsedTime.count();
 		fLastElapsed = fElapsedTime;
 
+		frameArena.Reset();
+
 		if (bConsoleSuspendTime)
 			fElapsedTime = 0.0f;
 
@@ -3155,11 +6960,48 @@ namespace alo
 		renderer->ClearBuffer(alo::BLACK, true);
 
 		// Layer 0 must always exist
-		vLayers[0].bUpdate = true;
 		vLayers[0].bShow = true;
+		if (pSupersample && !bSuspendTextureTransfer) ResolveSupersample();
 		SetDecalMode(DecalMode::NORMAL);
 		renderer->PrepareDrawing();
 
+		// Decal targets are drawn into first, so layers presenting them show
+		// this frame's work. Flushed entries are released, bar the one set
+		bool bTargets = false;
+		for (size_t i = 0; i < vDecalTargets.size(); i++)
+		{
+			DecalTargetDesc& desc = vDecalTargets[i];
+			if (desc.target == nullptr) continue;
+			if (desc.bClear || desc.decals.Count() > 0)
+			{
+				renderer->ApplyTarget(desc.target->nTarget, desc.target->vSize);
+				if (desc.bClear) renderer->ClearBuffer(desc.clear, false);
+				renderer->DrawDecals(desc.decals);
+				bTargets = true;
+			}
+			desc.decals.Clear();
+			desc.bClear = false;
+			if (nDecalTarget != int32_t(i))
+			{
+				desc.target->pTargetOwner = nullptr;
+				desc.target = nullptr;
+			}
+		}
+		for (auto& layer : vLayers)
+			if (layer.bShow && layer.funcHook == nullptr && layer.pCanvas && layer.pCanvas->nTarget != 0 && layer.decals.Count() > 0)
+			{
+				renderer->ApplyTarget(layer.pCanvas->nTarget, layer.pCanvas->vSize);
+				renderer->DrawDecals(layer.decals);
+				layer.decals.Clear();
+				bTargets = true;
+			}
+		if (bTargets)
+		{
+			renderer->ApplyTarget(0, vScreenSize);
+			renderer->UpdateViewport(vViewPos, vViewSize);
+			renderer->SetDecalMode(DecalMode::NORMAL);
+		}
+
 		for (auto layer = vLayers.rbegin(); layer != vLayers.rend(); ++layer)
 		{
 			if (layer->bShow)
@@ -3167,18 +7009,40 @@ namespace alo
 				if (layer->funcHook == nullptr)
 				{
 					renderer->ApplyTexture(layer->pDrawTarget.Decal()->id);
-					if (!bSuspendTextureTransfer && layer->bUpdate)
+					if (!bSuspendTextureTransfer)
 					{
-						layer->pDrawTarget.Decal()->Update();
+						// Glowing layers present their post-processed copy
+						alo::Sprite* pGlow = layer->nGlowRadius > 0 ? ApplyGlow(*layer) : nullptr;
+
+						// Untouched layers upload nothing
+						if (layer->bUpdate)
+						{
+							if (pGlow) renderer->UpdateTexture(layer->pDrawTarget.Decal()->id, pGlow);
+							else layer->pDrawTarget.Decal()->Update();
+						}
+						else
+							for (size_t i = 0; i < layer->dirty.Count(); i++)
+							{
+								const alo::DirtyRegion::Rect& r = layer->dirty[i];
+								if (pGlow) renderer->UpdateTexture(layer->pDrawTarget.Decal()->id, pGlow, { r.x0, r.y0 }, { r.x1 - r.x0, r.y1 - r.y0 });
+								else layer->pDrawTarget.Decal()->Update({ r.x0, r.y0 }, { r.x1 - r.x0, r.y1 - r.y0 });
+							}
 						layer->bUpdate = false;
+						layer->dirty.Clear();
 					}
 
 					renderer->DrawLayerQuad(layer->vOffset, layer->vScale, layer->tint);
 
+					// The canvas's rows run bottom up
+					if (layer->pCanvas && layer->pCanvas->nTarget != 0)
+					{
+						renderer->ApplyTexture(layer->pCanvas->id);
+						renderer->DrawLayerQuad({ layer->vOffset.x, layer->vOffset.y + layer->vScale.y }, { layer->vScale.x, -layer->vScale.y }, layer->tint);
+					}
+
 					// Display Decals in order for this layer
-					for (auto& decal : layer->vecDecalInstance)
-						renderer->DrawDecal(decal);
-					layer->vecDecalInstance.clear();
+					renderer->DrawDecals(layer->decals);
+					layer->decals.Clear();
 				}
 				else
 				{
@@ -3188,7 +7052,13 @@ namespace alo
 			}
 		}
 
-		
+		renderer->EndFrameStats();
+
+		// Screen reads queued this frame take the finished image
+		for (auto& read : vScreenReads)
+			renderer->ReadFrameAsync(vViewPos, vViewSize, std::move(read));
+		vScreenReads.clear();
+		renderer->PollReadbacks(false);
 
 		// Present Graphics to screen
 		renderer->DisplayFrame();
@@ -3257,6 +7127,23 @@ namespace alo
 
 		for (auto c : vSpacing) vFontSpacing.push_back({ c >> 4, c & 15 });
 
+		// Bake each glyph into row bitmasks, so CPU text rendering never
+		// has to read back the font sprite
+		for (size_t n = 0; n < vFontGlyphs.size(); n++)
+		{
+			int32_t ox = int32_t(n % 16) * 8;
+			int32_t oy = int32_t(n / 16) * 8;
+			for (int32_t j = 0; j < 8; j++)
+			{
+				uint8_t bits = 0;
+				for (int32_t i = 0; i < 8; i++)
+					if (fontRenderable.Sprite()->GetPixel(ox + i, oy + j).r > 0) bits |= uint8_t(1 << i);
+				vFontGlyphs[n].rows[j] = bits;
+			}
+			vFontGlyphs[n].offset = uint8_t(vSpacing[n] >> 4);
+			vFontGlyphs[n].width = uint8_t(vSpacing[n] & 15);
+		}
+
 		// UK Standard Layout
 #ifdef ALO_KEYBOARD_UK
 		vKeyboardMap =
@@ -3304,6 +7191,84 @@ namespace alo
 	alo::GameEngine* alo::GEX::ge = nullptr;
 	alo::GameEngine* alo::Platform::ptrGE = nullptr;
 	alo::GameEngine* alo::Renderer::ptrGE = nullptr;
+
+	// Fallback for renderers that can only upload whole sprites
+	void Renderer::UpdateTexture(uint32_t id, const alo::SpriteView& view)
+	{
+		alo::Sprite spr(view.width, view.height, false);
+		for (int32_t y = 0; y < view.height; y++)
+			std::memcpy(spr.GetData() + size_t(y) * view.width, view.Row(y), size_t(view.width) * sizeof(alo::Pixel));
+		UpdateTexture(id, &spr);
+	}
+
+	void Renderer::DrawDecals(const alo::DecalStream& decals)
+	{
+		for (const auto& decal : decals)
+		{
+			if (decal.instances > 0)
+			{
+				DrawInstances(decal, decals.Instances(decal));
+				stats.nDecals += decal.instances;
+				stats.nDrawCalls += decal.instances;
+				stats.nVertices += decal.instances * 4;
+				continue;
+			}
+			DrawDecal(decal, decals.Vertices(decal), decals.Indices(decal));
+			stats.nDecals++;
+			stats.nDrawCalls++;
+			stats.nVertices += decal.points;
+		}
+	}
+
+	void Renderer::DrawInstances(const alo::DecalInstance& decal, const alo::QuadInstance* pInstances)
+	{
+		alo::DecalInstance quad = decal;
+		quad.structure = alo::DecalStructure::FAN;
+		quad.points = 4;
+		quad.instances = 0;
+		alo::DecalVertex v[4];
+		for (uint32_t i = 0; i < decal.instances; i++)
+		{
+			const alo::QuadInstance& q = pInstances[i];
+			v[0].pos = q.pos; v[0].uv = q.uv;
+			v[1].pos = q.pos + q.axisY; v[1].uv = { q.uv.x, q.uv.y + q.uvSize.y };
+			v[2].pos = q.pos + q.axisX + q.axisY; v[2].uv = q.uv + q.uvSize;
+			v[3].pos = q.pos + q.axisX; v[3].uv = { q.uv.x + q.uvSize.x, q.uv.y };
+			for (auto& p : v) p.tint = q.tint;
+			DrawDecal(quad, v, nullptr);
+		}
+	}
+
+	void Renderer::UpdateTexture(uint32_t id, alo::Sprite* spr, const alo::vi2d& pos, const alo::vi2d& size)
+	{
+		UNUSED(pos); UNUSED(size);
+		UpdateTexture(id, spr);
+	}
+
+	void Renderer::UpdateTexture(uint32_t id, alo::PixelFormat format, const void* data, int32_t w, int32_t h, int32_t stride)
+	{
+		alo::Sprite spr(w, h, false);
+		for (int32_t y = 0; y < h; y++)
+		{
+			alo::Pixel* dst = spr.GetData() + size_t(y) * w;
+			switch (format)
+			{
+			case alo::PixelFormat::R8: alo::PixelFormatTraits<alo::PixelFormat::R8>::UnpackRow((const uint8_t*)data + size_t(y) * stride, dst, w); break;
+			case alo::PixelFormat::RG8: alo::PixelFormatTraits<alo::PixelFormat::RG8>::UnpackRow((const alo::PixelFormatTraits<alo::PixelFormat::RG8>::type*)data + size_t(y) * stride, dst, w); break;
+			case alo::PixelFormat::RGB565: alo::PixelFormatTraits<alo::PixelFormat::RGB565>::UnpackRow((const uint16_t*)data + size_t(y) * stride, dst, w); break;
+			case alo::PixelFormat::RGBA8: alo::PixelFormatTraits<alo::PixelFormat::RGBA8>::UnpackRow((const alo::Pixel*)data + size_t(y) * stride, dst, w); break;
+			case alo::PixelFormat::R32F: alo::PixelFormatTraits<alo::PixelFormat::R32F>::UnpackRow((const float*)data + size_t(y) * stride, dst, w); break;
+			}
+		}
+		UpdateTexture(id, &spr);
+	}
+
+	void Renderer::ReadFrameAsync(const alo::vi2d& pos, const alo::vi2d& size, std::function<void(alo::Sprite&)> callback)
+	{
+		alo::Sprite spr(size.x, size.y, false);
+		if (ReadFrame(pos, size, &spr))
+			callback(spr);
+	}
 	std::unique_ptr<ImageLoader> alo::Sprite::loader = nullptr;
 };
 #pragma endregion 
@@ -3358,6 +7323,7 @@ namespace alo
 		bool bSync = false;
 		alo::DecalMode nDecalMode = alo::DecalMode(-1);
 		alo::DecalStructure nDecalStructure = alo::DecalStructure(-1);
+		std::vector<uint32_t> vUnrolled;
 #if defined(ALO_PLATFORM_X11)
 		X11::Display* alo_Display = nullptr;
 		X11::Window* alo_Window = nullptr;
@@ -3543,7 +7509,7 @@ namespace alo
 			glEnd();
 		}
 
-		void DrawDecal(const alo::DecalInstance& decal) override
+		void DrawDecal(const alo::DecalInstance& decal, const alo::DecalVertex* pVertices, const uint32_t* pIndices) override
 		{
 			SetDecalMode(decal.mode);
 
@@ -3579,9 +7545,10 @@ namespace alo
 				// Render as 3D Spatial Entity
 				for (uint32_t n = 0; n < decal.points; n++)
 				{
-					glColor4ub(decal.tint[n].r, decal.tint[n].g, decal.tint[n].b, decal.tint[n].a);
-					glTexCoord2f(decal.uv[n].x, decal.uv[n].y);
-					glVertex3f(decal.pos[n].x, decal.pos[n].y, decal.w[n]);
+					const alo::DecalVertex& v = pVertices[n];
+					glColor4ub(v.tint.r, v.tint.g, v.tint.b, v.tint.a);
+					glTexCoord2f(v.uv.x, v.uv.y);
+					glVertex3f(v.pos.x, v.pos.y, v.w);
 				}
 
 				glEnd();
@@ -3593,24 +7560,18 @@ namespace alo
 			}
 			else
 			{
-				if (nDecalMode == DecalMode::WIREFRAME)
-					glBegin(GL_LINE_LOOP);
-				else
-				{
-					if(decal.structure == alo::DecalStructure::FAN)
-						glBegin(GL_TRIANGLE_FAN);
-					else if(decal.structure == alo::DecalStructure::STRIP)
-						glBegin(GL_TRIANGLE_STRIP);
-					else if(decal.structure == alo::DecalStructure::LIST)
-						glBegin(GL_TRIANGLES);
-				}
+				// Every structure is drawn as the triangles, or lines, it unrolls to
+				vUnrolled.clear();
+				alo::UnrollDecal(decal, pIndices, 0, vUnrolled);
+				glBegin(alo::DecalIsLines(decal) ? GL_LINES : GL_TRIANGLES);
 
 				// Render as 2D Spatial entity
-				for (uint32_t n = 0; n < decal.points; n++)
+				for (uint32_t n : vUnrolled)
 				{
-					glColor4ub(decal.tint[n].r, decal.tint[n].g, decal.tint[n].b, decal.tint[n].a);
-					glTexCoord4f(decal.uv[n].x, decal.uv[n].y, 0.0f, decal.w[n]);
-					glVertex2f(decal.pos[n].x, decal.pos[n].y);
+					const alo::DecalVertex& v = pVertices[n];
+					glColor4ub(v.tint.r, v.tint.g, v.tint.b, v.tint.a);
+					glTexCoord4f(v.uv.x, v.uv.y, 0.0f, v.w);
+					glVertex2f(v.pos.x, v.pos.y);
 				}
 
 				glEnd();
@@ -3665,11 +7626,55 @@ namespace alo
 			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, spr->width, spr->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, spr->GetData());
 		}
 
+		void UpdateTexture(uint32_t id, const alo::SpriteView& view) override
+		{
+			UNUSED(id);
+			glPixelStorei(GL_UNPACK_ROW_LENGTH, view.stride);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, view.width, view.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, view.data);
+			glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+		}
+
+		void UpdateTexture(uint32_t id, alo::Sprite* spr, const alo::vi2d& pos, const alo::vi2d& size) override
+		{
+			UNUSED(id);
+			glPixelStorei(GL_UNPACK_ROW_LENGTH, spr->width);
+			glTexSubImage2D(GL_TEXTURE_2D, 0, pos.x, pos.y, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, spr->GetData() + size_t(pos.y) * spr->width + pos.x);
+			glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+		}
+
+		void UpdateTexture(uint32_t id, alo::PixelFormat format, const void* data, int32_t w, int32_t h, int32_t stride) override
+		{
+			// No two channel colour format, or float textures, in GL 1.x
+			GLint nInternal = GL_RGBA; GLenum nFormat = GL_RGBA, nType = GL_UNSIGNED_BYTE;
+			switch (format)
+			{
+			case alo::PixelFormat::R8: nInternal = GL_LUMINANCE8; nFormat = GL_LUMINANCE; break;
+			case alo::PixelFormat::RGB565: nInternal = GL_RGB5; nFormat = GL_RGB; nType = 0x8363; break; // GL_UNSIGNED_SHORT_5_6_5
+			case alo::PixelFormat::R32F: nInternal = GL_LUMINANCE16; nFormat = GL_LUMINANCE; nType = GL_FLOAT; break;
+			case alo::PixelFormat::RGBA8: break;
+			default: Renderer::UpdateTexture(id, format, data, w, h, stride); return;
+			}
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			glPixelStorei(GL_UNPACK_ROW_LENGTH, stride);
+			glTexImage2D(GL_TEXTURE_2D, 0, nInternal, w, h, 0, nFormat, nType, data);
+			glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		}
+
 		void ReadTexture(uint32_t id, alo::Sprite* spr) override
 		{
 			glReadPixels(0, 0, spr->width, spr->height, GL_RGBA, GL_UNSIGNED_BYTE, spr->GetData());
 		}
 
+		bool ReadFrame(const alo::vi2d& pos, const alo::vi2d& size, alo::Sprite* spr) override
+		{
+			// glReadPixels gives the bottom row first
+			glReadPixels(pos.x, pos.y, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, spr->GetData());
+			for (int32_t y = 0; y < size.y / 2; y++)
+				std::swap_ranges(spr->GetData() + size_t(y) * size.x, spr->GetData() + size_t(y + 1) * size.x, spr->GetData() + size_t(size.y - 1 - y) * size.x);
+			return true;
+		}
+
 		void ApplyTexture(uint32_t id) override
 		{
 			glBindTexture(GL_TEXTURE_2D, id);
@@ -3744,14 +7749,28 @@ namespace alo
 	typedef void CALLSTYLE locBindBuffer_t(GLenum target, GLuint buffer);
 	typedef void CALLSTYLE locBufferData_t(GLenum target, GLsizeiptr size, const void* data, GLenum usage);
 	typedef void CALLSTYLE locGenBuffers_t(GLsizei n, GLuint* buffers);
+	typedef void CALLSTYLE locDeleteBuffers_t(GLsizei n, const GLuint* buffers);
+	typedef void CALLSTYLE locGenFramebuffers_t(GLsizei n, GLuint* framebuffers);
+	typedef void CALLSTYLE locDeleteFramebuffers_t(GLsizei n, const GLuint* framebuffers);
+	typedef void CALLSTYLE locBindFramebuffer_t(GLenum target, GLuint framebuffer);
+	typedef void CALLSTYLE locFramebufferTexture2D_t(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level);
 	typedef void CALLSTYLE locVertexAttribPointer_t(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer);
 	typedef void CALLSTYLE locEnableVertexAttribArray_t(GLuint index);
 	typedef void CALLSTYLE locUseProgram_t(GLuint program);
 	typedef void CALLSTYLE locBindVertexArray_t(GLuint array);
 	typedef void CALLSTYLE locGenVertexArrays_t(GLsizei n, GLuint* arrays);
 	typedef void CALLSTYLE locGetShaderInfoLog_t(GLuint shader, GLsizei bufSize, GLsizei* length, GLchar* infoLog);
-
-	constexpr size_t ALO_MAX_VERTS = 128;
+	typedef void* CALLSTYLE locMapBufferRange_t(GLenum target, ptrdiff_t offset, GLsizeiptr length, GLbitfield access);
+	typedef GLboolean CALLSTYLE locUnmapBuffer_t(GLenum target);
+	typedef void* CALLSTYLE locFenceSync_t(GLenum condition, GLbitfield flags);
+	typedef GLenum CALLSTYLE locClientWaitSync_t(void* sync, GLbitfield flags, uint64_t timeout);
+	typedef void CALLSTYLE locDeleteSync_t(void* sync);
+	typedef void CALLSTYLE locVertexAttribDivisor_t(GLuint index, GLuint divisor);
+	typedef void CALLSTYLE locDrawArraysInstanced_t(GLenum mode, GLint first, GLsizei count, GLsizei instancecount);
+	typedef void CALLSTYLE locDrawElementsBaseVertex_t(GLenum mode, GLsizei count, GLenum type, const void* indices, GLint basevertex);
+
+	// Initial size of the streamed vertex ring, the index ring being half this
+	constexpr size_t ALO_STREAM_BYTES = size_t(4) << 20;
 
 	class Renderer_OGL33 : public alo::Renderer
 	{
@@ -3780,6 +7799,11 @@ namespace alo
 		locBindBuffer_t* locBindBuffer = nullptr;
 		locBufferData_t* locBufferData = nullptr;
 		locGenBuffers_t* locGenBuffers = nullptr;
+		locDeleteBuffers_t* locDeleteBuffers = nullptr;
+		locGenFramebuffers_t* locGenFramebuffers = nullptr;
+		locDeleteFramebuffers_t* locDeleteFramebuffers = nullptr;
+		locBindFramebuffer_t* locBindFramebuffer = nullptr;
+		locFramebufferTexture2D_t* locFramebufferTexture2D = nullptr;
 		locVertexAttribPointer_t* locVertexAttribPointer = nullptr;
 		locEnableVertexAttribArray_t* locEnableVertexAttribArray = nullptr;
 		locUseProgram_t* locUseProgram = nullptr;
@@ -3787,12 +7811,64 @@ namespace alo
 		locGenVertexArrays_t* locGenVertexArrays = nullptr;
 		locSwapInterval_t* locSwapInterval = nullptr;
 		locGetShaderInfoLog_t* locGetShaderInfoLog = nullptr;
+		locMapBufferRange_t* locMapBufferRange = nullptr;
+		locUnmapBuffer_t* locUnmapBuffer = nullptr;
+		locFenceSync_t* locFenceSync = nullptr;
+		locClientWaitSync_t* locClientWaitSync = nullptr;
+		locDeleteSync_t* locDeleteSync = nullptr;
+		locVertexAttribDivisor_t* locVertexAttribDivisor = nullptr;
+		locDrawArraysInstanced_t* locDrawArraysInstanced = nullptr;
+		locDrawElementsBaseVertex_t* locDrawElementsBaseVertex = nullptr;
 
 		uint32_t m_nFS = 0;
 		uint32_t m_nVS = 0;
 		uint32_t m_nQuadShader = 0;
 		uint32_t m_vbQuad = 0;
 		uint32_t m_vaQuad = 0;
+		uint32_t m_ibQuad = 0;
+
+		// Instanced quads are corners of the unit square, placed by per instance
+		// attributes that point into the instance ring
+		uint32_t m_nInstanceVS = 0;
+		uint32_t m_nInstanceShader = 0;
+		uint32_t m_vbCorners = 0;
+		uint32_t m_vbInstances = 0;
+		uint32_t m_pbPixels = 0;
+		uint32_t m_vaInstance = 0;
+
+		// Streamed geometry is written unsynchronised into a ring split in quarters.
+		// Leaving a quarter fences it and entering one waits on its fence, so
+		// regions still read by draws in flight are never overwritten. The ring is
+		// never orphaned, so a decal chunked into many quarter sized writes goes
+		// round it waiting on each quarter's fence in turn, and from its second lap
+		// on each write waits for the draw of four writes before to finish
+		struct StreamRing
+		{
+			GLenum target = 0;
+			uint32_t buffer = 0;
+			size_t nSize = 0;
+			size_t nHead = 0;
+			size_t nQuarter = 0;
+			void* pFence[4] = { nullptr };
+		};
+		StreamRing ringVertices;
+		StreamRing ringIndices;
+		StreamRing ringInstances;
+		StreamRing ringPixels;
+
+		// A frame read into a pack buffer, delivered once its fence signals
+		struct Readback
+		{
+			uint32_t buffer;
+			void* pFence;
+			alo::vi2d size;
+			std::function<void(alo::Sprite&)> callback;
+		};
+		std::vector<Readback> vReadbacks;
+		std::vector<uint32_t> vIdleReadBuffers;
+
+		std::vector<uint32_t> vUnrolled;
+		std::vector<alo::DecalVertex> vGathered;
 
 		struct locVertex
 		{
@@ -3800,11 +7876,114 @@ namespace alo
 			alo::vf2d tex;
 			alo::Pixel col;
 		};
-
-		locVertex pVertexMem[OLC_MAX_VERTS];
+		static_assert(sizeof(locVertex) == sizeof(alo::DecalVertex), "decal streams upload as locVertex");
 
 		alo::Renderable rendBlankQuad;
 
+	private:
+		void CreateRing(StreamRing& ring, GLenum target, uint32_t buffer, size_t nSize)
+		{
+			for (auto& fence : ring.pFence)
+				if (fence != nullptr) { locDeleteSync(fence); fence = nullptr; }
+
+			ring.target = target;
+			ring.buffer = buffer;
+			ring.nSize = nSize;
+			ring.nHead = 0;
+			ring.nQuarter = 0;
+			locBindBuffer(target, buffer);
+			locBufferData(target, GLsizeiptr(nSize), nullptr, 0x88E0);
+		}
+
+		// Largest write Stream takes at nAlign, callers split anything bigger
+		static size_t StreamCapacity(const StreamRing& ring, size_t nAlign)
+		{ return ring.nSize / 4 - nAlign; }
+
+		// Maps nBytes of the ring at the next multiple of nAlign for writing, setting
+		// nOffset to where they start. The ring must be unmapped before drawing
+		void* Map(StreamRing& ring, size_t nBytes, size_t nAlign, size_t& nOffset)
+		{
+			const size_t nQuarterSize = ring.nSize / 4;
+
+			// Writes never straddle quarters, so a quarter's fence, placed as the
+			// ring moves on, follows every draw that reads it
+			nOffset = (ring.nHead + nAlign - 1) / nAlign * nAlign;
+			if (nOffset + nBytes > (ring.nQuarter + 1) * nQuarterSize)
+			{
+				ring.pFence[ring.nQuarter] = locFenceSync(0x9117, 0); // GL_SYNC_GPU_COMMANDS_COMPLETE
+				ring.nQuarter = (ring.nQuarter + 1) % 4;
+
+				void*& fence = ring.pFence[ring.nQuarter];
+				if (fence != nullptr)
+				{
+					// Flushing so the fence is sure to signal, then wait out timeouts
+					while (locClientWaitSync(fence, 0x1, 1000000000) == 0x911B);
+					locDeleteSync(fence);
+					fence = nullptr;
+				}
+				nOffset = (ring.nQuarter * nQuarterSize + nAlign - 1) / nAlign * nAlign;
+			}
+
+			// GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT
+			locBindBuffer(ring.target, ring.buffer);
+			ring.nHead = nOffset + nBytes;
+			return locMapBufferRange(ring.target, ptrdiff_t(nOffset), GLsizeiptr(nBytes), 0x0002 | 0x0004 | 0x0020);
+		}
+
+		// Copies nBytes into the ring at the next multiple of nAlign, returning the offset
+		size_t Stream(StreamRing& ring, const void* pData, size_t nBytes, size_t nAlign)
+		{
+			if (nBytes == 0)
+				return 0;
+
+			size_t nOffset = 0;
+			std::memcpy(Map(ring, nBytes, nAlign, nOffset), pData, nBytes);
+			locUnmapBuffer(ring.target);
+			return nOffset;
+		}
+
+		// Single channel textures are swizzled to grey so they look the same as on
+		// GL 1.x. The swizzle belongs to the texture, so every full upload sets it
+		void SetSwizzle(alo::PixelFormat format)
+		{
+			GLint nSwizzle[4] = { GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA };
+			if (format == alo::PixelFormat::R8 || format == alo::PixelFormat::R32F)
+				nSwizzle[1] = nSwizzle[2] = GL_RED;
+			glTexParameteriv(GL_TEXTURE_2D, 0x8E46, nSwizzle); // GL_TEXTURE_SWIZZLE_RGBA
+		}
+
+		// Copies nRows rows of nRowBytes, nStride bytes apart, into the pixel ring
+		// and leaves it bound for unpacking, returning the offset to pass as the
+		// texture call's data. That call then returns at once, the driver copying
+		// out of the ring while the engine draws the next frame, and the fences
+		// keep four uploads in flight before one is overwritten
+		size_t StagePixels(const void* pData, size_t nRowBytes, size_t nRows, size_t nStride)
+		{
+			const size_t nBytes = nRowBytes * nRows;
+			if (nBytes + sizeof(uint32_t) > ringPixels.nSize / 4)
+			{
+				// Uploads are consumed as they are issued, so orphaning for a
+				// bigger ring leaves nothing pointing into the old storage
+				size_t nSize = ringPixels.nSize;
+				while (nBytes + sizeof(uint32_t) > nSize / 4) nSize *= 2;
+				CreateRing(ringPixels, 0x88EC, m_pbPixels, nSize);
+			}
+
+			size_t nOffset = 0;
+			locBindBuffer(0x88EC, m_pbPixels); // GL_PIXEL_UNPACK_BUFFER
+			if (nBytes == 0)
+				return nOffset;
+			uint8_t* pMapped = (uint8_t*)Map(ringPixels, nBytes, sizeof(uint32_t), nOffset);
+			const uint8_t* pRows = (const uint8_t*)pData;
+			if (nStride == nRowBytes)
+				std::memcpy(pMapped, pRows, nBytes);
+			else
+				for (size_t y = 0; y < nRows; y++)
+					std::memcpy(pMapped + y * nRowBytes, pRows + y * nStride, nRowBytes);
+			locUnmapBuffer(0x88EC);
+			return nOffset;
+		}
+
 	public:
 		void PrepareDevice() override
 		{
@@ -3916,10 +8095,25 @@ namespace alo
 			locBindBuffer = OGL_LOAD(locBindBuffer_t, glBindBuffer);
 			locBufferData = OGL_LOAD(locBufferData_t, glBufferData);
 			locGenBuffers = OGL_LOAD(locGenBuffers_t, glGenBuffers);
+			locDeleteBuffers = OGL_LOAD(locDeleteBuffers_t, glDeleteBuffers);
+			locGenFramebuffers = OGL_LOAD(locGenFramebuffers_t, glGenFramebuffers);
+			locDeleteFramebuffers = OGL_LOAD(locDeleteFramebuffers_t, glDeleteFramebuffers);
+			locBindFramebuffer = OGL_LOAD(locBindFramebuffer_t, glBindFramebuffer);
+			locFramebufferTexture2D = OGL_LOAD(locFramebufferTexture2D_t, glFramebufferTexture2D);
 			locVertexAttribPointer = OGL_LOAD(locVertexAttribPointer_t, glVertexAttribPointer);
 			locEnableVertexAttribArray = OGL_LOAD(locEnableVertexAttribArray_t, glEnableVertexAttribArray);
 			locUseProgram = OGL_LOAD(locUseProgram_t, glUseProgram);
 			locGetShaderInfoLog = OGL_LOAD(locGetShaderInfoLog_t, glGetShaderInfoLog);
+			locBindVertexArray = OGL_LOAD(locBindVertexArray_t, glBindVertexArray);
+			locGenVertexArrays = OGL_LOAD(locGenVertexArrays_t, glGenVertexArrays);
+			locMapBufferRange = OGL_LOAD(locMapBufferRange_t, glMapBufferRange);
+			locUnmapBuffer = OGL_LOAD(locUnmapBuffer_t, glUnmapBuffer);
+			locFenceSync = OGL_LOAD(locFenceSync_t, glFenceSync);
+			locClientWaitSync = OGL_LOAD(locClientWaitSync_t, glClientWaitSync);
+			locDeleteSync = OGL_LOAD(locDeleteSync_t, glDeleteSync);
+			locVertexAttribDivisor = OGL_LOAD(locVertexAttribDivisor_t, glVertexAttribDivisor);
+			locDrawArraysInstanced = OGL_LOAD(locDrawArraysInstanced_t, glDrawArraysInstanced);
+			locDrawElementsBaseVertex = OGL_LOAD(locDrawElementsBaseVertex_t, glDrawElementsBaseVertex);
 
 			// Load & Compile Quad Shader - assumes no errors
 			m_nFS = locCreateShader(0x8B30);
@@ -3949,15 +8143,55 @@ namespace alo
 			locGenVertexArrays(1, &m_vaQuad);
 			locBindVertexArray(m_vaQuad);
 			locBindBuffer(0x8892, m_vbQuad);
-
-			locVertex verts[OLC_MAX_VERTS];
-			locBufferData(0x8892, sizeof(locVertex) * OLC_MAX_VERTS, verts, 0x88E0);
+			CreateRing(ringVertices, 0x8892, m_vbQuad, ALO_STREAM_BYTES);
 			locVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(locVertex), 0); locEnableVertexAttribArray(0);
 			locVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(locVertex), (void*)(3 * sizeof(float))); locEnableVertexAttribArray(1);
 			locVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(locVertex), (void*)(5 * sizeof(float)));	locEnableVertexAttribArray(2);
+
+			// Batched decals draw indexed, the element buffer belonging to the VAO
+			locGenBuffers(1, &m_ibQuad);
+			locBindBuffer(0x8893, m_ibQuad);
+			CreateRing(ringIndices, 0x8893, m_ibQuad, ALO_STREAM_BYTES / 2);
+			locBindBuffer(0x8892, 0);
+			locBindVertexArray(0);
+
+			// Instanced quad shader shares the fragment shader
+			m_nInstanceVS = locCreateShader(0x8B31);
+			const GLchar* strInstanceVS =
+
+				"layout(location = 0) in vec2 aCorner;\n""layout(location = 3) in vec2 iPos;\n"
+				"layout(location = 4) in vec2 iAxisX;\n""layout(location = 5) in vec2 iAxisY;\n"
+				"layout(location = 6) in vec2 iTex;\n""layout(location = 7) in vec2 iTexSize;\n"
+				"layout(location = 8) in vec4 iCol;\n""out vec2 oTex;\n""out vec4 oCol;\n"
+				"void main(){ gl_Position = vec4(iPos + aCorner.x * iAxisX + aCorner.y * iAxisY, 0.0, 1.0); oTex = iTex + aCorner * iTexSize; oCol = iCol;}";
+			locShaderSource(m_nInstanceVS, 1, &strInstanceVS, NULL);
+			locCompileShader(m_nInstanceVS);
+
+			m_nInstanceShader = locCreateProgram();
+			locAttachShader(m_nInstanceShader, m_nFS);
+			locAttachShader(m_nInstanceShader, m_nInstanceVS);
+			locLinkProgram(m_nInstanceShader);
+
+			// Corners as a strip for filled quads, then as a loop for wireframe
+			const float fCorners[16] = { 0, 0, 0, 1, 1, 0, 1, 1,  0, 0, 0, 1, 1, 1, 1, 0 };
+			locGenBuffers(1, &m_vbCorners);
+			locGenVertexArrays(1, &m_vaInstance);
+			locBindVertexArray(m_vaInstance);
+			locBindBuffer(0x8892, m_vbCorners);
+			locBufferData(0x8892, sizeof(fCorners), fCorners, 0x88E4);
+			locVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), 0); locEnableVertexAttribArray(0);
+			for (GLuint i = 3; i <= 8; i++) { locEnableVertexAttribArray(i); locVertexAttribDivisor(i, 1); }
+			locGenBuffers(1, &m_vbInstances);
+			CreateRing(ringInstances, 0x8892, m_vbInstances, ALO_STREAM_BYTES);
 			locBindBuffer(0x8892, 0);
 			locBindVertexArray(0);
 
+			// Texture uploads are staged through a ring of pixel buffers, grown to
+			// four of the largest upload seen
+			locGenBuffers(1, &m_pbPixels);
+			CreateRing(ringPixels, 0x88EC, m_pbPixels, ALO_STREAM_BYTES * 4);
+			locBindBuffer(0x88EC, 0);
+
 			// Create blank texture for spriteless decals
 			rendBlankQuad.Create(1, 1);
 			rendBlankQuad.Sprite()->GetData()[0] = alo::WHITE;
@@ -3967,6 +8201,17 @@ namespace alo
 
 		alo::rcode DestroyDevice() override
 		{
+			// Reads still in flight are dropped, their callbacks never run
+			for (auto& read : vReadbacks)
+			{
+				locDeleteSync(read.pFence);
+				vIdleReadBuffers.push_back(read.buffer);
+			}
+			vReadbacks.clear();
+			if (!vIdleReadBuffers.empty())
+				locDeleteBuffers(GLsizei(vIdleReadBuffers.size()), vIdleReadBuffers.data());
+			vIdleReadBuffers.clear();
+
 #if defined(ALO_PLATFORM_WINAPI)
 			wglDeleteContext(glRenderContext);
 #endif
@@ -4029,7 +8274,6 @@ namespace alo
 
 		void DrawLayerQuad(const alo::vf2d& offset, const alo::vf2d& scale, const alo::Pixel tint) override
 		{
-			locBindBuffer(0x8892, m_vbQuad);
 			locVertex verts[4] = {
 				{{-1.0f, -1.0f, 1.0}, {0.0f * scale.x + offset.x, 1.0f * scale.y + offset.y}, tint},
 				{{+1.0f, -1.0f, 1.0}, {1.0f * scale.x + offset.x, 1.0f * scale.y + offset.y}, tint},
@@ -4037,29 +8281,135 @@ namespace alo
 				{{+1.0f, +1.0f, 1.0}, {1.0f * scale.x + offset.x, 0.0f * scale.y + offset.y}, tint},
 			};
 
-			locBufferData(0x8892, sizeof(locVertex) * 4, verts, 0x88E0);
-			glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+			const size_t nFirst = Stream(ringVertices, verts, sizeof(verts), sizeof(locVertex)) / sizeof(locVertex);
+			glDrawArrays(GL_TRIANGLE_STRIP, GLint(nFirst), 4);
+		}
+
+		uint32_t TextureOf(const alo::DecalInstance& decal) const
+		{ return decal.decal == nullptr ? rendBlankQuad.Decal()->id : decal.decal->id; }
+
+		size_t MaxStreamVertices() const { return StreamCapacity(ringVertices, sizeof(locVertex)) / sizeof(locVertex); }
+		size_t MaxStreamIndices() const { return StreamCapacity(ringIndices, sizeof(uint32_t)) / sizeof(uint32_t); }
+
+		// Draws a decal too big for one ring write from vUnrolled, its primitives
+		// relative to pVertices, a ring's worth of whole primitives at a time with
+		// each chunk's vertices gathered in order. Returns the draw calls made
+		uint32_t DrawChunked(const alo::DecalInstance& decal, const alo::DecalVertex* pVertices, const std::vector<uint32_t>& vUnrolled)
+		{
+			const bool bLines = alo::DecalIsLines(decal);
+			return alo::ChunkDecal(decal, vUnrolled.size(), MaxStreamVertices(), [&](size_t i, size_t n)
+			{
+				vGathered.resize(n);
+				for (size_t k = 0; k < n; k++)
+					vGathered[k] = pVertices[vUnrolled[i + k]];
+				const size_t nFirst = Stream(ringVertices, vGathered.data(), sizeof(alo::DecalVertex) * n, sizeof(locVertex)) / sizeof(locVertex);
+				glDrawArrays(bLines ? GL_LINES : GL_TRIANGLES, GLint(nFirst), GLsizei(n));
+			});
 		}
 
-		void DrawDecal(const alo::DecalInstance& decal) override
+		void DrawDecal(const alo::DecalInstance& decal, const alo::DecalVertex* pVertices, const uint32_t* pIndices) override
 		{
 			SetDecalMode(decal.mode);
-			if (decal.decal == nullptr)
-				glBindTexture(GL_TEXTURE_2D, rendBlankQuad.Decal()->id);
-			else
-				glBindTexture(GL_TEXTURE_2D, decal.decal->id);
+			glBindTexture(GL_TEXTURE_2D, TextureOf(decal));
 
-			locBindBuffer(0x8892, m_vbQuad);
+			vUnrolled.clear();
+			alo::UnrollDecal(decal, pIndices, 0, vUnrolled);
+			if (vUnrolled.empty())
+				return;
+			if (decal.points > MaxStreamVertices() || vUnrolled.size() > MaxStreamIndices())
+			{
+				DrawChunked(decal, pVertices, vUnrolled);
+				return;
+			}
+
+			// The layer's stream is already in locVertex layout
+			const size_t nBase = Stream(ringVertices, pVertices, sizeof(alo::DecalVertex) * decal.points, sizeof(locVertex)) / sizeof(locVertex);
+			const size_t nIndexOffset = Stream(ringIndices, vUnrolled.data(), sizeof(uint32_t) * vUnrolled.size(), sizeof(uint32_t));
+			locDrawElementsBaseVertex(alo::DecalIsLines(decal) ? GL_LINES : GL_TRIANGLES, GLsizei(vUnrolled.size()), GL_UNSIGNED_INT, (const void*)nIndexOffset, GLint(nBase));
+		}
+
+		void DrawInstances(const alo::DecalInstance& decal, const alo::QuadInstance* pInstances) override
+		{
+			SetDecalMode(decal.mode);
+			glBindTexture(GL_TEXTURE_2D, TextureOf(decal));
+			DrawInstancedQuads(pInstances, decal.instances);
+		}
 
-			for (uint32_t i = 0; i < decal.points; i++)
-				pVertexMem[i] = { { decal.pos[i].x, decal.pos[i].y, decal.w[i] }, { decal.uv[i].x, decal.uv[i].y }, decal.tint[i] };
+		// Streams the instances and draws them, as many calls as the ring needs
+		uint32_t DrawInstancedQuads(const alo::QuadInstance* pInstances, size_t nInstances)
+		{
+			const size_t nChunk = StreamCapacity(ringInstances, sizeof(float)) / sizeof(alo::QuadInstance);
+			uint32_t nDraws = 0;
+			locUseProgram(m_nInstanceShader);
+			locBindVertexArray(m_vaInstance);
+			for (size_t i = 0; i < nInstances; i += nChunk)
+			{
+				// Instance attributes start at the chunk's place in the ring
+				const size_t n = std::min(nChunk, nInstances - i);
+				const size_t nOffset = Stream(ringInstances, pInstances + i, sizeof(alo::QuadInstance) * n, sizeof(float));
+				const GLsizei nStride = sizeof(alo::QuadInstance);
+				locBindBuffer(0x8892, ringInstances.buffer);
+				locVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, nStride, (const void*)(nOffset + offsetof(alo::QuadInstance, pos)));
+				locVertexAttribPointer(4, 2, GL_FLOAT, GL_FALSE, nStride, (const void*)(nOffset + offsetof(alo::QuadInstance, axisX)));
+				locVertexAttribPointer(5, 2, GL_FLOAT, GL_FALSE, nStride, (const void*)(nOffset + offsetof(alo::QuadInstance, axisY)));
+				locVertexAttribPointer(6, 2, GL_FLOAT, GL_FALSE, nStride, (const void*)(nOffset + offsetof(alo::QuadInstance, uv)));
+				locVertexAttribPointer(7, 2, GL_FLOAT, GL_FALSE, nStride, (const void*)(nOffset + offsetof(alo::QuadInstance, uvSize)));
+				locVertexAttribPointer(8, 4, GL_UNSIGNED_BYTE, GL_TRUE, nStride, (const void*)(nOffset + offsetof(alo::QuadInstance, tint)));
+
+				if (nDecalMode == alo::DecalMode::WIREFRAME)
+					locDrawArraysInstanced(GL_LINE_LOOP, 4, 4, GLsizei(n));
+				else
+					locDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, GLsizei(n));
+				nDraws++;
+			}
+			locUseProgram(m_nQuadShader);
+			locBindVertexArray(m_vaQuad);
+			return nDraws;
+		}
 
-			locBufferData(0x8892, sizeof(locVertex) * decal.points, pVertexMem, 0x88E0);
+		void DrawDecals(const alo::DecalStream& decals) override
+		{
+			// Decals are drawn a window at a time, a run of commands whose vertices,
+			// contiguous in the stream, go up in one ring write and whose unrolled
+			// indices go up in another. Usually the whole layer is one window
+			for (const auto& decal : decals)
+			{
+				stats.nDecals += decal.instances > 0 ? decal.instances : 1;
+				stats.nVertices += decal.instances > 0 ? decal.instances * 4 : decal.points;
+			}
 
-			if (nDecalMode == DecalMode::WIREFRAME)
-				glDrawArrays(GL_LINE_LOOP, 0, decal.points);
-			else
-				glDrawArrays(GL_TRIANGLE_FAN, 0, decal.points);
+			const std::vector<alo::DecalVertex>& vVertices = decals.GetVertices();
+			alo::DecalPlan plan;
+			plan.nMaxVertices = MaxStreamVertices();
+			plan.nMaxIndices = MaxStreamIndices();
+			plan.nMaxInstances = StreamCapacity(ringInstances, sizeof(float)) / sizeof(alo::QuadInstance);
+			plan.texture = [&](const alo::DecalInstance& decal) { return TextureOf(decal); };
+			plan.window = [&](size_t nFirst, size_t nVertices, const std::vector<uint32_t>& vIndices, const std::vector<alo::DecalBatch>& vBatches)
+			{
+				const size_t nBase = Stream(ringVertices, vVertices.data() + nFirst, sizeof(alo::DecalVertex) * nVertices, sizeof(locVertex)) / sizeof(locVertex);
+				const size_t nIndexOffset = Stream(ringIndices, vIndices.data(), sizeof(uint32_t) * vIndices.size(), sizeof(uint32_t));
+				for (const auto& batch : vBatches)
+				{
+					SetDecalMode(batch.mode);
+					glBindTexture(GL_TEXTURE_2D, batch.nTexture);
+					locDrawElementsBaseVertex(batch.bLines ? GL_LINES : GL_TRIANGLES, GLsizei(batch.nIndices), GL_UNSIGNED_INT,
+						(const void*)(nIndexOffset + sizeof(uint32_t) * batch.nFirstIndex), GLint(nBase));
+					stats.nDrawCalls++;
+				}
+			};
+			plan.chunked = [&](const alo::DecalInstance& decal, uint32_t nTexture, const std::vector<uint32_t>& vUnrolled)
+			{
+				SetDecalMode(decal.mode);
+				glBindTexture(GL_TEXTURE_2D, nTexture);
+				stats.nDrawCalls += DrawChunked(decal, decals.Vertices(decal), vUnrolled);
+			};
+			plan.instanced = [&](uint32_t nTexture, alo::DecalMode mode, const alo::QuadInstance* pInstances, size_t nInstances)
+			{
+				SetDecalMode(mode);
+				glBindTexture(GL_TEXTURE_2D, nTexture);
+				stats.nDrawCalls += DrawInstancedQuads(pInstances, nInstances);
+			};
+			alo::PlanDecals(decals, plan);
 		}
 
 		uint32_t CreateTexture(const uint32_t width, const uint32_t height, const bool filtered, const bool clamp) override
@@ -4104,7 +8454,51 @@ namespace alo
 		void UpdateTexture(uint32_t id, alo::Sprite* spr) override
 		{
 			UNUSED(id);
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, spr->width, spr->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, spr->GetData());
+			SetSwizzle(alo::PixelFormat::RGBA8);
+			const size_t nRowBytes = sizeof(alo::Pixel) * spr->width;
+			const size_t nOffset = StagePixels(spr->GetData(), nRowBytes, spr->height, nRowBytes);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, spr->width, spr->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, (const void*)nOffset);
+			locBindBuffer(0x88EC, 0);
+		}
+
+		void UpdateTexture(uint32_t id, const alo::SpriteView& view) override
+		{
+			UNUSED(id);
+			SetSwizzle(alo::PixelFormat::RGBA8);
+			// Rows are packed tight as they are staged
+			const size_t nOffset = StagePixels(view.data, sizeof(alo::Pixel) * view.width, view.height, sizeof(alo::Pixel) * view.stride);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, view.width, view.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, (const void*)nOffset);
+			locBindBuffer(0x88EC, 0);
+		}
+
+		void UpdateTexture(uint32_t id, alo::Sprite* spr, const alo::vi2d& pos, const alo::vi2d& size) override
+		{
+			UNUSED(id);
+			const size_t nOffset = StagePixels(spr->GetData() + size_t(pos.y) * spr->width + pos.x,
+				sizeof(alo::Pixel) * size.x, size.y, sizeof(alo::Pixel) * spr->width);
+			glTexSubImage2D(GL_TEXTURE_2D, 0, pos.x, pos.y, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, (const void*)nOffset);
+			locBindBuffer(0x88EC, 0);
+		}
+
+		void UpdateTexture(uint32_t id, alo::PixelFormat format, const void* data, int32_t w, int32_t h, int32_t stride) override
+		{
+			UNUSED(id);
+			GLint nInternal = GL_RGBA; GLenum nFormat = GL_RGBA, nType = GL_UNSIGNED_BYTE;
+			size_t nPixelBytes = 4;
+			switch (format)
+			{
+			case alo::PixelFormat::R8: nInternal = 0x8229; nFormat = GL_RED; nPixelBytes = 1; break; // GL_R8
+			case alo::PixelFormat::RG8: nInternal = 0x822B; nFormat = 0x8227; nPixelBytes = 2; break; // GL_RG8, GL_RG
+			case alo::PixelFormat::RGB565: nInternal = 0x8D62; nFormat = GL_RGB; nType = 0x8363; nPixelBytes = 2; break; // GL_RGB565, GL_UNSIGNED_SHORT_5_6_5
+			case alo::PixelFormat::RGBA8: break;
+			case alo::PixelFormat::R32F: nInternal = 0x822E; nFormat = GL_RED; nType = GL_FLOAT; break; // GL_R32F
+			}
+			SetSwizzle(format);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			const size_t nOffset = StagePixels(data, nPixelBytes * w, h, nPixelBytes * stride);
+			glTexImage2D(GL_TEXTURE_2D, 0, nInternal, w, h, 0, nFormat, nType, (const void*)nOffset);
+			locBindBuffer(0x88EC, 0);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 		}
 
 		void ReadTexture(uint32_t id, alo::Sprite* spr) override
@@ -4112,11 +8506,87 @@ namespace alo
 			glReadPixels(0, 0, spr->width, spr->height, GL_RGBA, GL_UNSIGNED_BYTE, spr->GetData());
 		}
 
+		void ReadFrameAsync(const alo::vi2d& pos, const alo::vi2d& size, std::function<void(alo::Sprite&)> callback) override
+		{
+			// glReadPixels into a pack buffer returns at once, the copy running
+			// behind the frame's draws, and a fence says when it is done
+			Readback read{ 0, nullptr, size, std::move(callback) };
+			if (vIdleReadBuffers.empty())
+				locGenBuffers(1, &read.buffer);
+			else
+			{
+				read.buffer = vIdleReadBuffers.back();
+				vIdleReadBuffers.pop_back();
+			}
+			locBindBuffer(0x88EB, read.buffer); // GL_PIXEL_PACK_BUFFER
+			locBufferData(0x88EB, GLsizeiptr(sizeof(alo::Pixel) * size.x * size.y), nullptr, 0x88E1); // GL_STREAM_READ
+			glReadPixels(pos.x, pos.y, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+			locBindBuffer(0x88EB, 0);
+			read.pFence = locFenceSync(0x9117, 0); // GL_SYNC_GPU_COMMANDS_COMPLETE
+			vReadbacks.push_back(std::move(read));
+		}
+
+		void PollReadbacks(bool bWait) override
+		{
+			// Reads finish in order, so stop at the first still in flight
+			std::vector<Readback> vDone;
+			size_t nDone = 0;
+			for (; nDone < vReadbacks.size(); nDone++)
+			{
+				GLenum nResult = locClientWaitSync(vReadbacks[nDone].pFence, bWait ? 0x1 : 0, bWait ? 1000000000 : 0);
+				while (bWait && nResult == 0x911B) nResult = locClientWaitSync(vReadbacks[nDone].pFence, 0, 1000000000);
+				if (nResult != 0x911A && nResult != 0x911C) break; // GL_ALREADY_SIGNALED, GL_CONDITION_SATISFIED
+			}
+			vDone.assign(std::make_move_iterator(vReadbacks.begin()), std::make_move_iterator(vReadbacks.begin() + nDone));
+			vReadbacks.erase(vReadbacks.begin(), vReadbacks.begin() + nDone);
+
+			// Callbacks run last, free to queue more reads
+			for (auto& read : vDone)
+			{
+				locDeleteSync(read.pFence);
+				alo::Sprite spr(read.size.x, read.size.y, false);
+				const size_t nRowBytes = sizeof(alo::Pixel) * read.size.x;
+				locBindBuffer(0x88EB, read.buffer);
+				const uint8_t* pMapped = (const uint8_t*)locMapBufferRange(0x88EB, 0, GLsizeiptr(nRowBytes * read.size.y), 0x0001); // GL_MAP_READ_BIT
+				for (int32_t y = 0; y < read.size.y; y++)
+					std::memcpy(spr.GetData() + size_t(y) * read.size.x, pMapped + size_t(read.size.y - 1 - y) * nRowBytes, nRowBytes);
+				locUnmapBuffer(0x88EB);
+				locBindBuffer(0x88EB, 0);
+				vIdleReadBuffers.push_back(read.buffer);
+				read.callback(spr);
+			}
+		}
+
 		void ApplyTexture(uint32_t id) override
 		{
 			glBindTexture(GL_TEXTURE_2D, id);
 		}
 
+		uint32_t CreateTarget(uint32_t id, const alo::vi2d& size) override
+		{
+			glBindTexture(GL_TEXTURE_2D, id);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size.x, size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+			uint32_t nTarget = 0;
+			locGenFramebuffers(1, &nTarget);
+			locBindFramebuffer(0x8D40, nTarget); // GL_FRAMEBUFFER
+			locFramebufferTexture2D(0x8D40, 0x8CE0, GL_TEXTURE_2D, id, 0); // GL_COLOR_ATTACHMENT0
+			glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+			glClear(GL_COLOR_BUFFER_BIT);
+			locBindFramebuffer(0x8D40, 0);
+			return nTarget;
+		}
+
+		void DeleteTarget(uint32_t target) override
+		{
+			locDeleteFramebuffers(1, &target);
+		}
+
+		void ApplyTarget(uint32_t target, const alo::vi2d& size) override
+		{
+			locBindFramebuffer(0x8D40, target);
+			if (target != 0) glViewport(0, 0, size.x, size.y);
+		}
+
 		void ClearBuffer(alo::Pixel p, bool bDepth) override
 		{
 			glClearColor(float(p.r) / 255.0f, float(p.g) / 255.0f, float(p.b) / 255.0f, float(p.a) / 255.0f);
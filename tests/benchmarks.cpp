@@ -0,0 +1,134 @@
+#include "headless.h"
+
+// Rotated sprite drawing, reading the source from linear and tiled storage
+static void RotatedSampling()
+{
+	test::Engine engine;
+	std::printf("DrawSpriteTransformed, rotated source\n");
+	for (alo::vi2d vSize : { alo::vi2d(1920, 1080), alo::vi2d(4096, 4096) })
+	{
+		alo::Sprite src(vSize.x, vSize.y), dst(vSize.x, vSize.y);
+		for (int32_t y = 0; y < vSize.y; y++)
+			for (int32_t x = 0; x < vSize.x; x++)
+				src.SetPixel(x, y, alo::Pixel(uint8_t(x), uint8_t(y), uint8_t(x ^ y)));
+		engine.SetDrawTarget(&dst);
+
+		for (float fDegrees : { 17.0f, 90.0f })
+		{
+			// About the middle of the target
+			alo::Transform2D t;
+			t.Translate(-float(vSize.x) * 0.5f, -float(vSize.y) * 0.5f);
+			t.Rotate(fDegrees * 3.14159265f / 180.0f);
+			t.Translate(float(vSize.x) * 0.5f, float(vSize.y) * 0.5f);
+
+			for (alo::Sprite::Filter filter : { alo::Sprite::Filter::NEAREST, alo::Sprite::Filter::BILINEAR })
+			{
+				double fMs[2];
+				for (alo::Sprite::Layout layout : { alo::Sprite::Layout::LINEAR, alo::Sprite::Layout::TILED })
+				{
+					src.SetLayout(layout);
+					fMs[int(layout)] = test::Millis([&] { engine.DrawSpriteTransformed(&src, t, filter); });
+				}
+				std::printf("  %4dx%-4d %3.0f deg %-8s linear %7.1f ms, tiled %7.1f ms\n", vSize.x, vSize.y, fDegrees,
+					filter == alo::Sprite::Filter::NEAREST ? "nearest" : "bilinear", fMs[0], fMs[1]);
+			}
+		}
+		engine.SetDrawTarget(nullptr);
+	}
+}
+
+// Stroke fill rate, counting the pixels the stroke covers, against the target
+// of ten million per second per core at widths from 2 to 64
+static void StrokeFill()
+{
+	alo::Sprite spr(1920, 1080);
+	std::printf("DrawStroke, 1920x1080, zigzag polyline\n");
+	for (float fWidth : { 2.0f, 8.0f, 32.0f, 64.0f })
+	{
+		std::vector<alo::vf2d> vPoints;
+		for (int i = 0; i < 20; i++)
+			vPoints.push_back({ 80.0f + float(i) * 90.0f, i & 1 ? 980.0f : 100.0f });
+
+		// Covered pixels, from a stroke over black
+		for (int32_t y = 0; y < spr.height; y++) for (int32_t x = 0; x < spr.width; x++) spr.SetPixel(x, y, alo::BLACK);
+		alo::Raster::DrawStroke(spr.View(), vPoints.data(), vPoints.size(), fWidth, alo::WHITE);
+		size_t nCovered = 0;
+		for (int32_t y = 0; y < spr.height; y++) for (int32_t x = 0; x < spr.width; x++) nCovered += spr.GetPixel(x, y).r != 0;
+
+		const double fMs = test::Millis([&] { alo::Raster::DrawStroke(spr.View(), vPoints.data(), vPoints.size(), fWidth, alo::WHITE); });
+		std::printf("  width %4.0f  %8zu px  %7.2f ms  %6.1f Mpx/s\n", fWidth, nCovered, fMs, double(nCovered) / fMs / 1000.0);
+	}
+
+	// A stroke extended a point at a time costs the same per segment however long
+	// it is, as long as it does not keep going back over itself
+	std::printf("ExtendStroke, 1920x1080, width 16, outward spiral\n");
+	for (int nSegments : { 1000, 4000, 16000 })
+	{
+		double fMs = test::Millis([&]
+		{
+			alo::Raster::Stroke stroke;
+			for (int i = 0; i <= nSegments; i++)
+			{
+				const float t = std::sqrt(float(i)) * 0.5f, fRadius = 8.0f * t;
+				alo::vf2d v = { 960.0f + fRadius * std::cos(t), 540.0f + fRadius * std::sin(t) };
+				alo::Raster::ExtendStroke(spr.View(), stroke, v, 16.0f, alo::WHITE);
+			}
+		}, 3);
+		std::printf("  %6d segments  %8.1f ms  %6.2f us/segment\n", nSegments, fMs, fMs * 1000.0 / nSegments);
+	}
+}
+
+// Filling a self-intersecting curve of 100k points at 4K, to be well under a second
+static void PolygonFill()
+{
+	alo::Sprite spr(3840, 2160);
+	std::vector<alo::vf2d> vCurve;
+	for (int i = 0; i < 100000; i++)
+	{
+		// A hypotrochoid, like the demo's pen path
+		const float t = float(i) * 0.0031f;
+		vCurve.push_back({ 1920.0f + 700.0f * std::cos(t) + 350.0f * std::cos(t * 4.7f), 1080.0f + 700.0f * std::sin(t) - 350.0f * std::sin(t * 4.7f) });
+	}
+	std::printf("FillPolygon, 3840x2160, 100000 point hypotrochoid\n");
+	for (alo::Raster::FillRule rule : { alo::Raster::FillRule::NONZERO, alo::Raster::FillRule::EVEN_ODD })
+	{
+		const double fMs = test::Millis([&] { alo::Raster::FillPolygon(spr.View(), vCurve.data(), vCurve.size(), alo::WHITE, rule); });
+		std::printf("  %-8s %7.1f ms\n", rule == alo::Raster::FillRule::NONZERO ? "nonzero" : "even-odd", fMs);
+	}
+	for (int32_t y = 0; y < spr.height; y++) for (int32_t x = 0; x < spr.width; x++) spr.SetPixel(x, y, alo::BLACK);
+	const double fMs = test::Millis([&]
+	{
+		alo::Raster::FloodFill(spr.View(), { 0, 0 }, alo::WHITE);
+		alo::Raster::FloodFill(spr.View(), { 0, 0 }, alo::BLACK);
+	}, 3) * 0.5;
+	std::printf("FloodFill, 3840x2160, whole target  %7.1f ms\n", fMs);
+}
+
+// A full 1080p layer glow, against the target of under 5 ms on 8 cores. The
+// work is split across as many threads as the machine reports
+static void LayerGlow()
+{
+	alo::Sprite src(1920, 1080), dst(1920, 1080);
+	for (int32_t y = 0; y < src.height; y++)
+		for (int32_t x = 0; x < src.width; x++)
+			src.SetPixel(x, y, (x / 7 + y / 5) % 9 == 0 ? alo::Pixel(255, 64, 200) : alo::BLACK);
+
+	const unsigned nThreads = std::max(std::thread::hardware_concurrency(), 1u);
+	std::printf("Glow, 1920x1080, %u threads, target under 5 ms on 8%s\n", nThreads, nThreads < 8 ? ", not checked here" : "");
+	for (alo::Raster::BlurKernel kernel : { alo::Raster::BlurKernel::BOX, alo::Raster::BlurKernel::GAUSSIAN })
+		for (int32_t nRadius : { 4, 16, 48 })
+		{
+			const double fMs = test::Millis([&] { alo::Raster::Glow(src.View(), dst.View(), nRadius, kernel, 1.0f, { 0, 0, 1920, 1080 }); }, 10);
+			std::printf("  %-8s radius %2d  %7.2f ms%s\n", kernel == alo::Raster::BlurKernel::BOX ? "box" : "gaussian", nRadius, fMs,
+				nThreads < 8 ? "" : fMs < 5.0 ? "  met" : "  missed");
+		}
+}
+
+int main()
+{
+	RotatedSampling();
+	StrokeFill();
+	PolygonFill();
+	LayerGlow();
+	return 0;
+}
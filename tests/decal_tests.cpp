@@ -0,0 +1,395 @@
+#include "headless.h"
+
+// Partial draws from a target read its rows from the bottom up, like whole ones
+static void TargetPartialUV()
+{
+	test::Engine engine;
+	alo::Decal target({ 100, 50 });
+
+	engine.DrawPartialDecal({ 0, 0 }, { 50, 25 }, &target, { 0, 0 }, { 50, 25 });
+	const test::Renderer& r = engine.Flush();
+	CHECK(r.vVertices.size() == 4);
+	if (r.vVertices.size() == 4)
+	{
+		// tl, bl, br, tr
+		CHECK_NEAR(r.vVertices[0].uv.x, 0.0f); CHECK_NEAR(r.vVertices[0].uv.y, 1.0f);
+		CHECK_NEAR(r.vVertices[1].uv.x, 0.0f); CHECK_NEAR(r.vVertices[1].uv.y, 0.5f);
+		CHECK_NEAR(r.vVertices[2].uv.x, 0.5f); CHECK_NEAR(r.vVertices[2].uv.y, 0.5f);
+		CHECK_NEAR(r.vVertices[3].uv.x, 0.5f); CHECK_NEAR(r.vVertices[3].uv.y, 1.0f);
+	}
+
+	// The whole decal and its bottom half agree with the partial draw
+	engine.DrawDecal({ 0, 0 }, &target);
+	CHECK_NEAR(engine.Flush().vVertices[1].uv.y, 0.0f);
+	engine.DrawPartialDecal({ 0, 0 }, { 100, 25 }, &target, { 0, 25 }, { 100, 25 });
+	CHECK_NEAR(engine.Flush().vVertices[0].uv.y, 0.5f);
+}
+
+// A target destroyed while set, with drawing queued, sends drawing back to the layer
+static void TargetDestroyedWhileSet()
+{
+	test::Engine engine;
+	{
+		alo::Decal target({ 100, 50 });
+		engine.SetDecalTarget(&target);
+		engine.ClearDecalTarget(&target);
+		engine.FillRectDecal({ 0, 0 }, { 10, 10 });
+		CHECK(engine.GetLayers()[0].decals.Count() == 0);
+	}
+	engine.FillRectDecal({ 0, 0 }, { 320, 240 });
+	CHECK(engine.GetLayers()[0].decals.Count() == 1);
+	const test::Renderer& r = engine.Flush();
+	CHECK(r.vVertices.size() == 4);
+	if (r.vVertices.size() == 4)
+	{
+		// In screen coordinates again
+		CHECK_NEAR(r.vVertices[2].pos.x, 0.0f);
+		CHECK_NEAR(r.vVertices[2].pos.y, 0.0f);
+	}
+
+	// A new target reuses the released entry
+	alo::Decal target({ 64, 64 });
+	engine.SetDecalTarget(&target);
+	engine.FillRectDecal({ 0, 0 }, { 10, 10 });
+	CHECK(engine.GetLayers()[0].decals.Count() == 0);
+	engine.SetDecalTarget(nullptr);
+}
+
+// Indices past the last vertex are dropped as the decal is submitted
+static void IndexOutOfRange()
+{
+	test::Engine engine;
+	const std::vector<alo::vf2d> vPos = { { 0, 0 }, { 10, 0 }, { 10, 10 }, { 0, 10 } };
+	engine.SetDecalStructure(alo::DecalStructure::STRIP);
+	engine.DrawIndexedDecal(nullptr, vPos, {}, { 0, 1, 2, 3, alo::nDecalRestart, 0, 4, 2, 1000000, 3 });
+	engine.SetDecalStructure(alo::DecalStructure::FAN);
+
+	const test::Renderer& r = engine.Flush();
+	CHECK(r.vIndices.size() == 10);
+	for (uint32_t n : r.vIndices)
+		CHECK(n == alo::nDecalRestart || n < 4);
+
+	// Only the first strip survives whole
+	std::vector<uint32_t> vUnrolled;
+	if (!r.vDecals.empty())
+		alo::UnrollDecal(r.vDecals.back(), r.vIndices.data(), 0, vUnrolled);
+	CHECK((vUnrolled == std::vector<uint32_t>{ 0, 1, 2, 2, 1, 3 }));
+}
+
+// Line and rectangle outlines draw the same whatever structure is set
+static void OutlinesIgnoreStructure()
+{
+	for (alo::DecalStructure structure : { alo::DecalStructure::FAN, alo::DecalStructure::STRIP, alo::DecalStructure::LIST, alo::DecalStructure::LINE })
+	{
+		test::Engine engine;
+		engine.SetDecalStructure(structure);
+		engine.DrawLineDecal({ 10, 10 }, { 100, 50 });
+		const test::Renderer& r = engine.Flush();
+		CHECK(r.vDecals.size() == 1);
+		std::vector<uint32_t> vUnrolled;
+		if (r.vDecals.size() == 1)
+		{
+			CHECK(alo::DecalIsLines(r.vDecals[0]));
+			alo::UnrollDecal(r.vDecals[0], nullptr, 0, vUnrolled);
+		}
+		CHECK((vUnrolled == std::vector<uint32_t>{ 0, 1 }));
+
+		// The rectangle's four edges, and the structure is left as it was
+		engine.DrawRectDecal({ 10, 10 }, { 20, 20 });
+		engine.Flush();
+		vUnrolled.clear();
+		if (r.vDecals.size() == 1)
+			alo::UnrollDecal(r.vDecals[0], nullptr, 0, vUnrolled);
+		CHECK((vUnrolled == std::vector<uint32_t>{ 0, 1, 1, 2, 2, 3, 3, 0 }));
+		engine.DrawPolygonDecal(nullptr, { { 0, 0 }, { 1, 0 }, { 1, 1 } }, { { 0, 0 }, { 0, 0 }, { 0, 0 } });
+		CHECK(engine.Flush().vDecals[0].structure == structure);
+	}
+}
+
+// A decal of about a million vertices, in runs between restarts, splits into
+// chunks of whole primitives, none of them spanning a restart
+static void ChunkedStructures()
+{
+	const uint32_t nVertices = 1 << 20;
+	const uint32_t vLengths[] = { 5, 3, 1000, 2, 65539, 7, 1, 4096, 3 };
+	std::vector<alo::vf2d> vPos(nVertices);
+	std::vector<uint32_t> vIndices, vRunOf(nVertices);
+	uint32_t nRuns = 0;
+	for (uint32_t v = 0, r = 0; v < nVertices; r++, nRuns++)
+	{
+		const uint32_t n = std::min(vLengths[r % std::size(vLengths)], nVertices - v);
+		for (uint32_t i = 0; i < n; i++, v++) { vIndices.push_back(v); vRunOf[v] = nRuns; }
+		vIndices.push_back(alo::nDecalRestart);
+	}
+
+	for (alo::DecalStructure structure : { alo::DecalStructure::FAN, alo::DecalStructure::STRIP, alo::DecalStructure::LIST, alo::DecalStructure::LINE })
+	{
+		test::Engine engine;
+		engine.SetDecalStructure(structure);
+		engine.DrawIndexedDecal(nullptr, vPos, {}, vIndices);
+		const test::Renderer& r = engine.Flush();
+		if (r.vDecals.size() != 1) { CHECK(r.vDecals.size() == 1); continue; }
+		const alo::DecalInstance& decal = r.vDecals[0];
+
+		std::vector<uint32_t> vUnrolled;
+		alo::UnrollDecal(decal, r.vIndices.data(), 0, vUnrolled);
+		const size_t nPrimitive = structure == alo::DecalStructure::LINE ? 2 : 3;
+
+		// Primitives each run should give, counted apart from UnrollDecal
+		size_t nExpected = 0;
+		for (uint32_t v = 0, run = 0; v < nVertices; run++)
+		{
+			const uint32_t n = std::min(vLengths[run % std::size(vLengths)], nVertices - v);
+			v += n;
+			if (structure == alo::DecalStructure::LIST) nExpected += n / 3;
+			else if (structure == alo::DecalStructure::LINE) nExpected += n > 1 ? n - 1 : 0;
+			else nExpected += n > 2 ? n - 2 : 0;
+		}
+		CHECK(vUnrolled.size() == nExpected * nPrimitive);
+
+		// The first chunk of the second size ends on the restart after the third run
+		size_t nToRestart = 0;
+		while (nToRestart < vUnrolled.size() && vRunOf[vUnrolled[nToRestart]] < 3) nToRestart++;
+		for (size_t nMax : { size_t(65537), nToRestart })
+		{
+			size_t nNext = 0;
+			bool bWhole = true, bWithinRuns = true;
+			const uint32_t nChunks = alo::ChunkDecal(decal, vUnrolled.size(), nMax, [&](size_t first, size_t count)
+			{
+				bWhole = bWhole && first == nNext && count > 0 && count <= nMax && count % nPrimitive == 0;
+				for (size_t i = first; i < first + count; i += nPrimitive)
+					for (size_t k = 1; k < nPrimitive; k++)
+						bWithinRuns = bWithinRuns && vRunOf[vUnrolled[i + k]] == vRunOf[vUnrolled[i]];
+				if (nMax == nToRestart && first == 0)
+					CHECK(vRunOf[vUnrolled[count - 1]] < 3 && vRunOf[vUnrolled[count]] >= 3);
+				nNext = first + count;
+			});
+			CHECK(bWhole);
+			CHECK(bWithinRuns);
+			CHECK(nNext == vUnrolled.size());
+			const size_t nChunk = nMax / nPrimitive * nPrimitive;
+			CHECK(nChunks == (vUnrolled.size() + nChunk - 1) / nChunk);
+		}
+
+		// A ring too small for one primitive draws nothing
+		CHECK(alo::ChunkDecal(decal, vUnrolled.size(), nPrimitive - 1, [](size_t, size_t) {}) == 0);
+	}
+}
+
+// Mixed rectangles packed until the atlas is full all lie inside their page,
+// keep their padding clear of each other and hold their own pixels. Once full,
+// adding fails cleanly rather than writing past the page
+static void AtlasPacking()
+{
+	test::Engine engine;
+	const int32_t nPage = 128, nPad = 2;
+	alo::DecalAtlas atlas(nPage, false, nPad, 1);
+	struct Placed { alo::Decal* decal; alo::vi2d pos; alo::Pixel col; };
+	std::vector<Placed> vPlaced;
+	uint32_t nSeed = 7;
+	for (int i = 0; i < 200; i++)
+	{
+		nSeed = nSeed * 1664525u + 1013904223u;
+		const alo::vi2d vSize = { int32_t(1 + (nSeed >> 8) % 40), int32_t(1 + (nSeed >> 20) % 24) };
+		const alo::Pixel col(uint8_t(i), uint8_t(i * 7), uint8_t(255 - i));
+		alo::Sprite spr(vSize.x, vSize.y);
+		for (int32_t y = 0; y < vSize.y; y++) for (int32_t x = 0; x < vSize.x; x++) spr.SetPixel(x, y, col);
+		alo::Decal* d = atlas.Add(&spr);
+		if (d == nullptr) continue;
+		const alo::vi2d pos = { int32_t(std::lround(d->vUVOffset.x * nPage)), int32_t(std::lround(d->vUVOffset.y * nPage)) };
+		vPlaced.push_back({ d, pos, col });
+	}
+	CHECK(atlas.PageCount() == 1);
+	CHECK(vPlaced.size() > 10 && vPlaced.size() < 200);
+
+	bool bInside = true, bApart = true, bPixels = true;
+	alo::Sprite* page = atlas.Page(0)->sprite;
+	for (size_t i = 0; i < vPlaced.size(); i++)
+	{
+		const alo::vi2d a = vPlaced[i].pos, sa = vPlaced[i].decal->vSize;
+		bInside = bInside && a.x >= 0 && a.y >= 0 && a.x + sa.x + nPad <= nPage && a.y + sa.y + nPad <= nPage;
+		for (size_t j = i + 1; j < vPlaced.size(); j++)
+		{
+			// The padded rectangles are disjoint
+			const alo::vi2d b = vPlaced[j].pos, sb = vPlaced[j].decal->vSize;
+			bApart = bApart && (a.x + sa.x + nPad <= b.x || b.x + sb.x + nPad <= a.x || a.y + sa.y + nPad <= b.y || b.y + sb.y + nPad <= a.y);
+		}
+		for (int32_t y = 0; y < sa.y; y++)
+			for (int32_t x = 0; x < sa.x; x++)
+				bPixels = bPixels && page->GetPixel(a.x + x, a.y + y) == vPlaced[i].col;
+	}
+	CHECK(bInside);
+	CHECK(bApart);
+	CHECK(bPixels);
+
+	// Too big for any page, or for what is left of this one
+	alo::Sprite sprLarge(nPage, 4), sprMedium(60, 60);
+	CHECK(atlas.Add(&sprLarge) == nullptr);
+	CHECK(atlas.Add(&sprMedium) == nullptr);
+	CHECK(atlas.Add(nullptr) == nullptr);
+	CHECK(atlas.PageCount() == 1);
+
+	// Without a limit, a second page opens instead
+	alo::DecalAtlas open(nPage, false, nPad);
+	for (int i = 0; i < 20; i++)
+	{
+		alo::Sprite spr(40, 40);
+		CHECK(open.Add(&spr) != nullptr);
+	}
+	CHECK(open.PageCount() > 1);
+}
+
+// PlanDecals, driven through a stand in for the GL ring: each window lands at
+// a base vertex of its own and every index drawn is read back through that
+// base, each vertex's tint being its place in the stream. A million point
+// polyline between small decals must come out as exactly its segments, however
+// it is cut into windows or chunks
+static void PlannedWindows()
+{
+	const uint32_t nLine = 1000000;
+	alo::DecalStream decals;
+	auto push = [&](alo::DecalMode mode, alo::DecalStructure structure, uint32_t nPoints)
+	{
+		const uint32_t nFirst = uint32_t(decals.GetVertices().size());
+		alo::DecalVertex* v = decals.Push(nullptr, mode, structure, nPoints);
+		for (uint32_t i = 0; i < nPoints; i++) v[i].tint = alo::Pixel(nFirst + i);
+	};
+	auto small = [&](uint32_t k)
+	{
+		const alo::DecalStructure structures[] = { alo::DecalStructure::FAN, alo::DecalStructure::STRIP, alo::DecalStructure::LIST, alo::DecalStructure::LINE };
+		const alo::DecalMode mode = k % 5 == 0 ? alo::DecalMode::WIREFRAME : k % 3 == 0 ? alo::DecalMode::ADDITIVE : alo::DecalMode::NORMAL;
+		const uint32_t nPoints = 3 + k * 7 % 40;
+		push(mode, structures[k % 4], nPoints);
+		if (k % 4 == 1)
+		{
+			// Indexed, restarting halfway
+			uint32_t* p = decals.PushIndices(nPoints + 1);
+			for (uint32_t i = 0; i <= nPoints; i++)
+				p[i] = i == nPoints / 2 ? alo::nDecalRestart : (i * 5) % nPoints;
+		}
+	};
+
+	for (uint32_t k = 0; k < 500; k++) small(k);
+	push(alo::DecalMode::NORMAL, alo::DecalStructure::LINE, nLine);
+	const uint32_t nLineOffset = decals[decals.Count() - 1].offset;
+	for (uint32_t k = 0; k < 40; k++)
+	{
+		alo::QuadInstance* q = decals.PushInstances(nullptr, k % 8 < 6 ? alo::DecalMode::NORMAL : alo::DecalMode::ADDITIVE, 1 + k % 13);
+		q->tint = alo::Pixel(k);
+	}
+	for (uint32_t k = 500; k < 1500; k++) small(k);
+
+	// Every primitive index the stream should draw, in order
+	std::vector<uint32_t> vExpected;
+	size_t nInstances = 0;
+	for (const auto& decal : decals)
+	{
+		alo::UnrollDecal(decal, decals.Indices(decal), decal.offset, vExpected);
+		nInstances += decal.instances;
+	}
+
+	struct Limits { size_t nVertices, nIndices, nInstances; };
+	for (const Limits& limits : { Limits{ 1000, 2000, 7 }, Limits{ 32767, 65535, 64 }, Limits{ 1 << 21, 1 << 22, 1 << 16 } })
+	{
+		const std::vector<alo::DecalVertex>& vVertices = decals.GetVertices();
+		std::vector<alo::DecalVertex> vRing;
+		std::vector<uint32_t> vDrawn;
+		size_t nDrawnInstances = 0, nWindows = 0, nChunks = 0;
+		bool bWithin = true, bWhole = true, bInstances = true;
+
+		alo::DecalPlan plan;
+		plan.nMaxVertices = limits.nVertices;
+		plan.nMaxIndices = limits.nIndices;
+		plan.nMaxInstances = limits.nInstances;
+		plan.texture = [](const alo::DecalInstance& decal) { return uint32_t(decal.mode); };
+		plan.window = [&](size_t nFirst, size_t nCount, const std::vector<uint32_t>& vIndices, const std::vector<alo::DecalBatch>& vBatches)
+		{
+			// Each window lands somewhere else in the ring
+			const size_t nBase = nWindows * 389 % 1000;
+			vRing.assign(nBase, alo::DecalVertex());
+			vRing.insert(vRing.end(), vVertices.begin() + nFirst, vVertices.begin() + nFirst + nCount);
+			bWithin = bWithin && nCount <= limits.nVertices && vIndices.size() <= limits.nIndices;
+			size_t nNext = 0;
+			for (const auto& batch : vBatches)
+			{
+				bWhole = bWhole && batch.nFirstIndex == nNext && batch.nIndices % (batch.bLines ? 2 : 3) == 0;
+				nNext = batch.nFirstIndex + batch.nIndices;
+				for (size_t i = batch.nFirstIndex; i < nNext; i++)
+				{
+					bWithin = bWithin && vIndices[i] < nCount;
+					vDrawn.push_back(vRing[nBase + vIndices[i]].tint.n);
+				}
+			}
+			bWhole = bWhole && nNext == vIndices.size();
+			nWindows++;
+		};
+		plan.chunked = [&](const alo::DecalInstance& decal, uint32_t, const std::vector<uint32_t>& vUnrolled)
+		{
+			const alo::DecalVertex* pVertices = decals.Vertices(decal);
+			nChunks += alo::ChunkDecal(decal, vUnrolled.size(), limits.nVertices, [&](size_t first, size_t count)
+			{
+				bWithin = bWithin && count <= limits.nVertices;
+				for (size_t k = 0; k < count; k++)
+					vDrawn.push_back(pVertices[vUnrolled[first + k]].tint.n);
+			});
+		};
+		plan.instanced = [&](uint32_t nTexture, alo::DecalMode mode, const alo::QuadInstance* pInstances, size_t nCount)
+		{
+			bInstances = bInstances && nCount > 0 && nCount <= limits.nInstances && nTexture == uint32_t(mode)
+				&& pInstances == decals.GetInstances().data() + nDrawnInstances;
+			nDrawnInstances += nCount;
+		};
+		alo::PlanDecals(decals, plan);
+
+		CHECK(bWithin);
+		CHECK(bWhole);
+		CHECK(bInstances);
+		CHECK(nDrawnInstances == nInstances);
+		CHECK(vDrawn == vExpected);
+		CHECK((nChunks > 0) == (nLine > limits.nVertices));
+		CHECK(nWindows > (limits.nVertices < 2000 ? 10u : 1u));
+
+		// The polyline is every segment once, in order, whichever way it went up
+		const auto it = std::find(vDrawn.begin(), vDrawn.end(), nLineOffset);
+		bool bSegments = it != vDrawn.end() && size_t(vDrawn.end() - it) >= size_t(nLine - 1) * 2;
+		for (uint32_t v = 0; bSegments && v + 1 < nLine; v++)
+			bSegments = it[2 * v] == nLineOffset + v && it[2 * v + 1] == nLineOffset + v + 1;
+		CHECK(bSegments);
+	}
+}
+
+// A target goes back to the engine that queued for it, not whichever engine
+// was made last, and one outliving its engine leaves it alone
+static void TargetOwnedByEngine()
+{
+	alo::Decal outlived({ 32, 32 });
+	{
+		test::Engine first;
+		first.SetDecalTarget(&outlived);
+		first.SetDecalTarget(nullptr);
+		{
+			alo::Decal target({ 32, 32 });
+			first.SetDecalTarget(&target);
+			test::Engine second;
+			CHECK(target.pTargetOwner == &first);
+		}
+		first.FillRectDecal({ 0, 0 }, { 10, 10 });
+		CHECK(first.GetLayers()[0].decals.Count() == 1);
+		CHECK(outlived.pTargetOwner == &first);
+	}
+	CHECK(outlived.pTargetOwner == nullptr);
+}
+
+int main()
+{
+	TargetPartialUV();
+	TargetDestroyedWhileSet();
+	TargetOwnedByEngine();
+	IndexOutOfRange();
+	OutlinesIgnoreStructure();
+	ChunkedStructures();
+	AtlasPacking();
+	PlannedWindows();
+	std::printf(test::nFailed == 0 ? "All passed\n" : "%d failed\n", test::nFailed);
+	return test::nFailed == 0 ? 0 : 1;
+}
@@ -0,0 +1,96 @@
+// Headless engine for the tests, no window, GL or image loader. Build each
+// *_tests.cpp with
+//
+//   g++ -std=c++17 -I.. -DALO_PLATFORM_CUSTOM_EX -DALO_GFX_CUSTOM_EX -DALO_IMAGE_CUSTOM_EX
+//       -DALO_PGE_HEADLESS decal_tests.cpp -o decal_tests -lpthread
+//
+// and run it from this directory, it returns non zero if a check failed.
+// benchmarks.cpp only prints timings, build it with -O2 and without sanitizers
+#pragma once
+#define ALO_GE_APPLICATION
+#include "aloGameEngine.h"
+
+#include <chrono>
+#include <cstdio>
+
+namespace test
+{
+	// Renderer recording the decals it is handed
+	class Renderer : public alo::Renderer
+	{
+	public:
+		void       PrepareDevice() override {}
+		alo::rcode CreateDevice(std::vector<void*>, bool, bool) override { return alo::OK; }
+		alo::rcode DestroyDevice() override { return alo::OK; }
+		void       DisplayFrame() override {}
+		void       PrepareDrawing() override {}
+		void       SetDecalMode(const alo::DecalMode&) override {}
+		void       DrawLayerQuad(const alo::vf2d&, const alo::vf2d&, const alo::Pixel) override {}
+		void       DrawDecal(const alo::DecalInstance& decal, const alo::DecalVertex* pVertices, const uint32_t* pIndices) override
+		{
+			vDecals.push_back(decal);
+			vVertices.assign(pVertices, pVertices + decal.points);
+			vIndices.assign(pIndices, pIndices + (pIndices ? decal.indices : 0));
+		}
+		uint32_t   CreateTexture(const uint32_t, const uint32_t, const bool, const bool) override { return ++nTextures; }
+		void       UpdateTexture(uint32_t, alo::Sprite*) override {}
+		void       ReadTexture(uint32_t, alo::Sprite*) override {}
+		uint32_t   DeleteTexture(const uint32_t id) override { return id; }
+		void       ApplyTexture(uint32_t) override {}
+		uint32_t   CreateTarget(uint32_t id, const alo::vi2d&) override { return id; }
+		void       UpdateViewport(const alo::vi2d&, const alo::vi2d&) override {}
+		void       ClearBuffer(alo::Pixel, bool) override {}
+
+	public:
+		std::vector<alo::DecalInstance> vDecals;
+		// The last decal's vertices and indices
+		std::vector<alo::DecalVertex> vVertices;
+		std::vector<uint32_t> vIndices;
+		uint32_t nTextures = 0;
+	};
+
+	class Engine : public alo::GameEngine
+	{
+	public:
+		Engine()
+		{
+			alo::renderer = std::make_unique<test::Renderer>();
+			alo::Renderer::ptrGE = this;
+			Construct(640, 480, 1, 1);
+			CreateLayer();
+			SetDrawTarget(nullptr);
+		}
+
+		bool OnUserCreate() override { return true; }
+		bool OnUserUpdate(float) override { return true; }
+
+		// Hands the draw target layer's decals to the renderer, as a frame would
+		test::Renderer& Flush()
+		{
+			auto& r = static_cast<test::Renderer&>(*alo::renderer);
+			r.vDecals.clear();
+			alo::renderer->DrawDecals(GetLayers()[0].decals);
+			GetLayers()[0].decals.Clear();
+			return r;
+		}
+	};
+
+	inline int nFailed = 0;
+
+	// Best of nRuns wall clock times of f, in milliseconds
+	template<typename F>
+	double Millis(F&& f, int nRuns = 5)
+	{
+		double fBest = 1e30;
+		for (int i = 0; i < nRuns; i++)
+		{
+			auto t0 = std::chrono::steady_clock::now();
+			f();
+			fBest = std::min(fBest, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+		}
+		return fBest;
+	}
+}
+
+#define CHECK(x) do { if (!(x)) { std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #x); test::nFailed++; } } while (0)
+#define CHECK_NEAR(a, b) CHECK(std::abs((a) - (b)) < 1e-4f)
@@ -0,0 +1,315 @@
+#include "headless.h"
+
+static void Fill(alo::Sprite& spr, alo::Pixel p)
+{
+	for (int32_t y = 0; y < spr.height; y++)
+		for (int32_t x = 0; x < spr.width; x++)
+			spr.SetPixel(x, y, p);
+}
+
+static size_t Count(alo::Sprite& spr, alo::Pixel p)
+{
+	size_t n = 0;
+	for (int32_t y = 0; y < spr.height; y++)
+		for (int32_t x = 0; x < spr.width; x++)
+			n += spr.GetPixel(x, y) == p;
+	return n;
+}
+
+// A fill inside a diamond, whose walls only touch diagonally, stays inside
+static void FloodFillRing()
+{
+	alo::Sprite spr(64, 64);
+	Fill(spr, alo::BLACK);
+	const int32_t c = 32, R = 20;
+	for (int32_t y = 0; y < 64; y++)
+		for (int32_t x = 0; x < 64; x++)
+			if (std::abs(x - c) + std::abs(y - c) == R) spr.SetPixel(x, y, alo::WHITE);
+
+	const alo::DirtyRegion::Rect r = alo::Raster::FloodFill(spr.View(), { c, c }, alo::RED);
+	bool bExact = true;
+	for (int32_t y = 0; y < 64; y++)
+		for (int32_t x = 0; x < 64; x++)
+		{
+			const int32_t d = std::abs(x - c) + std::abs(y - c);
+			const alo::Pixel p = spr.GetPixel(x, y);
+			bExact = bExact && p == (d < R ? alo::RED : d == R ? alo::WHITE : alo::BLACK);
+		}
+	CHECK(bExact);
+	CHECK(r.x0 == c - R + 1 && r.y0 == c - R + 1 && r.x1 == c + R && r.y1 == c + R);
+
+	// Outside, the fill goes round the ring and no further
+	alo::Raster::FloodFill(spr.View(), { 0, 0 }, alo::BLUE);
+	CHECK(Count(spr, alo::BLACK) == 0);
+	CHECK(Count(spr, alo::RED) == size_t(2 * R * R - 2 * R + 1));
+
+	// Seeds off the target fill nothing
+	CHECK(alo::Raster::FloodFill(spr.View(), { -1, 5 }, alo::GREEN).x1 == 0);
+	CHECK(alo::Raster::FloodFill(spr.View(), { 5, 64 }, alo::GREEN).x1 == 0);
+	CHECK(Count(spr, alo::GREEN) == 0);
+}
+
+// The centre of a pentagram winds twice, so only NONZERO fills it
+static void FillPolygonStar()
+{
+	std::vector<alo::vf2d> vStar;
+	for (int i = 0; i < 5; i++)
+	{
+		const float a = float(i) * 4.0f * 3.14159265f / 5.0f - 3.14159265f * 0.5f;
+		vStar.push_back({ 50.0f + 40.0f * std::cos(a), 50.0f + 40.0f * std::sin(a) });
+	}
+
+	for (alo::Raster::FillRule rule : { alo::Raster::FillRule::NONZERO, alo::Raster::FillRule::EVEN_ODD })
+	{
+		alo::Sprite spr(100, 100);
+		Fill(spr, alo::BLACK);
+		alo::Raster::FillPolygon(spr.View(), vStar.data(), vStar.size(), alo::WHITE, rule);
+		CHECK(spr.GetPixel(50, 50) == (rule == alo::Raster::FillRule::NONZERO ? alo::WHITE : alo::BLACK));
+		// A tip, and a point between two tips
+		CHECK(spr.GetPixel(50, 15) == alo::WHITE);
+		CHECK(spr.GetPixel(50, 85) == alo::BLACK);
+		CHECK(spr.GetPixel(2, 2) == alo::BLACK);
+	}
+}
+
+// Too few points, no area, bad coordinates and polygons off the target fill
+// nothing, and polygons partly off it are clipped by pixel centres
+static void FillPolygonDegenerate()
+{
+	alo::Sprite spr(32, 32);
+	Fill(spr, alo::BLACK);
+	auto fill = [&](std::vector<alo::vf2d> v) { return alo::Raster::FillPolygon(spr.View(), v.data(), v.size(), alo::WHITE); };
+
+	CHECK(fill({}).x1 == 0);
+	CHECK(fill({ { 1, 1 }, { 20, 20 } }).x1 == 0);
+	CHECK(fill({ { 1, 1 }, { 10, 10 }, { 20, 20 } }).x1 == 0);
+	CHECK(fill({ { 5, 5 }, { 5, 5 }, { 5, 5 }, { 5, 5 } }).x1 == 0);
+	CHECK(fill({ { 1, 1 }, { NAN, 20 }, { 20, 20 } }).x1 == 0);
+	CHECK(fill({ { 40, 40 }, { 60, 40 }, { 60, 60 }, { 40, 60 } }).x1 == 0);
+	CHECK(fill({ { -30, 5 }, { -2, 5 }, { -2, 25 }, { -30, 25 } }).x1 == 0);
+	CHECK(fill({ { 5, -30 }, { 25, -30 }, { 25, -1 }, { 5, -1 } }).x1 == 0);
+	CHECK(Count(spr, alo::WHITE) == 0);
+
+	const alo::DirtyRegion::Rect r = fill({ { -10, -10 }, { 10, -10 }, { 10, 10 }, { -10, 10 } });
+	CHECK(r.x0 == 0 && r.y0 == 0 && r.x1 == 10 && r.y1 == 10);
+	CHECK(Count(spr, alo::WHITE) == 100);
+	CHECK(spr.GetPixel(9, 9) == alo::WHITE && spr.GetPixel(10, 9) == alo::BLACK);
+
+	// Covering the whole target and more
+	fill({ { -1000, -1000 }, { 1000, -1000 }, { 1000, 1000 }, { -1000, 1000 } });
+	CHECK(Count(spr, alo::WHITE) == 32 * 32);
+}
+
+// BOX averages each block, rounding to nearest
+static void DownsampleBox()
+{
+	for (int32_t n : { 2, 3 })
+	{
+		alo::Sprite src(8 * n, 6 * n), dst(8, 6);
+		for (int32_t y = 0; y < src.height; y++)
+			for (int32_t x = 0; x < src.width; x++)
+				src.SetPixel(x, y, alo::Pixel(uint8_t(x * 37 + y * 11), uint8_t(x * y), uint8_t(255 - x * 5), uint8_t(200 + (x ^ y) % 50)));
+		alo::Raster::Downsample(src.View(), dst.View(), n, alo::Raster::Downsampler::BOX, { 0, 0, 8, 6 });
+
+		bool bExact = true;
+		for (int32_t y = 0; y < 6; y++)
+			for (int32_t x = 0; x < 8; x++)
+			{
+				uint32_t nSum[4] = {};
+				for (int32_t j = 0; j < n; j++)
+					for (int32_t i = 0; i < n; i++)
+					{
+						const alo::Pixel p = src.GetPixel(x * n + i, y * n + j);
+						nSum[0] += p.r; nSum[1] += p.g; nSum[2] += p.b; nSum[3] += p.a;
+					}
+				const uint32_t nArea = uint32_t(n * n);
+				const alo::Pixel q = dst.GetPixel(x, y);
+				bExact = bExact && q.r == (nSum[0] + nArea / 2) / nArea && q.g == (nSum[1] + nArea / 2) / nArea
+					&& q.b == (nSum[2] + nArea / 2) / nArea && q.a == (nSum[3] + nArea / 2) / nArea;
+			}
+		CHECK(bExact);
+	}
+}
+
+// LANCZOS keeps a constant image constant, edges included, as its weights sum
+// to one and reads past the edges are clamped
+static void DownsampleLanczosConstant()
+{
+	for (int32_t n : { 2, 3, 4 })
+	{
+		const alo::Pixel col(90, 160, 230, 255);
+		alo::Sprite src(10 * n, 7 * n), dst(10, 7);
+		Fill(src, col);
+		Fill(dst, alo::BLACK);
+		alo::Raster::Downsample(src.View(), dst.View(), n, alo::Raster::Downsampler::LANCZOS, { 0, 0, 10, 7 });
+		int nMax = 0;
+		for (int32_t y = 0; y < 7; y++)
+			for (int32_t x = 0; x < 10; x++)
+			{
+				const alo::Pixel q = dst.GetPixel(x, y);
+				nMax = std::max({ nMax, std::abs(q.r - col.r), std::abs(q.g - col.g), std::abs(q.b - col.b), std::abs(q.a - col.a) });
+			}
+		CHECK(nMax <= 1);
+	}
+}
+
+// Source edges short of a whole block, and rectangles past the target, are
+// left alone rather than read or written out of bounds
+static void DownsampleOddEdges()
+{
+	for (alo::Raster::Downsampler filter : { alo::Raster::Downsampler::BOX, alo::Raster::Downsampler::LANCZOS })
+	{
+		alo::Sprite src(9, 7), dst(5, 4);
+		Fill(src, alo::WHITE);
+		Fill(dst, alo::RED);
+		alo::Raster::Downsample(src.View(), dst.View(), 2, filter, { -3, -3, 50, 50 });
+		// Only the 4 x 3 whole blocks are written
+		CHECK(Count(dst, alo::WHITE) == 12);
+		CHECK(dst.GetPixel(4, 0) == alo::RED && dst.GetPixel(0, 3) == alo::RED);
+
+		// A part of the target only
+		Fill(dst, alo::RED);
+		alo::Raster::Downsample(src.View(), dst.View(), 2, filter, { 1, 1, 3, 2 });
+		CHECK(Count(dst, alo::WHITE) == 2);
+		CHECK(dst.GetPixel(1, 1) == alo::WHITE && dst.GetPixel(2, 1) == alo::WHITE);
+	}
+}
+
+// A supersampled polyline of several colours is one stroke, its joints blended
+// once, so in one colour it matches the stroke drawn whole
+static void SupersampledPolyline()
+{
+	test::Engine engine;
+	engine.SetSupersample(2);
+	engine.SetDrawTarget(nullptr);
+	engine.SetPixelMode(alo::Pixel::ALPHA);
+	const std::vector<alo::vf2d> vPoints = { { 10, 10 }, { 60, 14 }, { 20, 40 }, { 70, 70 }, { 40, 5 } };
+	const alo::Pixel col(250, 200, 40, 128);
+
+	engine.Clear(alo::BLACK);
+	engine.DrawStroke(vPoints, 1.0f, col);
+	std::unique_ptr<alo::Sprite> pWhole(engine.GetDrawTarget()->Duplicate());
+
+	engine.Clear(alo::BLACK);
+	engine.DrawPolyline(vPoints, std::vector<alo::Pixel>{ col, col });
+	alo::Sprite& sprCanvas = *engine.GetDrawTarget();
+	int nMax = 0;
+	for (int32_t y = 0; y < 100; y++)
+		for (int32_t x = 0; x < 160; x++)
+		{
+			const alo::Pixel p = pWhole->GetPixel(x, y), q = sprCanvas.GetPixel(x, y);
+			nMax = std::max({ nMax, std::abs(p.r - q.r), std::abs(p.g - q.g), std::abs(p.b - q.b) });
+		}
+	CHECK(nMax <= 2);
+	CHECK(engine.GetDrawTarget()->width == 1280);
+}
+
+// The clamped box passes making up a kernel, composed into one n x n matrix of
+// weights per axis, out[i] = sum over j of M[i * n + j] * in[j]
+static std::vector<double> BlurMatrix(int32_t n, int32_t nRadius, alo::Raster::BlurKernel kernel)
+{
+	std::vector<int32_t> vRadii;
+	if (kernel == alo::Raster::BlurKernel::BOX) { if (nRadius > 0) vRadii.push_back(std::min(nRadius, 64)); }
+	else
+		for (int32_t i = 0; i < 3; i++)
+			if ((std::min(nRadius, 192) + i) / 3 > 0) vRadii.push_back((std::min(nRadius, 192) + i) / 3);
+
+	std::vector<double> M(size_t(n) * n, 0.0), B(size_t(n) * n), T(size_t(n) * n);
+	for (int32_t i = 0; i < n; i++) M[size_t(i) * n + i] = 1.0;
+	for (int32_t r : vRadii)
+	{
+		std::fill(B.begin(), B.end(), 0.0);
+		for (int32_t i = 0; i < n; i++)
+			for (int32_t k = -r; k <= r; k++)
+				B[size_t(i) * n + std::clamp(i + k, 0, n - 1)] += 1.0 / double(2 * r + 1);
+		for (int32_t i = 0; i < n; i++)
+			for (int32_t j = 0; j < n; j++)
+			{
+				double d = 0.0;
+				for (int32_t k = 0; k < n; k++) d += B[size_t(i) * n + k] * M[size_t(k) * n + j];
+				T[size_t(i) * n + j] = d;
+			}
+		std::swap(M, T);
+	}
+	return M;
+}
+
+// The separable, rounded passes of Blur and Glow match the kernel applied
+// directly in two dimensions and rounded once, to within one per channel. This
+// covers edge rows and columns, radii past the width, and blurs of part of an
+// image in place
+static void BlurReference()
+{
+	const int32_t w = 23, h = 17;
+	alo::Sprite src(w, h);
+	uint32_t nSeed = 12345;
+	for (int32_t y = 0; y < h; y++)
+		for (int32_t x = 0; x < w; x++)
+		{
+			nSeed = nSeed * 1664525u + 1013904223u;
+			src.SetPixel(x, y, alo::Pixel(nSeed >> 24, nSeed >> 16, nSeed >> 8, (nSeed >> 4) | 0x80));
+		}
+
+	for (alo::Raster::BlurKernel kernel : { alo::Raster::BlurKernel::BOX, alo::Raster::BlurKernel::GAUSSIAN })
+		for (int32_t nRadius : { 0, 1, 2, 5, 9, 30, 100 })
+		{
+			const std::vector<double> Mx = BlurMatrix(w, nRadius, kernel), My = BlurMatrix(h, nRadius, kernel);
+			auto reference = [&](int32_t x, int32_t y, int c)
+			{
+				double d = 0.0;
+				for (int32_t j = 0; j < h; j++)
+					for (int32_t i = 0; i < w; i++)
+					{
+						const alo::Pixel p = src.GetPixel(i, j);
+						d += My[size_t(y) * h + j] * Mx[size_t(x) * w + i] * double(c == 0 ? p.r : c == 1 ? p.g : c == 2 ? p.b : p.a);
+					}
+				return d;
+			};
+
+			alo::Sprite blur(w, h), glow(w, h), part(w, h);
+			alo::Raster::Blur(src.View(), blur.View(), nRadius, kernel, { 0, 0, w, h });
+			alo::Raster::Glow(src.View(), glow.View(), nRadius, kernel, 0.5f, { 0, 0, w, h });
+			// Part of a copy, blurred in place, around one corner
+			for (int32_t y = 0; y < h; y++) for (int32_t x = 0; x < w; x++) part.SetPixel(x, y, src.GetPixel(x, y));
+			const alo::DirtyRegion::Rect r = { 15, 0, w, 6 };
+			alo::Raster::Blur(part.View(), part.View(), nRadius, kernel, r);
+
+			int nBlur = 0, nGlow = 0, nPart = 0;
+			for (int32_t y = 0; y < h; y++)
+				for (int32_t x = 0; x < w; x++)
+				{
+					const alo::Pixel b = blur.GetPixel(x, y), g = glow.GetPixel(x, y), s = src.GetPixel(x, y), q = part.GetPixel(x, y);
+					const bool bInPart = x >= r.x0 && x < r.x1 && y >= r.y0 && y < r.y1;
+					for (int c = 0; c < 4; c++)
+					{
+						const double d = reference(x, y, c);
+						const int nB = c == 0 ? b.r : c == 1 ? b.g : c == 2 ? b.b : b.a;
+						const int nG = c == 0 ? g.r : c == 1 ? g.g : c == 2 ? g.b : g.a;
+						const int nS = c == 0 ? s.r : c == 1 ? s.g : c == 2 ? s.b : s.a;
+						const int nQ = c == 0 ? q.r : c == 1 ? q.g : c == 2 ? q.b : q.a;
+						nBlur = std::max(nBlur, std::abs(nB - int(std::lround(d))));
+						nGlow = std::max(nGlow, std::abs(nG - int(std::lround(std::min(double(nS) + d * 0.5, 255.0)))));
+						nPart = std::max(nPart, std::abs(nQ - (bInPart ? int(std::lround(d)) : nS)));
+					}
+				}
+			if (nBlur > 1 || nGlow > 1 || nPart > 1)
+				std::printf("  kernel %d radius %d: blur %d, glow %d, part %d off\n", int(kernel), nRadius, nBlur, nGlow, nPart);
+			CHECK(nBlur <= 1);
+			CHECK(nGlow <= 1);
+			CHECK(nPart <= 1);
+		}
+}
+
+int main()
+{
+	FloodFillRing();
+	FillPolygonStar();
+	FillPolygonDegenerate();
+	DownsampleBox();
+	DownsampleLanczosConstant();
+	DownsampleOddEdges();
+	SupersampledPolyline();
+	BlurReference();
+	std::printf(test::nFailed == 0 ? "All passed\n" : "%d failed\n", test::nFailed);
+	return test::nFailed == 0 ? 0 : 1;
+}
@@ -0,0 +1,84 @@
+#include "headless.h"
+
+// A tiled sprite is made linear to be drawn into, and tiling it fails while it
+// is the draw target, so the engine's view of it never dangles
+static void TiledDrawTarget()
+{
+	test::Engine engine;
+	alo::Sprite spr(20, 20);
+	spr.SetLayout(alo::Sprite::Layout::TILED);
+
+	engine.SetDrawTarget(&spr);
+	CHECK(spr.GetLayout() == alo::Sprite::Layout::LINEAR);
+	CHECK(engine.GetDrawTargetView().data == spr.GetData());
+
+	CHECK(!engine.SetSpriteLayout(&spr, alo::Sprite::Layout::TILED));
+	CHECK(spr.GetLayout() == alo::Sprite::Layout::LINEAR);
+	CHECK(engine.GetDrawTargetView().data == spr.GetData());
+	engine.Draw(3, 4, alo::RED);
+	CHECK(spr.GetPixel(3, 4) == alo::RED);
+	CHECK(engine.SetSpriteLayout(&spr, alo::Sprite::Layout::LINEAR));
+
+	// Once it is no longer the target it can be tiled again
+	engine.SetDrawTarget(nullptr);
+	CHECK(engine.SetSpriteLayout(&spr, alo::Sprite::Layout::TILED));
+	CHECK(spr.GetLayout() == alo::Sprite::Layout::TILED);
+	CHECK(spr.GetPixel(3, 4) == alo::RED);
+	CHECK(!engine.SetSpriteLayout(nullptr, alo::Sprite::Layout::TILED));
+}
+
+// Largest channel difference between two sprites of the same size
+static int MaxDifference(alo::Sprite& a, alo::Sprite& b)
+{
+	int n = 0;
+	for (int y = 0; y < a.height; y++)
+		for (int x = 0; x < a.width; x++)
+		{
+			const alo::Pixel p = a.GetPixel(x, y), q = b.GetPixel(x, y);
+			n = std::max({ n, std::abs(p.r - q.r), std::abs(p.g - q.g), std::abs(p.b - q.b) });
+		}
+	return n;
+}
+
+// A stroke extended a segment at a time matches the stroke drawn whole, in
+// ALPHA mode too, where drawing each segment as its own stroke darkens the joints
+static void StrokeExtended()
+{
+	// A few sharp turns, and a long spiral crossing itself many times
+	std::vector<alo::vf2d> vTurns = { { 8, 8 }, { 50, 12 }, { 20, 30 }, { 52, 52 }, { 30, 4 }, { 10, 56 } }, vSpiral;
+	for (int i = 0; i < 2000; i++)
+	{
+		const float t = float(i) * 0.05f;
+		vSpiral.push_back({ 32.0f + (20.0f + 8.0f * std::sin(t * 0.37f)) * std::cos(t), 32.0f + (20.0f + 8.0f * std::cos(t * 0.23f)) * std::sin(t) });
+	}
+
+	for (const auto* pPoints : { &vTurns, &vSpiral })
+		for (uint8_t nAlpha : { uint8_t(255), uint8_t(128) })
+		{
+			const alo::Pixel col(200, 100, 50, nAlpha);
+			alo::Sprite sprWhole(64, 64), sprExtended(64, 64), sprSegments(64, 64);
+			for (alo::Sprite* s : { &sprWhole, &sprExtended, &sprSegments })
+				for (int y = 0; y < 64; y++) for (int x = 0; x < 64; x++) s->SetPixel(x, y, alo::BLACK);
+
+			alo::Raster::Pen pen; pen.mode = alo::Pixel::ALPHA;
+			alo::Raster::DrawStroke(sprWhole.View(), pPoints->data(), pPoints->size(), 7.0f, col, alo::Raster::Join::ROUND, pen);
+			alo::Raster::Stroke stroke;
+			for (const auto& v : *pPoints)
+				alo::Raster::ExtendStroke(sprExtended.View(), stroke, v, 7.0f, col, pen);
+			for (size_t n = 1; n < pPoints->size(); n++)
+				alo::Raster::DrawStroke(sprSegments.View(), &(*pPoints)[n - 1], 2, 7.0f, col, alo::Raster::Join::ROUND, pen);
+
+			// Rounding of the two blends, against a visible seam
+			CHECK(MaxDifference(sprWhole, sprExtended) <= 2);
+			CHECK(MaxDifference(sprWhole, sprSegments) > 8);
+			CHECK(stroke.Points().size() == pPoints->size());
+		}
+}
+
+int main()
+{
+	TiledDrawTarget();
+	StrokeExtended();
+	std::printf(test::nFailed == 0 ? "All passed\n" : "%d failed\n", test::nFailed);
+	return test::nFailed == 0 ? 0 : 1;
+}